@@ -15,70 +15,34 @@
  * new image from a font and color. For our texture class all that means is
  * that we're going to be loading our image from text rendered by SDL_ttf
  * instead of a file.
+ *
+ * Rendering a whole string into a new texture is fine for text that never
+ * changes, but text that changes every frame would make and destroy a texture
+ * every frame. So the tutorial library has a glyph atlas, which renders each
+ * glyph of the font once into one shared texture and then draws any string
+ * as a batch of quads cut from it. The later tutorials draw all their text
+ * with it, and the second line here shows it off.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
-
 /*
  * For this and future tutorials, we'll be using a global font for our text
  * rendering. In SDL_ttf, the data type for fonts is TTF_Font. We also have a
- * texture which will be generated from the font.
+ * texture which will be generated from the font, and the glyph atlas.
  */
 TTF_Font *gFont = NULL;
 LTexture gTextTexture;
+GlyphAtlas gTextAtlas;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	/* TODO test the effect of this filter on text. */
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering failed.");
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC | LTUT_LINEAR))
 		return -1;
-	}
 /*
  * Just like SDL_image, we have to initialize it or the font loading and
  * rendering functions won't work properly. We start up SDL_ttf using TTF_init.
@@ -92,18 +56,6 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
 /*
  * Here is where we actually create the text texture we're going to render from
  * the font. This function takes in the string of text we want to render and
@@ -128,7 +80,9 @@ short LTexture_loadFromRenderedText(
 					char *textureText, 
 					SDL_Color textColor)
 {
-	free_texture(lt);
+	short ret;
+
+	LTexture_free(lt);
 
 	SDL_Surface* textSurface = TTF_RenderText_Solid(
 			gFont, textureText, textColor);
@@ -137,45 +91,11 @@ short LTexture_loadFromRenderedText(
 		return -1;
 	}
 
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
+	ret = LTexture_loadFromSurface(lt, textSurface, NULL);
 
 	SDL_FreeSurface(textSurface);
 	
-	return 0;
-}
-
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect *clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
-int LTexture_getWidth(LTexture *lt)
-{
-	return lt->mWidth;
-}
-
-int LTexture_getHeight(LTexture *lt)
-{
-	return lt->mHeight;
+	return ret;
 }
 
 /*
@@ -186,6 +106,8 @@ int LTexture_getHeight(LTexture *lt)
  * loading method. As a general rule, you want to minimize the number of time
  * you render text. Only rerender it when you need to and since we're using the
  * same text surface for this whole program, we only want to render once.
+ *
+ * The glyph atlas is built from the font once it has loaded.
  */
 short loadMedia(void)
 {
@@ -202,6 +124,9 @@ short loadMedia(void)
 				textColor))
 		return -1;
 
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
+		return -1;
+
 	return 0;
 }
 
@@ -212,24 +137,22 @@ short loadMedia(void)
  */
 void close_all(void)
 {
-	free_texture(&gTextTexture);
+	GlyphAtlas_free(&gTextAtlas);
+	LTexture_free(&gTextTexture);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 int main(int argc, char* args[])
 {
 	SDL_Event e;
+	SDL_Color atlasColor = { 0x80, 0x80, 0x80, 0xFF };
+	char *atlasText = "And this line is drawn from the glyph atlas";
+	int atlasW, atlasH;
 
 	if(init())
 		goto equit;
@@ -251,11 +174,20 @@ int main(int argc, char* args[])
  */
 		LTexture_render(
 				&gTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gTextTexture)) / 2,
-				(SCREEN_HEIGHT - LTexture_getHeight(
-						&gTextTexture)) / 2,
+				(SCREEN_WIDTH - gTextTexture.mWidth) / 2,
+				(SCREEN_HEIGHT - gTextTexture.mHeight) / 2,
 				NULL);
+/*
+ * Text from the atlas is measured and drawn without making a texture, and
+ * reaches the screen when the atlas is flushed.
+ */
+		GlyphAtlas_measure(&gTextAtlas, atlasText, &atlasW, &atlasH);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - atlasW) / 2,
+				(SCREEN_HEIGHT + gTextTexture.mHeight) / 2,
+				atlasText, atlasColor);
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
 	}
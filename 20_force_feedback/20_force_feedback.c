@@ -5,19 +5,11 @@
  * new haptics API to make the controller shake.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 LTexture gSplashTexture;
 
 /*
@@ -35,10 +27,9 @@ SDL_Haptic* gControllerHaptic = NULL;
 short init(void)
 {
 	//if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER | SDL_INIT_HAPTIC)) {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER)) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_GAMECONTROLLER, LTUT_VSYNC))
 		return -1;
-	}
 
 	if(SDL_NumJoysticks() < 1)
 		SDL_Log("Warning: No input device connected.");
@@ -72,102 +63,9 @@ short init(void)
 /*		return -1; */
 /*	} */
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH, SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
 	return 0;
 }
 
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
-}
-
 short loadMedia(void)
 {
 	if(LTexture_loadFromFile(&gSplashTexture, "splash.png"))
@@ -181,18 +79,12 @@ short loadMedia(void)
  */
 void close_all(void)
 {
-	free_texture(&gSplashTexture);
+	LTexture_free(&gSplashTexture);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -240,8 +132,7 @@ int main(void)
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(&gSplashTexture, 0, 0, NULL, 0.0, NULL,
-						SDL_FLIP_NONE);
+		LTexture_render(&gSplashTexture, 0, 0, NULL);
 
 		SDL_RenderPresent(gRenderer);
 	}
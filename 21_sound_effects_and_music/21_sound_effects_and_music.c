@@ -11,21 +11,13 @@
  * binary files in the right place with your compiler configured to use them.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
 #include <SDL2/SDL_mixer.h>
 #include <stdio.h>
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 LTexture gPromptTexture;
 
 /*
@@ -45,39 +37,13 @@ Mix_Chunk *gLow = NULL;
  */
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_AUDIO, 0))
 		return -1;
-	}
 
 	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "2") == 0)
 		SDL_Log("Warning: Linear texture filtering disabled.");
 
-
-	gWindow = SDL_CreateWindow(
-			"SDL Tutorial",
-			SDL_WINDOWPOS_UNDEFINED,
-			SDL_WINDOWPOS_UNDEFINED,
-			SCREEN_WIDTH,SCREEN_HEIGHT,
-			SDL_WINDOW_SHOWN);
-
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
 /*
  * To initialize SDL_mixer we need to call Mix_OpenAudio. The first argument
  * sets the sound frequency, and 44100 is a standard frequency that works on
@@ -99,58 +65,6 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-short LTexture_render(LTexture *lt)
-{
-	return SDL_RenderCopy(gRenderer, lt->mTexture, NULL, NULL);
-}
-
 /*
  * Here we load our splash texture and sound.
  *
@@ -202,7 +116,7 @@ short loadMedia(void)
  */
 void close_all(void)
 {
-	free_texture(&gPromptTexture);
+	LTexture_free(&gPromptTexture);
 
 	Mix_FreeChunk(gScratch);
 	Mix_FreeChunk(gHigh);
@@ -216,14 +130,8 @@ void close_all(void)
 	Mix_FreeMusic(gMusic);
 	gMusic = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	Mix_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -312,7 +220,7 @@ int main(void)
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(&gPromptTexture);
+		LTexture_render(&gPromptTexture, 0, 0, NULL);
 
 		SDL_RenderPresent(gRenderer);
 		SDL_Delay(16);
@@ -5,64 +5,19 @@
  * time. In this tutorial we'll make a timer we can restart.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 TTF_Font *gFont = NULL;
-
-LTexture gTimeTextTexture;
-LTexture gPromptTextTexture;
+GlyphAtlas gTextAtlas;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC | LTUT_LINEAR))
 		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering disabled.");
-
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
 
 	if(TTF_Init() < 0) {
 		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
@@ -72,118 +27,12 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
-{
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-						gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
-
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-	
-	return 0;
-}
-
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
-}
-
-int LTexture_getWidth(LTexture *lt)
-{
-	return lt->mWidth;
-}
-
-int LTexture_getHeight(LTexture *lt)
-{
-	return lt->mHeight;
-}
-
 /*
  * As mentioned in the font rendering tutorial, you want to minimize the amount
- * of times you render text. We'll have a texture to prompt input and a texture
- * to display the current time in milliseconds. The time texture changes every
- * frame so we have to render that every frame, but the prompt texture doesn't
- * change so we can render it once in the file loading function.
+ * of times you render text. We'll have a prompt and the current time in
+ * milliseconds. The time changes every frame, so rather than render it to a
+ * new texture every frame, both are drawn from a glyph atlas that renders the
+ * font once here in the file loading function.
  */
 short loadMedia(void)
 {
@@ -194,12 +43,7 @@ short loadMedia(void)
 		return -1;
 	}
 
-	SDL_Color textColor = { 0, 0, 0, 255 };
-	
-	if(LTexture_loadFromRenderedText(
-					&gPromptTextTexture,
-					"Press Enter to Reset Start Time.",
-					textColor))
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
 		return -1;
 
 	return 0;
@@ -207,20 +51,13 @@ short loadMedia(void)
 
 void close_all(void)
 {
-	free_texture(&gTimeTextTexture);
-	free_texture(&gPromptTextTexture);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -236,10 +73,12 @@ void close_all(void)
 int main(int argc, char *argv[])
 {
 	SDL_Event e;
+	char *prompt = "Press Enter to Reset Start Time.";
 	char *text = "Milliseconds since start time ";
 	int max_char_uint32 = 11;
 	char timeText[strlen(text) + max_char_uint32];
 	Uint32 startTime = 0;
+	int promptW, textW, textH;
 			
 	if(init())
 		goto equit;
@@ -281,32 +120,29 @@ int main(int argc, char *argv[])
  */
 		sprintf(timeText, "%s %u", text, SDL_GetTicks() - startTime);
 
-		if(LTexture_loadFromRenderedText(
-					&gTimeTextTexture, timeText, textColor))
-			goto equit;
-
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gPromptTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gPromptTextTexture)) / 2,
-				0, NULL, 0.0, NULL, SDL_FLIP_NONE);
+		GlyphAtlas_measure(&gTextAtlas, prompt, &promptW, &textH);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - promptW) / 2,
+				0, prompt, textColor);
 /*
- * Now that we have the time in a string, we can use it to render the current
- * time to a texture.
+ * Now that we have the time in a string, we can draw it from the atlas.
  */
-		LTexture_render(
-				&gTimeTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gPromptTextTexture)) / 2,
-				(SCREEN_HEIGHT - LTexture_getHeight(
-						&gPromptTextTexture)) / 2,
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
+		GlyphAtlas_measure(&gTextAtlas, timeText, &textW, &textH);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - promptW) / 2,
+				(SCREEN_HEIGHT - textH) / 2,
+				timeText, textColor);
 /*
- * Finally we render the prompt texture and the time texture to the screen.
+ * Finally we flush the atlas, which draws the prompt and the time to the
+ * screen in one go.
  */
+		GlyphAtlas_flush(&gTextAtlas);
+
 		SDL_RenderPresent(gRenderer);
 	}
 equit:
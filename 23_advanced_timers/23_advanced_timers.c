@@ -11,18 +11,11 @@
  * timer is running or paused.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 typedef struct {
 	Uint32 mStartTicks;
 	Uint32 mPausedTicks;
@@ -30,133 +23,23 @@ typedef struct {
 	short mStarted;
 } LTimer;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;	
 TTF_Font* gFont = NULL;	
-
-LTexture gTimeTextTexture;
-LTexture gPausePromptTexture;
-LTexture gStartPromptTexture;
+GlyphAtlas gTextAtlas;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering not enabled.");
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC | LTUT_LINEAR))
 		return -1;
-	}
 
 	if(TTF_Init() < 0) {
-		SDL_Log("%s(), IMG_Init failed. %s",
-				__func__, TTF_GetError());
+		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
 		return -1;
 	}
 
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
-{
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-						gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
-
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-	
-	return 0;
-}
-
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
-}
-
-int LTexture_getWidth(LTexture *lt)
-{
-	return lt->mWidth;
-}
-
-int LTexture_getHeight(LTexture *lt)
-{
-	return lt->mHeight;
-}
-
 /*
  * Our constructor initializes the internal data members. 
  */
@@ -269,18 +152,7 @@ short loadMedia(void)
 		return -1;
 	}
 
-	SDL_Color textColor = { 0, 0, 0, 255 };
-	
-	if(LTexture_loadFromRenderedText(
-				&gStartPromptTexture,
-				"Press S to Start or Stop the Timer",
-				textColor))
-		return -1;
-	
-	if(LTexture_loadFromRenderedText(
-				&gPausePromptTexture,
-				"Press P to Pause or Unpause the Timer",
-				textColor))
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
 		return -1;
 
 	return 0;
@@ -288,21 +160,13 @@ short loadMedia(void)
 
 void close_all(void)
 {
-	free_texture(&gTimeTextTexture);
-	free_texture(&gStartPromptTexture);
-	free_texture(&gPausePromptTexture);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -336,10 +200,13 @@ int main(int argc, char* argv[])
 {
 	SDL_Event e;
 	SDL_Color textColor = { 0, 0, 0, 255 };
+	char *startPrompt = "Press S to Start or Stop the Timer";
+	char *pausePrompt = "Press P to Pause or Unpause the Timer";
 	char *text = "Milliseconds since start time ";
 	int max_char_uint32 = 11;
 	char timeText[strlen(text) + max_char_uint32];
 	LTimer timer;
+	int w, h;
 
 	if(init())
 		goto equit;
@@ -362,38 +229,34 @@ int main(int argc, char* argv[])
 /*
  * Before we render, we write the current time to a string. The reason we
  * divide it by 1000 is because we want seconds and there are 1000 milliseconds
- * per second. After that we render the text to a texture and then finally draw
- * all the textures to the screen.
+ * per second. After that we draw the prompts and the time from the glyph
+ * atlas, which doesn't need a new texture however often the time changes.
  */
 		sprintf(timeText, "%s %6.4f", text,
 				LTimer_getTicks(&timer) / 1000.f);
 
-		if(LTexture_loadFromRenderedText(
-					&gTimeTextTexture, timeText, textColor))
-			goto equit;
-
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gStartPromptTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gStartPromptTexture)) / 2,
+		GlyphAtlas_measure(&gTextAtlas, startPrompt, &w, &h);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - w) / 2,
 				0,
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
-		LTexture_render(
-				&gPausePromptTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gPausePromptTexture)) / 2,
-				LTexture_getHeight(&gStartPromptTexture),
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
-		LTexture_render(
-				&gTimeTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-						&gTimeTextTexture)) / 2,
-				(SCREEN_HEIGHT -LTexture_getHeight(
-						&gTimeTextTexture)) / 2,
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
+				startPrompt, textColor);
+		GlyphAtlas_measure(&gTextAtlas, pausePrompt, &w, &h);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - w) / 2,
+				h,
+				pausePrompt, textColor);
+		GlyphAtlas_measure(&gTextAtlas, timeText, &w, &h);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - w) / 2,
+				(SCREEN_HEIGHT - h) / 2,
+				timeText, textColor);
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
 	}
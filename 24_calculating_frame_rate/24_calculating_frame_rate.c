@@ -5,69 +5,37 @@
  * We're going to use the timer to measure fps.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+#define PERF_HUD_SAMPLES	256
+#define PERF_HUD_TEXT		160
+#define PERF_HUD_UPDATES	4
 
 typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
+	GlyphAtlas *mAtlas;
+	LHiresTimer mTimer;
+	LHiresTimer mFrameTimer;
+	Uint32 mFrames;
+	Uint32 mSamples[PERF_HUD_SAMPLES];
+	Uint32 mSorted[PERF_HUD_SAMPLES];
+	int mCount, mNext;
+	Uint64 mLastUpdate;
+	Uint64 mUpdatePeriod;
+	char mText[PERF_HUD_TEXT];
+	int mWidth, mHeight;
+} PerfHud;
 
-typedef struct {
-	Uint32 mStartTicks;
-	Uint32 mPausedTicks;
-	short mPaused;
-	short mStarted;
-} LTimer;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 TTF_Font* gFont = NULL;
-LTexture gFPSTextTexture;
+GlyphAtlas gTextAtlas;
+PerfHud gPerfHud;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering not enabled.");
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC | LTUT_LINEAR))
 		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
 
 	if(TTF_Init() < 0) {
 		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
@@ -77,112 +45,137 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
+/*
+ * The performance HUD keeps the time of the last PERF_HUD_SAMPLES frames in
+ * a ring buffer, in microseconds, measured with the high resolution timer
+ * since a millisecond timer can't tell one fast frame from another. A few
+ * times a second it works out the shortest, average and longest frame and
+ * the 99th percentile, the frame time only one frame in a hundred is slower
+ * than, and writes them into its text buffer. The text is drawn from the
+ * glyph atlas every frame in between.
+ *
+ * Everything lives in the struct, so once the HUD is set up it never touches
+ * the heap, and the text is written a character at a time rather than with
+ * sprintf.
+ */
+void PerfHud_init(PerfHud *hud, GlyphAtlas *atlas, int updatesPerSecond)
 {
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
+	SDL_memset(hud, 0, sizeof(PerfHud));
+	hud->mAtlas = atlas;
+	hud->mUpdatePeriod = 1000000000 / updatesPerSecond;
+
+	LHiresTimer_start(&hud->mTimer);
+	LHiresTimer_start(&hud->mFrameTimer);
 }
 
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
+char *PerfHud_putText(char *p, char *text)
 {
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-						gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
-
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
+	while(*text != '\0')
+		*p++ = *text++;
 
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-	
-	return 0;
+	return p;
 }
 
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
+/*
+ * Writes a number that is in hundredths as a decimal with two places.
+ */
+char *PerfHud_putHundredths(char *p, Uint64 n)
 {
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+	char digits[24];
+	int i = 0;
+	Uint64 whole = n / 100;
 
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
+	do {
+		digits[i++] = '0' + whole % 10;
+		whole /= 10;
+	} while(whole > 0);
 
-	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
-}
+	while(i > 0)
+		*p++ = digits[--i];
 
-int LTexture_getWidth(LTexture *lt)
-{
-	return lt->mWidth;
-}
+	*p++ = '.';
+	*p++ = '0' + n / 10 % 10;
+	*p++ = '0' + n % 10;
 
-int LTexture_getHeight(LTexture *lt)
-{
-	return lt->mHeight;
+	return p;
 }
 
-void LTimer_init(LTimer *lt)
+int PerfHud_compare(const void *a, const void *b)
 {
-	lt->mStartTicks = 0;
-	lt->mPausedTicks = 0;
-	lt->mPaused = 0;
-	lt->mStarted = 0;
-}
+	Uint32 x = *(const Uint32*)a, y = *(const Uint32*)b;
 
-void LTimer_start(LTimer *lt)
-{
-	lt->mStarted = 1;
-	lt->mPaused = 0;
-	lt->mStartTicks = SDL_GetTicks();
-	lt->mPausedTicks = 0;
+	return (x > y) - (x < y);
 }
 
-Uint32 LTimer_getTicks(LTimer *lt)
+/*
+ * Rebuilds the text from the samples. The percentile needs the samples in
+ * order, so they are copied and sorted; SDL_qsort sorts in place so that
+ * doesn't allocate either.
+ */
+void PerfHud_update(PerfHud *hud)
 {
-	if(lt->mStarted) {
-		if(lt->mPaused)
-			return lt->mPausedTicks;
-		else
-			return SDL_GetTicks() - lt->mStartTicks;
+	Uint64 sum = 0, avgFPS = 0, ns;
+	char *p = hud->mText;
+	int i;
+
+	ns = LHiresTimer_getNanoseconds(&hud->mTimer);
+	if(ns > 0)
+		avgFPS = hud->mFrames * 100000000000.0 / ns;
+
+	p = PerfHud_putText(p, "Average Frames Per Second ");
+	p = PerfHud_putHundredths(p, avgFPS);
+
+	if(hud->mCount > 0) {
+		SDL_memcpy(hud->mSorted, hud->mSamples,
+				hud->mCount * sizeof(Uint32));
+		SDL_qsort(hud->mSorted, hud->mCount, sizeof(Uint32),
+				PerfHud_compare);
+
+		for(i = 0; i < hud->mCount; ++i)
+			sum += hud->mSorted[i];
+
+		p = PerfHud_putText(p, "\nmin ");
+		p = PerfHud_putHundredths(p, hud->mSorted[0] / 10);
+		p = PerfHud_putText(p, " avg ");
+		p = PerfHud_putHundredths(p, sum / hud->mCount / 10);
+		p = PerfHud_putText(p, " max ");
+		p = PerfHud_putHundredths(p, hud->mSorted[hud->mCount - 1] / 10);
+		p = PerfHud_putText(p, " p99 ");
+		p = PerfHud_putHundredths(p,
+				hud->mSorted[(hud->mCount * 99 + 99) / 100 - 1] / 10);
+		p = PerfHud_putText(p, " ms");
 	}
-	return 0;
+
+	*p = '\0';
+
+	GlyphAtlas_measure(hud->mAtlas, hud->mText, &hud->mWidth, &hud->mHeight);
 }
 
-short LTimer_isStarted(LTimer *lt)
+/*
+ * Call once a frame. It records how long it has been since the last call
+ * and updates the text when it is due.
+ */
+void PerfHud_frame(PerfHud *hud)
 {
-	return lt->mStarted;
+	Uint64 us = LHiresTimer_lap(&hud->mFrameTimer) / 1000;
+	Uint64 now = LHiresTimer_getNanoseconds(&hud->mTimer);
+
+	hud->mSamples[hud->mNext] = us > SDL_MAX_UINT32 ? SDL_MAX_UINT32 : us;
+	hud->mNext = (hud->mNext + 1) % PERF_HUD_SAMPLES;
+	if(hud->mCount < PERF_HUD_SAMPLES)
+		++hud->mCount;
+
+	++hud->mFrames;
+
+	if(now - hud->mLastUpdate >= hud->mUpdatePeriod || hud->mText[0] == '\0') {
+		PerfHud_update(hud);
+		hud->mLastUpdate = now;
+	}
 }
 
-short LTimer_isPaused(LTimer *lt)
+void PerfHud_draw(PerfHud *hud, int x, int y, SDL_Color color)
 {
-	return lt->mPaused && lt->mStarted;
+	GlyphAtlas_draw(hud->mAtlas, x, y, hud->mText, color);
 }
 
 short loadMedia(void)
@@ -193,40 +186,31 @@ short loadMedia(void)
 		return -1;
 	}
 
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
+		return -1;
+
 	return 0;
 }
 
 void close_all(void)
 {
-	free_texture(&gFPSTextTexture);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
  * In order to calculate the frames per second, we need to keep track of the
  * number of frames rendered and the number of second passed. Before we enter
- * the main loop, we start a timer used to calculate fps and declare a variable
- * to keep track of the number of frames rendered.
+ * the main loop, we set up the performance HUD, which starts a timer used to
+ * calculate fps and keeps count of the number of frames rendered.
  */
 int main(int argc, char* args[])
 {
-	char *text = "Average Frames Per Second ";
-	int max_char_uint32 = 11;
-	char timeText[strlen(text) + max_char_uint32];
-	int countedFrames = 0;
-	float avgFPS;
-
 	if(init())
 		goto equit;
 
@@ -235,10 +219,8 @@ int main(int argc, char* args[])
 
 	SDL_Event e;
 	SDL_Color textColor = { 0, 0, 0, 255 };
-	LTimer fpsTimer;
 
-	LTimer_init(&fpsTimer);
-	LTimer_start(&fpsTimer);
+	PerfHud_init(&gPerfHud, &gTextAtlas, PERF_HUD_UPDATES);
 
 	while(1)
 	{
@@ -247,40 +229,28 @@ int main(int argc, char* args[])
 				goto equit;
 /*
  * To calculate frames per second, you just take the number of rendered frames
- * and divide it by the seconds passed. Now it is possible for there to be a
- * very small amount of time passed for the first frame and have it give us a
- * really high fps. This is why we correct the value if it is really high.
- */
-		avgFPS = countedFrames / (LTimer_getTicks(&fpsTimer) / 1000.f);
-		if(avgFPS > 2000000)
-			avgFPS = 0;
-		
-		sprintf(timeText, "%s %6.4f", text, avgFPS);
-
-		if(LTexture_loadFromRenderedText(
-					&gFPSTextTexture, timeText, textColor))
-			goto equit;
-/*
- * After calculating the fps, we render the value as a texture to the screen.
- * After we're done rendering the scene, we increment the frame counter.
+ * and divide it by the seconds passed, which the HUD does along with the frame
+ * time figures each time it updates its text. Updating only a few times a
+ * second keeps the numbers readable, and keeps the counter from costing more
+ * than the frame it is measuring.
  *
  * Since this program is vsynced, it is probably going to report 60 fps. If you
  * want to find out how much you hardware can do, just create a renderer
  * without vsync.
  */
+		PerfHud_frame(&gPerfHud);
+
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gFPSTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-							&gFPSTextTexture)) / 2,
-				(SCREEN_HEIGHT - LTexture_getHeight(
-							&gFPSTextTexture)) / 2,
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
+		PerfHud_draw(
+				&gPerfHud,
+				(SCREEN_WIDTH - gPerfHud.mWidth) / 2,
+				(SCREEN_HEIGHT - gPerfHud.mHeight) / 2,
+				textColor);
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
-		++countedFrames;
 	}
 equit:
 	close_all();
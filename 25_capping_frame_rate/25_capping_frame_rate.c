@@ -5,172 +5,175 @@
  * we'll disable vsync and maintain a maximum frame rate.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 /*
  * For this demo, we're going render our frame normally, but at the end of the
  * frame we're going to wait until the frame time is completed. For example
  * here, when you want to render at 60 fps you have to spend 16 and 2/3rd
- * milliseconds per frame ( 1000ms / 60 frames ). This is why here we calculate
- * the number of ticks per frame in milliseconds.
+ * milliseconds per frame ( 1000ms / 60 frames ). The frame pacer works out
+ * when each frame is due from SCREEN_FPS itself, so the 2/3rd isn't lost.
  */
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 #define SCREEN_FPS		30
-#define SCREEN_TICK_PER_FRAME	 1000 / SCREEN_FPS
+#define FRAME_PACER_SPIN_NS	300000
 
 typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
+	LHiresTimer mTimer;
+	Uint32 mFps;
+	Uint64 mPeriod;
+	Uint64 mEpoch;
+	Uint64 mFrame;
+	Uint64 mLast;
+	Uint64 mOversleep;
+	Uint64 mJitterSum;
+	Uint64 mJitterMax;
+	Uint32 mJitterFrames;
+	Uint32 mLate;
+} FramePacer;
 
-typedef struct {
-	Uint32 mStartTicks;
-	Uint32 mPausedTicks;
-	short mPaused;
-	short mStarted;
-} LTimer;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 TTF_Font* gFont = NULL;
-LTexture gFPSTextTexture;
+GlyphAtlas gTextAtlas;
 
-short init(void)
-{
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
 /*
  * As you can see, we're disabling VSync for this demo because we'll be
  * manually capping the frame rate.
  */
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+short init(void)
+{
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0))
 		return -1;
-	}
 
 	if(TTF_Init() < 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, TTF_GetError());
+		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
 		return -1;
 	}
 
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
+/*
+ * The frame pacer holds the frame rate to a target given in frames a second,
+ * which needn't divide a second into whole milliseconds. Rather than wait
+ * a frame's length after each frame, which lets every frame's error add up,
+ * frame n is due n / fps seconds after the pacer started. Working the
+ * deadline out from the frame count each time means the fraction of a
+ * nanosecond a frame really lasts is never lost.
+ *
+ * SDL_Delay only promises to sleep at least as long as asked, and usually
+ * wakes up a scheduler tick or so late. So the pacer sleeps until a little
+ * before the deadline and spins on the timer for the rest. How far before is
+ * FRAME_PACER_SPIN_NS plus however late SDL_Delay has been waking up lately,
+ * which the pacer keeps a running average of.
+ *
+ * If a frame runs more than a whole frame late there is no catching up
+ * without a burst of fast frames, so the pacer starts counting again from
+ * that frame.
+ */
+void FramePacer_init(FramePacer *fp, Uint32 fps)
 {
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
+	SDL_memset(fp, 0, sizeof(FramePacer));
+	fp->mFps = fps;
+	fp->mPeriod = 1000000000 / fps;
+
+	LHiresTimer_start(&fp->mTimer);
 }
 
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
+Uint64 FramePacer_deadline(FramePacer *fp, Uint64 frame)
 {
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-						gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
+	return fp->mEpoch + frame * 1000000000 / fp->mFps;
+}
 
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
+/*
+ * Every frame's length is compared with the ideal 1 / fps seconds, and the
+ * pacer keeps the average and the largest difference until the statistics
+ * are reset. Late frames are the ones that finished after their deadline.
+ */
+void FramePacer_record(FramePacer *fp, Uint64 now, short late)
+{
+	Uint64 length, error;
+
+	if(fp->mLast != 0) {
+		length = (now - fp->mLast) * fp->mFps;
+		error = length > 1000000000 ? length - 1000000000
+			: 1000000000 - length;
+		error /= fp->mFps;
+
+		fp->mJitterSum += error;
+		if(error > fp->mJitterMax)
+			fp->mJitterMax = error;
+		++fp->mJitterFrames;
 	}
 
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-
-	return 0;
+	fp->mLate += late;
+	fp->mLast = now;
 }
 
-short LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
+/*
+ * Call at the end of every frame; it returns when the next frame is due.
+ */
+void FramePacer_wait(FramePacer *fp)
 {
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+	Uint64 now, deadline, margin, asked, slept;
+	short late;
+
+	now = LHiresTimer_getNanoseconds(&fp->mTimer);
+	deadline = FramePacer_deadline(fp, fp->mFrame + 1);
+	late = now > deadline;
+
+	if(now > deadline + fp->mPeriod) {
+		fp->mEpoch = now;
+		fp->mFrame = 0;
+		FramePacer_record(fp, now, 1);
+		return;
+	}
 
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
+	margin = FRAME_PACER_SPIN_NS + fp->mOversleep;
+	if(deadline > now + margin) {
+		asked = (deadline - now - margin) / 1000000;
+		if(asked > 0) {
+			SDL_Delay(asked);
+
+			slept = LHiresTimer_getNanoseconds(&fp->mTimer) - now;
+			asked *= 1000000;
+			fp->mOversleep = (fp->mOversleep * 7
+					+ (slept > asked ? slept - asked : 0)) / 8;
+		}
 	}
 
-	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
+	do
+		now = LHiresTimer_getNanoseconds(&fp->mTimer);
+	while(now < deadline);
+
+	++fp->mFrame;
+	FramePacer_record(fp, now, late);
 }
 
-int LTexture_getWidth(LTexture *lt)
+/*
+ * The average and largest jitter, in nanoseconds, since the last reset.
+ */
+Uint64 FramePacer_getMeanJitter(FramePacer *fp)
 {
-	return lt->mWidth;
+	return fp->mJitterFrames ? fp->mJitterSum / fp->mJitterFrames : 0;
 }
 
-int LTexture_getHeight(LTexture *lt)
+Uint64 FramePacer_getMaxJitter(FramePacer *fp)
 {
-	return lt->mHeight;
+	return fp->mJitterMax;
 }
 
-void LTimer_start(LTimer *lt)
+Uint32 FramePacer_getLateFrames(FramePacer *fp)
 {
-	lt->mStarted = 1;
-	lt->mPaused = 0;
-	lt->mStartTicks = SDL_GetTicks();
-	lt->mPausedTicks = 0;
+	return fp->mLate;
 }
 
-Uint32 LTimer_getTicks(LTimer *lt)
+void FramePacer_resetStats(FramePacer *fp)
 {
-	if(lt->mStarted) {
-		if(lt->mPaused)
-			return lt->mPausedTicks;
-		else
-			return SDL_GetTicks() - lt->mStartTicks;
-	}
-	return 0;
+	fp->mJitterSum = 0;
+	fp->mJitterMax = 0;
+	fp->mJitterFrames = 0;
+	fp->mLate = 0;
 }
 
 short loadMedia(void)
@@ -181,36 +184,32 @@ short loadMedia(void)
 		return -1;
 	}
 
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
+		return -1;
+
 	return 0;
 }
 
 void close_all(void)
 {
-	free_texture(&gFPSTextTexture);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
  * For this program we'll not only need a timer to calculate the frame rate,
- * but also a timer to cap the frames per second. Here, before we enter the main
- * loop, we declare some variables and start the fps calculator timer.
+ * but also a frame pacer to cap the frames per second. Here, before we enter
+ * the main loop, we declare some variables and start the fps calculator timer.
  */
 int main(int argc, char* argv[])
 {
-	char *text = "Average Frames Per Second ";
-	int max_char_uint32 = 11;
-	char timeText[strlen(text) + max_char_uint32];
+	char timeText[128];
+	int textW, textH;
 
 	if(init())
 		goto equit;
@@ -221,65 +220,81 @@ int main(int argc, char* argv[])
 	SDL_Event e;
 
 	SDL_Color textColor = { 0, 0, 0, 255 };
-	LTimer fpsTimer;
-	LTimer capTimer;
+	LHiresTimer fpsTimer;
+	FramePacer pacer;
 
 	int countedFrames = 0;
 	float avgFPS;
-	int frameTicks;
 
-	LTimer_start(&fpsTimer);
+	LHiresTimer_start(&fpsTimer);
 
 /*
- * To cap the FPS we need to know how long the frame has taken to render which
- * is why we start a timer at the beginning of each frame.
+ * To cap the FPS we need to know when each frame is due, which the pacer
+ * works out from when it was started.
  */
+	FramePacer_init(&pacer, SCREEN_FPS);
+
 	while(1)
 	{
-		LTimer_start(&capTimer);
-		while(SDL_PollEvent(&e) != 0)
+		while(SDL_PollEvent(&e) != 0) {
 			if(e.type == SDL_QUIT)
 				goto equit;
-
-		avgFPS = countedFrames / (LTimer_getTicks(&fpsTimer) / 1000.f);
-		if(avgFPS > 2000000)
-			avgFPS = 0;
-
-		sprintf(timeText, "%s %7.4f", text, avgFPS);
-
-		if(LTexture_loadFromRenderedText(
-					&gFPSTextTexture, timeText, textColor))
-			goto equit;
+			if(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_r)
+				FramePacer_resetStats(&pacer);
+		}
+/*
+ * The figures are only formatted and measured once a second rather than
+ * every frame; nobody can read them any faster. The first second is spent
+ * starting up, so the jitter statistics are reset once it is over, and
+ * pressing r resets them again.
+ */
+		if(countedFrames % SCREEN_FPS == 0) {
+			if(countedFrames == SCREEN_FPS)
+				FramePacer_resetStats(&pacer);
+
+			avgFPS = countedFrames
+				/ (LHiresTimer_getNanoseconds(&fpsTimer) / 1000000000.f);
+			if(avgFPS > 2000000)
+				avgFPS = 0;
+
+			SDL_snprintf(timeText, sizeof(timeText),
+					"Average Frames Per Second %7.4f\n"
+					"Jitter avg %.3f max %.3f ms, %u late",
+					avgFPS,
+					FramePacer_getMeanJitter(&pacer) / 1000000.f,
+					FramePacer_getMaxJitter(&pacer) / 1000000.f,
+					FramePacer_getLateFrames(&pacer));
+			GlyphAtlas_measure(&gTextAtlas, timeText, &textW, &textH);
+		}
 
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gFPSTextTexture,
-				(SCREEN_WIDTH - LTexture_getWidth(
-							&gFPSTextTexture)) / 2,
-				(SCREEN_HEIGHT - LTexture_getHeight(
-							&gFPSTextTexture)) / 2,
-				NULL, 0.0, NULL, SDL_FLIP_NONE);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - textW) / 2,
+				(SCREEN_HEIGHT - textH) / 2,
+				timeText, textColor);
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
 		++countedFrames;
 /*
- * Finally here we have the code to cap the frame rate. First we get how many
- * ticks the frame took to complete. If the number of ticks the frame took to
- * execute is less than the ticks needed per frame, we then delay for the
- * remaining time to prevent the application from running too fast.
+ * Finally here we have the code to cap the frame rate. The pacer waits out
+ * whatever is left of the frame so that the next one starts when it is due.
+ *
+ * Waiting with SDL_Delay for the number of whole milliseconds left in a
+ * frame of 1000 / SCREEN_FPS milliseconds runs slightly fast, since the ticks
+ * per frame would be 33ms as opposed to the exact 33 1/3ms, and each frame
+ * then lasts however long SDL_Delay oversleeps on top. The pacer gets both
+ * right, and the jitter figures on screen show how close each frame comes.
  *
- * There's a reason we'll be using VSync for these tutorials as opposed to
- * manually capping the frame rate. When running this application, you'll
- * notice that it runs slightly fast. Since we're using integers (because
- * floating point numbers are not precise), the ticks per frame will be 16ms as
- * opposed to the exact 16 2/3ms. This solution is more of a stop gap in case
- * you have to deal with hardware that does not support VSync.
+ * There's still a reason we'll be using VSync for these tutorials as opposed
+ * to manually capping the frame rate: a frame paced by the clock still isn't
+ * in step with the display refreshing. This solution is more of a stop gap in
+ * case you have to deal with hardware that does not support VSync.
  */
-		frameTicks = LTimer_getTicks(&capTimer);
-		if(frameTicks < SCREEN_TICK_PER_FRAME)
-			SDL_Delay(SCREEN_TICK_PER_FRAME - frameTicks);
+		FramePacer_wait(&pacer);
 	}
 equit:
 	close_all();
@@ -6,7 +6,7 @@
  * basic dot moving around.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
@@ -16,12 +16,6 @@
 #define DOT_JOY_VEL	1
 #define JOYSTICK_DEAD_ZONE	8000
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 /*
  * Here is the struct for the dot we're going to be moving around on the
  * screen.  It has some constants to define its dimensions and velocity. It has
@@ -34,17 +28,14 @@ typedef struct {
 	int mVelX, mVelY;
 } Dot;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
 LTexture gDotTexture;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_GAMECONTROLLER, 0))
 		return -1;
-	}
 
     for (int i = 0; i < SDL_NumJoysticks(); i++) {
         if (SDL_IsGameController(i)) {
@@ -56,98 +47,9 @@ short init(void)
         }
     }
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
 	return 0;
 }
 
-/*
- * In the rendering function we render the dot texture at the dot's position. 
- */
-short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
 /*
  * The constructor simply initializes the variables.
  */
@@ -283,18 +185,12 @@ short loadMedia(void)
 
 void close_all(void)
 {
-	free_texture(&gDotTexture);
+	LTexture_free(&gDotTexture);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
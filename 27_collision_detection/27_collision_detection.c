@@ -5,7 +5,7 @@
  * games, this is usually done with bounding box collision detection.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
@@ -15,12 +15,6 @@
 #define DOT_JOY_VEL	1
 #define JOYSTICK_DEAD_ZONE	8000
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 /*
  * Here is the dot from the motion tutorial with some new features. The move
  * function takes in a rectangle that is the collision box for the wall and the
@@ -34,18 +28,22 @@ typedef struct {
 } Dot;
 
 short checkCollision(SDL_Rect *a, SDL_Rect *b);
+float sweepBoxes(
+			SDL_Rect *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			int *normalX,
+			int *normalY);
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
 LTexture gDotTexture;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_JOYSTICK, 0))
 		return -1;
-	}
 
     for (int i = 0; i < SDL_NumJoysticks(); i++) {
         if (SDL_IsGameController(i)) {
@@ -57,96 +55,9 @@ short init(void)
         }
     }
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
 /*
  * In the contructor we should make sure the collider's dimensions are set. 
  */
@@ -209,41 +120,51 @@ void handle_axis_motion(SDL_Event *e, Dot *d) {
 }
 
 /*
- * Here is the new moving function that now checks if we hit the wall. It works
- * much like before only now it makes the dot move back if we go off the screen
- * or hit the wall.
+ * Here is the new moving function that now checks if we hit the wall.
  *
- * First we move the dot along the x axis, but we also have to change the
- * position of the collider. Whenever we change the dot's position, the
- * collider's position has to follow. Then we check of the dot has gone off
- * screen or hit the wall. If it does we move the dot back along the x axis.
- * Finally, we do this again for motion on the y axis.
+ * Moving the dot and then moving it back if it hit something only works well
+ * when the dot moves a pixel at a time. Any faster and it stops short of the
+ * wall, leaving a gap, and fast enough it jumps clean over the wall without
+ * ever overlapping it. So rather than test where the dot ends up, we sweep
+ * its collider along its velocity and find when during the move it would
+ * first touch the wall. The dot moves that far, leaving it right up against
+ * the wall, and whatever is left of its velocity along the wall is used to
+ * slide along it. Both take a single sweep however fast the dot is going.
+ *
+ * Whenever we change the dot's position, the collider's position has to
+ * follow. Finally we keep the dot on the screen.
  */
 void Dot_move(Dot *d, SDL_Rect *wall)
 {
-	d->mPosX += d->mVelX;
-	d->mCollider.x = d->mPosX;
+	int velX = d->mVelX, velY = d->mVelY;
+	int normalX, normalY, i;
+	float time;
 
-	if(
-			(d->mPosX < 0)
-			|| (d->mPosX + DOT_WIDTH > SCREEN_WIDTH)
-			|| checkCollision(&d->mCollider, wall))
-	{
-		d->mPosX -= d->mVelX;
+	for(i = 0; i < 2 && (velX || velY); ++i) {
+		time = sweepBoxes(&d->mCollider, velX, velY, wall, &normalX, &normalY);
+
+		d->mPosX += (int)SDL_floorf(velX * time + 0.5f);
+		d->mPosY += (int)SDL_floorf(velY * time + 0.5f);
 		d->mCollider.x = d->mPosX;
-	}
+		d->mCollider.y = d->mPosY;
 
-	d->mPosY += d->mVelY;
-	d->mCollider.y = d->mPosY;
+		if(time == 1.f)
+			break;
 
-	if(
-			(d->mPosY < 0)
-			|| (d->mPosY + DOT_HEIGHT > SCREEN_HEIGHT)
-			|| checkCollision(&d->mCollider, wall))
-	{
-		d->mPosY -= d->mVelY;
-		d->mCollider.y = d->mPosY;
+		if(normalX)
+			velX = 0;
+		else
+			velX = (int)SDL_floorf(velX * (1.f - time) + 0.5f);
+		if(normalY)
+			velY = 0;
+		else
+			velY = (int)SDL_floorf(velY * (1.f - time) + 0.5f);
 	}
+
+	d->mPosX = SDL_clamp(d->mPosX, 0, SCREEN_WIDTH - DOT_WIDTH);
+	d->mPosY = SDL_clamp(d->mPosY, 0, SCREEN_HEIGHT - DOT_HEIGHT);
+	d->mCollider.x = d->mPosX;
+	d->mCollider.y = d->mPosY;
 }
 
 /*
@@ -291,6 +212,75 @@ short checkCollision(SDL_Rect *dot, SDL_Rect *wall)
 	return 1;
 }
 
+/*
+ * Here is the swept version of the collision check. For box a moving by
+ * velX, velY it returns the fraction of the move, from 0 to 1, at which a
+ * first touches box b, or 1 if it never does, and sets normalX, normalY to
+ * the side of b that was hit: -1 or 1 on the axis that was hit and 0 on the
+ * other.
+ *
+ * On each axis we work out when the boxes start to overlap, the entry time,
+ * and when they stop, the exit time, by dividing the gaps between their
+ * edges by the velocity. If the box isn't moving on an axis they overlap on
+ * it either always or never. The boxes only overlap while they overlap on
+ * both axes, which starts at the later of the two entry times and ends at
+ * the earlier of the exits; if that doesn't start before it ends, or doesn't
+ * start during this move, there is no hit. Whichever axis entered last is
+ * the side that was hit.
+ *
+ * Boxes that are already overlapping are left alone so they can move apart.
+ */
+float sweepBoxes(
+			SDL_Rect *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			int *normalX,
+			int *normalY)
+{
+	float entryX, entryY, exitX, exitY, entryTime, exitTime;
+
+	*normalX = 0;
+	*normalY = 0;
+
+	if(velX > 0) {
+		entryX = (float)(b->x - (a->x + a->w)) / velX;
+		exitX = (float)(b->x + b->w - a->x) / velX;
+	} else if(velX < 0) {
+		entryX = (float)(b->x + b->w - a->x) / velX;
+		exitX = (float)(b->x - (a->x + a->w)) / velX;
+	} else if(a->x < b->x + b->w && b->x < a->x + a->w) {
+		entryX = -SDL_MAX_SINT32;
+		exitX = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	if(velY > 0) {
+		entryY = (float)(b->y - (a->y + a->h)) / velY;
+		exitY = (float)(b->y + b->h - a->y) / velY;
+	} else if(velY < 0) {
+		entryY = (float)(b->y + b->h - a->y) / velY;
+		exitY = (float)(b->y - (a->y + a->h)) / velY;
+	} else if(a->y < b->y + b->h && b->y < a->y + a->h) {
+		entryY = -SDL_MAX_SINT32;
+		exitY = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	entryTime = SDL_max(entryX, entryY);
+	exitTime = SDL_min(exitX, exitY);
+
+	if(entryTime >= exitTime || entryTime < 0.f || entryTime >= 1.f)
+		return 1.f;
+
+	if(entryX > entryY)
+		*normalX = velX > 0 ? -1 : 1;
+	else
+		*normalY = velY > 0 ? -1 : 1;
+
+	return entryTime;
+}
+
 void Dot_render(Dot *d)
 {
 	LTexture_render(&gDotTexture, d->mPosX, d->mPosY, NULL);
@@ -305,18 +295,12 @@ short loadMedia(void)
 
 void close_all(void)
 {
-	free_texture(&gDotTexture);
+	LTexture_free(&gDotTexture);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
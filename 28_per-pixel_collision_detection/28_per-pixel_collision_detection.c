@@ -5,20 +5,26 @@
  * collision between any two images since all images are made out of
  * rectangles.
  *
- * TODO Note that this implimentation will only work when the DOT_VEL is set to
- * one, if it is set any higher ther is a space between the two dots when a
- * collision is detected.
+ * This implimentation used to only work when the DOT_VEL was set to one; any
+ * higher and there was a space between the two dots when a collision was
+ * detected. The dot is now swept up to the other dot instead, see Dot_move.
+ *
+ * The original version of this tutorial described the dot with a hand made
+ * table of eleven boxes and checked each of one dot's boxes against each of
+ * the other's. Here the collision shape is instead made from the pixels of
+ * the image itself when it is loaded, as a collision mask with one bit per
+ * pixel, which is both exact and much cheaper to check.
  */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
-#define ZONES			11
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 #define DOT_WIDTH		20
 #define DOT_HEIGHT		20
-#define DOT_VEL			1
+#define DOT_VEL			5
 #define JOYSTICK_DEAD_ZONE	8000
+#define MASK_ALPHA		128
 
 typedef struct {
 	SDL_Texture *mTexture;
@@ -29,36 +35,56 @@ typedef struct {
 /*
  * Everything can be made out of rectangles in a video game, even this dot.
  * Images are made out of pixels which are squares which are rectangles. To do
- * per-pixel collision detection all we have to do is have each object have a
- * set of box colliders and check collision of one set of collision boxes
- * against another.
- *
- * Here is our dot now with per-pixel collision detection. Its velocity is
- * reduced to 1 pixel per frame to make the collision easier to see. The move
- * function now takes in a vector of collision boxes so we can check two sets
- * against each other. Since we're going to have two dots colliding, we need to
- * be able to get the colliders so we have a function for that.
+ * per-pixel collision detection we need to know which pixels of each image
+ * are solid and check whether any solid pixel of one lands on a solid pixel
+ * of the other.
  *
- * Instead of having a single collision box, we have a vector of colliders. We
- * also have a related function to shift the colliders to match the position of
- * the dot.
- *
- * We also have our new collision detector that checks sets of collision boxes
- * against each other.
+ * A collision mask stores one bit for every pixel of an image, set if the
+ * pixel is solid. Each row is packed into 64 bit words, mWords of them, with
+ * the leftmost pixel in the highest bit of the first word, so a whole row of
+ * a small sprite is a single number. Checking two rows against each other is
+ * then one shift to line them up and one AND, rather than a test per pixel.
+ */
+typedef struct {
+	Uint64 *mBits;
+	int mWidth, mHeight;
+	int mWords;
+} CollisionMask;
+
+/*
+ * Here is our dot now with per-pixel collision detection. Instead of a
+ * collision box, it has the collision mask of its image, and the move
+ * function takes in the other dot so we can check the two masks against each
+ * other. The dot moves DOT_VEL pixels a frame and is swept up to the other
+ * dot, so it stops right against it however fast it goes.
  */
 typedef struct {
 	int mPosX, mPosY;
 	int mVelX, mVelY;
-	SDL_Rect mColliders[ZONES];
+	CollisionMask *mMask;
 } Dot;
 
-short checkCollision(SDL_Rect *a, SDL_Rect *b);
-void Dot_shiftColliders(Dot *d);
+short CollisionMask_fromSurface(CollisionMask *mask, SDL_Surface *surface);
+float sweepBoxes(
+			SDL_Rect *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			int *normalX,
+			int *normalY);
+short CollisionMask_overlap(
+				CollisionMask *a,
+				int ax,
+				int ay,
+				CollisionMask *b,
+				int bx,
+				int by);
 
 SDL_Window* gWindow = NULL;
 SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
 LTexture gDotTexture;
+CollisionMask gDotMask;
 
 short init(void)
 {
@@ -120,7 +146,11 @@ LTexture *free_texture(LTexture *lt)
 	return lt;
 }
 
-short LTexture_loadFromFile(LTexture *lt, char *path)
+/*
+ * When given a mask, the loading function also builds the collision mask
+ * from the image once it is color keyed, before the surface is freed.
+ */
+short LTexture_loadFromFile(LTexture *lt, char *path, CollisionMask *mask)
 {
 	free_texture(lt);
 
@@ -138,6 +168,11 @@ short LTexture_loadFromFile(LTexture *lt, char *path)
 			SDL_TRUE,
 			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
 
+	if(mask && CollisionMask_fromSurface(mask, loadedSurface)) {
+		SDL_FreeSurface(loadedSurface);
+		return -1;
+	}
+
 	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
 	if(newTexture == NULL) {
 		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
@@ -168,10 +203,141 @@ short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
 }
 
 /*
- * Just like before, we have to set the collider dimensions in the constructor.
- * Only difference here is that we have multiple collision boxes to set.
+ * The mask constructor allocates a cleared mask for a width by height image.
+ */
+short CollisionMask_init(CollisionMask *mask, int width, int height)
+{
+	mask->mWords = (width + 63) / 64;
+	mask->mBits = calloc(mask->mWords * height, sizeof(Uint64));
+	if(mask->mBits == NULL) {
+		SDL_Log("%s(), calloc failed.", __func__);
+		return -1;
+	}
+
+	mask->mWidth = width;
+	mask->mHeight = height;
+
+	return 0;
+}
+
+void CollisionMask_free(CollisionMask *mask)
+{
+	free(mask->mBits);
+	mask->mBits = NULL;
+	mask->mWidth = 0;
+	mask->mHeight = 0;
+	mask->mWords = 0;
+}
+
+void CollisionMask_set(CollisionMask *mask, int x, int y)
+{
+	mask->mBits[y * mask->mWords + x / 64] |= (Uint64)1 << (63 - x % 64);
+}
+
+/*
+ * To build the mask we convert the surface to 32 bit RGBA so that every image
+ * can be read the same way. Converting a color keyed surface to a format
+ * with alpha makes the keyed pixels transparent, so all we need to look at is
+ * the alpha of each pixel: anything at least MASK_ALPHA opaque is solid.
+ */
+short CollisionMask_fromSurface(CollisionMask *mask, SDL_Surface *surface)
+{
+	SDL_Surface *rgba;
+	Uint32 *row;
+	Uint8 r, g, b, a;
+	int x, y;
+
+	rgba = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA8888, 0);
+	if(rgba == NULL) {
+		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	if(CollisionMask_init(mask, rgba->w, rgba->h)) {
+		SDL_FreeSurface(rgba);
+		return -1;
+	}
+
+	SDL_LockSurface(rgba);
+	for(y = 0; y < rgba->h; ++y) {
+		row = (Uint32*)((Uint8*)rgba->pixels + y * rgba->pitch);
+		for(x = 0; x < rgba->w; ++x) {
+			SDL_GetRGBA(row[x], rgba->format, &r, &g, &b, &a);
+			if(a >= MASK_ALPHA)
+				CollisionMask_set(mask, x, y);
+		}
+	}
+	SDL_UnlockSurface(rgba);
+
+	SDL_FreeSurface(rgba);
+
+	return 0;
+}
+
+/*
+ * Returns the 64 pixels of a mask row starting at pixel x, which may be off
+ * either end of the row, as a word lined up the same way as the mask's own
+ * words. Pixels outside the row are empty. When x isn't on a word boundary
+ * the result is pieced together from the two words it straddles.
+ */
+Uint64 CollisionMask_rowBits(CollisionMask *mask, Uint64 *row, int x)
+{
+	int word = x >= 0 ? x / 64 : -((63 - x) / 64);
+	int shift = x - word * 64;
+	Uint64 bits = 0;
+
+	if(word >= 0 && word < mask->mWords)
+		bits = row[word] << shift;
+	if(shift && word + 1 >= 0 && word + 1 < mask->mWords)
+		bits |= row[word + 1] >> (64 - shift);
+
+	return bits;
+}
+
+/*
+ * Here in our collision detection function we check mask a at ax, ay against
+ * mask b at bx, by. First we check the boxes of the two images, and if they
+ * don't overlap there can't be a collision. Otherwise we walk the rows where
+ * they overlap, and for every word of a's row we fetch the 64 pixels of b's
+ * row that sit under it; if the two words share a set bit, a solid pixel
+ * lands on a solid pixel and there is a collision.
+ */
+short CollisionMask_overlap(
+				CollisionMask *a,
+				int ax,
+				int ay,
+				CollisionMask *b,
+				int bx,
+				int by)
+{
+	Uint64 *rowA, *rowB;
+	int top, bottom, first, last, y, w;
+
+	if(ax + a->mWidth <= bx || bx + b->mWidth <= ax
+			|| ay + a->mHeight <= by || by + b->mHeight <= ay)
+		return 0;
+
+	top = SDL_max(ay, by);
+	bottom = SDL_min(ay + a->mHeight, by + b->mHeight);
+	first = (SDL_max(ax, bx) - ax) / 64;
+	last = (SDL_min(ax + a->mWidth, bx + b->mWidth) - ax - 1) / 64;
+
+	for(y = top; y < bottom; ++y) {
+		rowA = a->mBits + (y - ay) * a->mWords;
+		rowB = b->mBits + (y - by) * b->mWords;
+		for(w = first; w <= last; ++w)
+			if(rowA[w] & CollisionMask_rowBits(b, rowB, ax - bx + w * 64))
+				return 1;
+	}
+
+	return 0;
+}
+
+/*
+ * The constructor now takes the collision mask the dot uses, which is
+ * shared by every dot with the same image.
  */
-void Dot_init(Dot *d, int x, int y)
+void Dot_init(Dot *d, int x, int y, CollisionMask *mask)
 {
 	d->mPosX = x;
 	d->mPosY = y;
@@ -179,30 +345,18 @@ void Dot_init(Dot *d, int x, int y)
 	d->mVelX = 0;
 	d->mVelY = 0;
 
-	d->mColliders[0].w = 6;
-	d->mColliders[0].h = 1;
-	d->mColliders[1].w = 10;
-	d->mColliders[1].h = 1;
-	d->mColliders[2].w = 14;
-	d->mColliders[2].h = 1;
-	d->mColliders[3].w = 16;
-	d->mColliders[3].h = 2;
-	d->mColliders[4].w = 18;
-	d->mColliders[4].h = 2;
-	d->mColliders[5].w = 20;
-	d->mColliders[5].h = 6;
-	d->mColliders[6].w = 18;
-	d->mColliders[6].h = 2;
-	d->mColliders[7].w = 16;
-	d->mColliders[7].h = 2;
-	d->mColliders[8].w = 14;
-	d->mColliders[8].h = 1;
-	d->mColliders[9].w = 10;
-	d->mColliders[9].h = 1;
-	d->mColliders[10].w = 6;
-	d->mColliders[10].h = 1;
-
-	Dot_shiftColliders(d);
+	d->mMask = mask;
+}
+
+short Dot_collides(Dot *a, Dot *b)
+{
+	return CollisionMask_overlap(
+			a->mMask,
+			a->mPosX,
+			a->mPosY,
+			b->mMask,
+			b->mPosX,
+			b->mPosY);
 }
 
 void handle_keyboard_events(Dot *d, SDL_Event *e)
@@ -276,121 +430,135 @@ void handle_axis_motion(SDL_Event *e, Dot *d) {
 }
 
 /*
- * This functions pretty much the same as before. Whenever we move the dot, we
- * move the collider(s) with it. After we move the dot, we check if it went off
- * screen or hit something. If it did, we move the dot back and move its
- * colliders with it.
- *
- * n't worry too much about how shiftColliders works. It's a short hand way of
- * mColliders[ 0 ].x = ..., mColliders[ 1 ].x = ..., etc and it works for this
- * specific case. For your own per-pixel objects you'll have your own placing
- * functions.
- *
- * And after shiftColliders, have an accessor function to get the colliders.
+ * The swept box check, explained in 27_collision_detection.
  */
-void Dot_move(Dot *d, SDL_Rect *otherColliders)
-{
-	d->mPosX += d->mVelX;
-	Dot_shiftColliders(d);
-
-	if(
-			(d->mPosX < 0)
-			|| (d->mPosX + DOT_WIDTH > SCREEN_WIDTH)
-			|| checkCollision(d->mColliders, otherColliders))
-	{
-		d->mPosX -= d->mVelX;
-		Dot_shiftColliders(d);
-	}
-
-	d->mPosY += d->mVelY;
-	Dot_shiftColliders(d);
-
-	if(
-			(d->mPosY < 0)
-			|| (d->mPosY + DOT_HEIGHT > SCREEN_HEIGHT)
-			|| checkCollision(d->mColliders, otherColliders))
-	{
-		d->mPosY -= d->mVelY;
-		Dot_shiftColliders(d);
-	}
-}
-
-void Dot_render(Dot *d)
+float sweepBoxes(
+			SDL_Rect *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			int *normalX,
+			int *normalY)
 {
-	LTexture_render(&gDotTexture, d->mPosX, d->mPosY, NULL);
+	float entryX, entryY, exitX, exitY, entryTime, exitTime;
+
+	*normalX = 0;
+	*normalY = 0;
+
+	if(velX > 0) {
+		entryX = (float)(b->x - (a->x + a->w)) / velX;
+		exitX = (float)(b->x + b->w - a->x) / velX;
+	} else if(velX < 0) {
+		entryX = (float)(b->x + b->w - a->x) / velX;
+		exitX = (float)(b->x - (a->x + a->w)) / velX;
+	} else if(a->x < b->x + b->w && b->x < a->x + a->w) {
+		entryX = -SDL_MAX_SINT32;
+		exitX = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	if(velY > 0) {
+		entryY = (float)(b->y - (a->y + a->h)) / velY;
+		exitY = (float)(b->y + b->h - a->y) / velY;
+	} else if(velY < 0) {
+		entryY = (float)(b->y + b->h - a->y) / velY;
+		exitY = (float)(b->y - (a->y + a->h)) / velY;
+	} else if(a->y < b->y + b->h && b->y < a->y + a->h) {
+		entryY = -SDL_MAX_SINT32;
+		exitY = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	entryTime = SDL_max(entryX, entryY);
+	exitTime = SDL_min(exitX, exitY);
+
+	if(entryTime >= exitTime || entryTime < 0.f || entryTime >= 1.f)
+		return 1.f;
+
+	if(entryX > entryY)
+		*normalX = velX > 0 ? -1 : 1;
+	else
+		*normalY = velY > 0 ? -1 : 1;
+
+	return entryTime;
 }
 
 /*
- * Don't worry too much about how shiftColliders works. It's a short hand way
- * of mColliders[ 0 ].x = ..., mColliders[ 1 ].x = ..., etc and it works for
- * this specific case. For your own per-pixel objects you'll have your own
- * placing functions.
- *
- * And after shiftColliders, have an accessor function to get the colliders.
+ * Moving the dot and moving it back if it hit the other dot leaves a gap of
+ * up to the dot's speed between them, and a dot faster than the other dot is
+ * wide could jump right over it. Instead the dot is moved along one axis at
+ * a time by Dot_moveAxis, which first sweeps the dot's box against the
+ * other dot's box. Until the boxes touch the masks can't, so the dot jumps
+ * straight there in one step. Only while the boxes overlap do we step a
+ * pixel at a time, checking the masks, and as soon as the dot is clear of
+ * the other box the rest of the move is made at once. However fast the dot
+ * goes, there are never more steps than the width of the two boxes.
  */
-void Dot_shiftColliders(Dot *d)
+void Dot_moveAxis(Dot *d, Dot *other, int velX, int velY)
 {
-	int zone, r;
-	r = 0;
-
-	for(zone = 0; zone < ZONES; ++zone)
-	{
-		d->mColliders[zone].x =
-			d->mPosX + (DOT_WIDTH - d->mColliders[zone].w) / 2;
-
-		d->mColliders[zone].y = d->mPosY + r;
+	SDL_Rect a = { d->mPosX, d->mPosY, d->mMask->mWidth, d->mMask->mHeight };
+	SDL_Rect b = {
+		other->mPosX,
+		other->mPosY,
+		other->mMask->mWidth,
+		other->mMask->mHeight };
+	int stepX = SDL_clamp(velX, -1, 1), stepY = SDL_clamp(velY, -1, 1);
+	int distance = SDL_abs(velX + velY), normalX, normalY, moved;
+
+	if(SDL_HasIntersection(&a, &b))
+		moved = 0;
+	else
+		moved = (int)SDL_floorf(distance
+				* sweepBoxes(&a, velX, velY, &b, &normalX, &normalY) + 0.5f);
+
+	d->mPosX += stepX * moved;
+	d->mPosY += stepY * moved;
+
+	for(; moved < distance; ++moved) {
+		a.x = d->mPosX + stepX;
+		a.y = d->mPosY + stepY;
+		if(!SDL_HasIntersection(&a, &b)) {
+			d->mPosX += stepX * (distance - moved);
+			d->mPosY += stepY * (distance - moved);
+			break;
+		}
 
-		r += d->mColliders[zone].h;
+		d->mPosX += stepX;
+		d->mPosY += stepY;
+		if(Dot_collides(d, other)) {
+			d->mPosX -= stepX;
+			d->mPosY -= stepY;
+			break;
+		}
 	}
 }
 
 /*
- * Here in our collision detection function, we have a for loop that calculates
- * the top/bottom/left/right of each collision box in object a. 
- *
- * We then check calculate the top/bottom/left/right of each collision box in
- * object b. We then check if there is no separating axis. If this no
- * separating axis, we return true. If we get through both sets without a
- * collision, we return false.
+ * The move is kept on the screen before it is made, and then made along the
+ * x axis and then the y axis just as before.
  */
-short checkCollision(SDL_Rect *a, SDL_Rect *b)
+void Dot_move(Dot *d, Dot *other)
 {
-	int leftA, leftB;
-	int rightA, rightB;
-	int topA, topB;
-	int bottomA, bottomB;
-	int Abox, Bbox;
-
-	for(Abox = 0; Abox < ZONES; Abox++ )
-	{
-		leftA = a[Abox].x;
-		rightA = a[Abox].x + a[Abox].w;
-		topA = a[Abox].y;
-		bottomA = a[Abox].y + a[Abox].h;
-
-		for(Bbox = 0; Bbox < ZONES; Bbox++ )
-		{
-			leftB = b[Bbox].x;
-			rightB = b[Bbox].x + b[Bbox].w;
-			topB = b[Bbox].y;
-			bottomB = b[Bbox].y + b[Bbox].h;
-
-			if(
-					((bottomA <= topB)
-					|| (topA >= bottomB)
-					|| (rightA <= leftB)
-					|| (leftA >= rightB))
-					== 0)
-				return 1;
-		}
-	}
+	Dot_moveAxis(
+			d,
+			other,
+			SDL_clamp(d->mPosX + d->mVelX, 0, SCREEN_WIDTH - DOT_WIDTH) - d->mPosX,
+			0);
+	Dot_moveAxis(
+			d,
+			other,
+			0,
+			SDL_clamp(d->mPosY + d->mVelY, 0, SCREEN_HEIGHT - DOT_HEIGHT) - d->mPosY);
+}
 
-	return 0;
+void Dot_render(Dot *d)
+{
+	LTexture_render(&gDotTexture, d->mPosX, d->mPosY, NULL);
 }
 
 short loadMedia(void)
 {
-	if(LTexture_loadFromFile(&gDotTexture, "dot.bmp"))
+	if(LTexture_loadFromFile(&gDotTexture, "dot.bmp", &gDotMask))
 		return -1;
 	return 0;
 }
@@ -398,6 +566,7 @@ short loadMedia(void)
 void close_all(void)
 {
 	free_texture(&gDotTexture);
+	CollisionMask_free(&gDotMask);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
@@ -418,6 +587,7 @@ void close_all(void)
  * Once again in the main loop we handle events for the dot, move with
  * collision check for the dot, and then finally we render our objects.
  */
+#ifndef BENCHMARK
 int main(int argc, char* argv[])
 {
 	if(init())
@@ -429,10 +599,10 @@ int main(int argc, char* argv[])
 	SDL_Event e;
 
 	Dot dot;
-	Dot_init(&dot, 0, 0);
+	Dot_init(&dot, 0, 0, &gDotMask);
 	
 	Dot otherDot;
-	Dot_init(&otherDot, SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4);
+	Dot_init(&otherDot, SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, &gDotMask);
 	
 	while(1)
 	{
@@ -461,7 +631,7 @@ int main(int argc, char* argv[])
 			}
 		}
 
-		Dot_move(&dot, otherDot.mColliders);
+		Dot_move(&dot, &otherDot);
 
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
@@ -477,6 +647,123 @@ equit:
 
 	return 0;
 }
+#else
+/*
+ * Collision mask benchmark
+ *
+ * Building with -DBENCHMARK (make bench) swaps the demo for this main, which
+ * needs no window. It draws a disc the size of the dot into a mask, then
+ * checks two dots against each other at random offsets around each other,
+ * once with the masks and once with the table of eleven boxes this tutorial
+ * used to describe the dot with, checking every box against every box. It
+ * prints checks per second for each, and also checks the masks against a
+ * plain test of every pixel, which should never disagree.
+ */
+#define BENCH_CHECKS		10000000
+#define BENCH_ZONES		11
+
+short bench_boxes(SDL_Rect *a, SDL_Rect *b)
+{
+	int i, j;
+	for(i = 0; i < BENCH_ZONES; ++i)
+		for(j = 0; j < BENCH_ZONES; ++j)
+			if(a[i].y + a[i].h > b[j].y && a[i].y < b[j].y + b[j].h
+					&& a[i].x + a[i].w > b[j].x && a[i].x < b[j].x + b[j].w)
+				return 1;
+	return 0;
+}
+
+void bench_placeBoxes(SDL_Rect *boxes, int *widths, int *heights, int x, int y)
+{
+	int i;
+	for(i = 0; i < BENCH_ZONES; ++i) {
+		boxes[i].x = x + (DOT_WIDTH - widths[i]) / 2;
+		boxes[i].y = y;
+		boxes[i].w = widths[i];
+		boxes[i].h = heights[i];
+		y += heights[i];
+	}
+}
+
+short bench_pixels(CollisionMask *m, int dx, int dy)
+{
+	int x, y;
+	for(y = 0; y < m->mHeight; ++y)
+		for(x = 0; x < m->mWidth; ++x)
+			if(x - dx >= 0 && x - dx < m->mWidth
+					&& y - dy >= 0 && y - dy < m->mHeight
+					&& (m->mBits[y * m->mWords] >> (63 - x)) & 1
+					&& (m->mBits[(y - dy) * m->mWords] >> (63 - (x - dx))) & 1)
+				return 1;
+	return 0;
+}
+
+double bench_seconds(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start)
+		/ SDL_GetPerformanceFrequency();
+}
+
+int main(int argc, char* argv[])
+{
+	int widths[BENCH_ZONES] = { 6, 10, 14, 16, 18, 20, 18, 16, 14, 10, 6 };
+	int heights[BENCH_ZONES] = { 1, 1, 1, 2, 2, 6, 2, 2, 1, 1, 1 };
+	SDL_Rect boxesA[BENCH_ZONES], boxesB[BENCH_ZONES];
+	CollisionMask mask;
+	int *dx, *dy, x, y, i, hits, mismatches = 0;
+	Uint64 start;
+	double maskTime, boxTime;
+
+	if(CollisionMask_init(&mask, DOT_WIDTH, DOT_HEIGHT))
+		return 1;
+
+	for(y = 0; y < DOT_HEIGHT; ++y)
+		for(x = 0; x < DOT_WIDTH; ++x)
+			if((2 * x + 1 - DOT_WIDTH) * (2 * x + 1 - DOT_WIDTH)
+					+ (2 * y + 1 - DOT_HEIGHT) * (2 * y + 1 - DOT_HEIGHT)
+					<= DOT_WIDTH * DOT_HEIGHT)
+				CollisionMask_set(&mask, x, y);
+
+	dx = malloc(BENCH_CHECKS * sizeof(int));
+	dy = malloc(BENCH_CHECKS * sizeof(int));
+	if(dx == NULL || dy == NULL)
+		return 1;
+
+	srand(1);
+	for(i = 0; i < BENCH_CHECKS; ++i) {
+		dx[i] = rand() % (DOT_WIDTH * 2 + 1) - DOT_WIDTH;
+		dy[i] = rand() % (DOT_HEIGHT * 2 + 1) - DOT_HEIGHT;
+	}
+
+	for(i = 0; i < BENCH_CHECKS / 100; ++i)
+		if(CollisionMask_overlap(&mask, 0, 0, &mask, dx[i], dy[i])
+				!= bench_pixels(&mask, dx[i], dy[i]))
+			mismatches++;
+
+	start = SDL_GetPerformanceCounter();
+	for(hits = 0, i = 0; i < BENCH_CHECKS; ++i)
+		hits += CollisionMask_overlap(&mask, 0, 0, &mask, dx[i], dy[i]);
+	maskTime = bench_seconds(start);
+	SDL_Log("Masks: %.1fM checks/s, %d hits, %d mismatches against pixels",
+			BENCH_CHECKS / maskTime / 1e6, hits, mismatches);
+
+	bench_placeBoxes(boxesA, widths, heights, 0, 0);
+	start = SDL_GetPerformanceCounter();
+	for(hits = 0, i = 0; i < BENCH_CHECKS; ++i) {
+		bench_placeBoxes(boxesB, widths, heights, dx[i], dy[i]);
+		hits += bench_boxes(boxesA, boxesB);
+	}
+	boxTime = bench_seconds(start);
+	SDL_Log("Boxes: %.1fM checks/s, %d hits (%.1fx slower)",
+			BENCH_CHECKS / boxTime / 1e6, hits, boxTime / maskTime);
+
+	CollisionMask_free(&mask);
+	free(dx);
+	free(dy);
+
+	return 0;
+}
+#endif
 
 /*
  * A questions I get asked a lot is how to make a function that loads an image
@@ -486,18 +773,20 @@ equit:
  * Don't.
  * 
  * In most games, you don't want 100% accuracy. The more collision boxes you
- * have the more collision checks you have and the slower it is. What most
- * games go for is close enough, like in Street Fighter:
+ * have the more collision checks you have and the slower it is. That is why
+ * this tutorial generates a bit mask instead: however detailed the image, a
+ * row of up to 64 pixels costs a single AND. What most games go for is close
+ * enough, like in Street Fighter:
  * 
  * The results are not pixel perfect but they are close enough.
  * 
- * Also there's one optimization we could have done here. We could have had a
- * bounding box for the dot that encapsulates all the other collision boxes and
- * then checks that one first before getting to the per-pixel collison boxes.
- * This does add one more collision detection, but since it is much more likely
- * that two objects do not collide it will more likely save us additional
- * collision detection. In games, this is usually done with a tree structure
- * that has different levels of detail to allow for early outs to prevent
- * unneeded checks at the per-pixel level. Like in previous tutorials, tree
- * structures are outside the scope of these tutorials.
+ * Also notice that CollisionMask_overlap checks the bounding boxes of the two
+ * masks first, before looking at a single row of bits. This does add one more
+ * collision check, but since it is much more likely that two objects do not
+ * collide it will more likely save us the per-pixel ones, and when the boxes
+ * do overlap only the rows and words inside both are compared. In games,
+ * this is usually taken further with a tree structure that has different
+ * levels of detail to allow for early outs to prevent unneeded checks at the
+ * per-pixel level. Like in previous tutorials, tree structures are outside the
+ * scope of these tutorials.
  */
@@ -19,12 +19,27 @@
  * Using the distance squared instead of the distance is an optimization we'll
  * go into more detail later.
  *
- * TODO work over the math in this example to understand exactly what is
- * happening and improve the collision detection, as with the pervious example
- * the detection fails when the velocity is greater than one.
+ * As with the previous examples, moving the dot and moving it back when it
+ * hits something fails when the velocity is greater than one, leaving gaps
+ * or letting the dot pass through things, so Dot_move now sweeps the dot's
+ * circle along its velocity to find exactly when it would touch.
+ *
+ * Checking one dot against a box and a circle is cheap, but checking every
+ * object in a scene against every other object costs n * (n - 1) / 2 tests,
+ * which for ten thousand objects is fifty million tests a frame. At the end
+ * of this tutorial is a broad phase that finds the few pairs of objects that
+ * are close enough to possibly collide, so that only those are passed on to
+ * the collision tests above. The demo shows it working on a crowd of boxes
+ * and circles drifting around the screen.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+
+#include "ltut.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define COLLISION_X86
+#include <immintrin.h>
+#endif
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
@@ -33,6 +48,15 @@
 #define DOT_VEL			5
 #define DOT_JOY_VEL		1
 #define JOYSTICK_DEAD_ZONE	10000
+#define CROWD_SIZE		300
+#define CROWD_CELL		40
+
+/*
+ * A headless run scatters the crowd from a fixed seed, and the scripted dot
+ * turns a quarter turn every HEADLESS_TURN ticks.
+ */
+#define HEADLESS_SEED	0x5EED
+#define HEADLESS_TURN	30
 
 /*
  * SDL has a built in rectangle structure, but we have to make our own circle
@@ -43,12 +67,6 @@ typedef struct {
 	int r;
 } Circle;
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 /*
  * Here is the dot struct from previous collision detection tutorials with some
  * more additons. The related move function takes in a circle and a rectangle
@@ -61,22 +79,109 @@ typedef struct {
 	Circle mCollider;
 } Dot;
 
+/*
+ * A body is anything the broad phase can collide, either a box or a circle.
+ * Whatever its shape every body has a bounding box, which for a box is the
+ * box itself; the broad phase only ever looks at the bounding boxes.
+ */
+enum BodyShapes {
+	BODY_BOX,
+	BODY_CIRCLE
+};
+
+typedef struct {
+	int mShape;
+	SDL_Rect mBox;
+	Circle mCircle;
+	int mVelX, mVelY;
+} Body;
+
+/*
+ * The broad phase lays a uniform grid of mCellSize square cells over the
+ * world and files every body under each cell its bounding box overlaps. Only
+ * bodies that share a cell can be touching, so those are the only pairs that
+ * need to be tested. The bodies in each cell are kept together in one array,
+ * mEntries, with mCellStart giving where each cell's bodies begin; the
+ * colliding pairs found are gathered in mPairs.
+ */
+typedef struct {
+	int mA, mB;
+} BodyPair;
+
+typedef struct {
+	int mCellSize;
+	int mColumns, mRows;
+	int *mCellStart;
+	int *mEntries;
+	int mEntryCapacity;
+	BodyPair *mPairs;
+	int mPairCount;
+	int mPairCapacity;
+} BroadPhase;
+
+short checkCollision(SDL_Rect *a, SDL_Rect *b);
+/*
+ * The batch collision checks test one circle against a whole array of
+ * circles or boxes at once. The array is given as separate arrays of x
+ * positions, y positions and radii, or x, y, widths and heights, so that a
+ * vector of positions can be loaded straight from memory. The result is a
+ * bit mask with one bit per circle or box, set if it collides, packed 32 to
+ * a word, so hits needs room for (count + 31) / 32 words.
+ *
+ * As with the particle integrator, there is a plain C version and, on x86,
+ * an SSE2 and an AVX2 version; gCheckCircBatch and gCheckRectBatch point at
+ * the best ones the CPU supports.
+ */
+typedef void (*CircBatchCheck)(
+				Circle *a,
+				int *x,
+				int *y,
+				int *r,
+				int count,
+				Uint32 *hits);
+
+typedef void (*RectBatchCheck)(
+				Circle *a,
+				int *x,
+				int *y,
+				int *w,
+				int *h,
+				int count,
+				Uint32 *hits);
+
 short check_collision_circ(Circle *a, Circle *b);
 short check_collision_rect(Circle *a, SDL_Rect *b);
-double distanceSquared(int x1, int y1, int x2, int y2);
+int distanceSquared(int x1, int y1, int x2, int y2);
 void Dot_shiftColliders(Dot *d);
+void select_collision_batch(void);
+float sweepCircles(
+			Circle *a,
+			int velX,
+			int velY,
+			Circle *b,
+			float *normalX,
+			float *normalY);
+float sweepCircleBox(
+			Circle *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			float *normalX,
+			float *normalY);
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
 LTexture gDotTexture;
+CircBatchCheck gCheckCircBatch = NULL;
+RectBatchCheck gCheckRectBatch = NULL;
+Headless gHeadless = { 0, 1, 0 };
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_GAMECONTROLLER,
+				LTUT_VSYNC
+				| (gHeadless.mTicks > 0 ? LTUT_HEADLESS : 0)))
 		return -1;
-	}
 
     for (int i = 0; i < SDL_NumJoysticks(); i++) {
         if (SDL_IsGameController(i)) {
@@ -88,97 +193,11 @@ short init(void)
         }
     }
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	free_texture(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
-
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
-
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
+	select_collision_batch();
 
 	return 0;
 }
 
-short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
 /*
  * The init function takes in a position and initializes the colliders and
  * velocity.
@@ -197,38 +216,55 @@ void Dot_init(Dot *d, int x, int y)
 }
 
 /*
- * Like in previous collision detection tutorials, we move along the x axis,
- * check collision against the edges of the screen, and check against the other
- * scene objects. If the dot hit something we move back. As always, whenever
- * the dot moves its colliders move with it.
+ * Rather than move and check, we sweep the dot's circle along its velocity
+ * against the box and the other circle and take whichever it would touch
+ * first. The dot moves up to that point and the rest of its velocity, less
+ * the part heading into what it hit, slides it along the surface; a second
+ * sweep stops the slide running into anything else. As always, whenever the
+ * dot moves its colliders move with it. Finally we keep it on the screen.
  *
- * Then we do this again for the y axis.
+ * The dot's position is whole pixels, so rounding can leave it a fraction of
+ * a pixel inside what it hit. If it does we back it up a pixel at a time
+ * towards where it started until it is clear.
  */
 void Dot_move(Dot *d, SDL_Rect *square, Circle *circle)
 {
-	d->mPosX += d->mVelX;
-	Dot_shiftColliders(d);
+	int startX = d->mPosX, startY = d->mPosY;
+	int velX = d->mVelX, velY = d->mVelY, i;
+	float time, hit, normalX = 0.f, normalY = 0.f, hitX, hitY, slide, restX, restY;
+
+	for(i = 0; i < 2 && (velX || velY); ++i) {
+		time = sweepCircleBox(&d->mCollider, velX, velY, square, &normalX, &normalY);
+		hit = sweepCircles(&d->mCollider, velX, velY, circle, &hitX, &hitY);
+		if(hit < time) {
+			time = hit;
+			normalX = hitX;
+			normalY = hitY;
+		}
 
-	if(
-			(d->mPosX - d->mCollider.r < 0)
-			|| (d->mPosX + d->mCollider.r > SCREEN_WIDTH)
-			|| check_collision_rect(&d->mCollider, square)
-			|| check_collision_circ(&d->mCollider, circle))
-	{
-		d->mPosX -= d->mVelX;
+		d->mPosX += (int)SDL_floorf(velX * time + 0.5f);
+		d->mPosY += (int)SDL_floorf(velY * time + 0.5f);
 		Dot_shiftColliders(d);
+
+		if(time == 1.f)
+			break;
+
+		restX = velX * (1.f - time);
+		restY = velY * (1.f - time);
+		slide = restX * normalX + restY * normalY;
+		velX = (int)SDL_floorf(restX - slide * normalX + 0.5f);
+		velY = (int)SDL_floorf(restY - slide * normalY + 0.5f);
 	}
 
-	d->mPosY += d->mVelY;
+	d->mPosX = SDL_clamp(d->mPosX, d->mCollider.r, SCREEN_WIDTH - d->mCollider.r);
+	d->mPosY = SDL_clamp(d->mPosY, d->mCollider.r, SCREEN_HEIGHT - d->mCollider.r);
 	Dot_shiftColliders(d);
 
-	if(
-			(d->mPosY - d->mCollider.r < 0)
-			|| (d->mPosY + d->mCollider.r > SCREEN_HEIGHT)
-			|| check_collision_rect(&d->mCollider, square)
-			|| check_collision_circ(&d->mCollider, circle))
-	{
-		d->mPosY -= d->mVelY;
+	while((check_collision_rect(&d->mCollider, square)
+				|| check_collision_circ(&d->mCollider, circle))
+			&& (d->mPosX != startX || d->mPosY != startY)) {
+		d->mPosX += (startX > d->mPosX) - (startX < d->mPosX);
+		d->mPosY += (startY > d->mPosY) - (startY < d->mPosY);
 		Dot_shiftColliders(d);
 	}
 }
@@ -258,6 +294,9 @@ void Dot_render(Dot *d)
  * square root is a relatively expensive operation. Fortunately if x > y then
  * x^2 > y^2, so we can save a square root operation by just comparing the
  * distance squared.
+ *
+ * Everything here is whole numbers, so there is no conversion to floating
+ * point and the compare is a plain integer compare.
  */
 short check_collision_circ(Circle *a, Circle *b)
 {
@@ -270,6 +309,153 @@ short check_collision_circ(Circle *a, Circle *b)
 	return 0;
 }
 
+/*
+ * The swept box check, explained in 27_collision_detection.
+ */
+float sweepBoxes(
+			SDL_Rect *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			int *normalX,
+			int *normalY)
+{
+	float entryX, entryY, exitX, exitY, entryTime, exitTime;
+
+	*normalX = 0;
+	*normalY = 0;
+
+	if(velX > 0) {
+		entryX = (float)(b->x - (a->x + a->w)) / velX;
+		exitX = (float)(b->x + b->w - a->x) / velX;
+	} else if(velX < 0) {
+		entryX = (float)(b->x + b->w - a->x) / velX;
+		exitX = (float)(b->x - (a->x + a->w)) / velX;
+	} else if(a->x < b->x + b->w && b->x < a->x + a->w) {
+		entryX = -SDL_MAX_SINT32;
+		exitX = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	if(velY > 0) {
+		entryY = (float)(b->y - (a->y + a->h)) / velY;
+		exitY = (float)(b->y + b->h - a->y) / velY;
+	} else if(velY < 0) {
+		entryY = (float)(b->y + b->h - a->y) / velY;
+		exitY = (float)(b->y - (a->y + a->h)) / velY;
+	} else if(a->y < b->y + b->h && b->y < a->y + a->h) {
+		entryY = -SDL_MAX_SINT32;
+		exitY = SDL_MAX_SINT32;
+	} else
+		return 1.f;
+
+	entryTime = SDL_max(entryX, entryY);
+	exitTime = SDL_min(exitX, exitY);
+
+	if(entryTime >= exitTime || entryTime < 0.f || entryTime >= 1.f)
+		return 1.f;
+
+	if(entryX > entryY)
+		*normalX = velX > 0 ? -1 : 1;
+	else
+		*normalY = velY > 0 ? -1 : 1;
+
+	return entryTime;
+}
+
+/*
+ * The swept circle check finds when during a move of velX, velY circle a
+ * first touches circle b. The circles touch when the distance between their
+ * centers is the sum of their radii, so with d the offset from b's center to
+ * a's and v the velocity, we solve
+ *
+ *	(d + v * t) . (d + v * t) = (a.r + b.r)^2
+ *
+ * which is a quadratic in t, and the smaller root is when they first touch.
+ * No root, or a root outside the move, means no hit. Circles already
+ * overlapping or moving apart are left alone. The normal is the direction
+ * from b's center to a's at the moment they touch.
+ */
+float sweepCircles(
+			Circle *a,
+			int velX,
+			int velY,
+			Circle *b,
+			float *normalX,
+			float *normalY)
+{
+	float dx = a->x - b->x, dy = a->y - b->y;
+	float radius = a->r + b->r;
+	float vv = (float)velX * velX + (float)velY * velY;
+	float dv = dx * velX + dy * velY;
+	float dd = dx * dx + dy * dy - radius * radius;
+	float root, time;
+
+	if(vv == 0.f || dd < 0.f || dv >= 0.f)
+		return 1.f;
+
+	root = dv * dv - vv * dd;
+	if(root < 0.f)
+		return 1.f;
+
+	time = (-dv - SDL_sqrtf(root)) / vv;
+	if(time < 0.f || time >= 1.f)
+		return 1.f;
+
+	*normalX = (dx + velX * time) / radius;
+	*normalY = (dy + velY * time) / radius;
+
+	return time;
+}
+
+/*
+ * Sweeping a circle against a box is the same as sweeping the circle's
+ * center against the box with its corners rounded off by the circle's radius.
+ * That shape is made of two boxes, the box grown by the radius across and
+ * the box grown by the radius down, and four circles of the radius on the
+ * corners. The center is swept against each of those, as a box with no size
+ * or a circle with no radius, and the earliest hit wins.
+ */
+float sweepCircleBox(
+			Circle *a,
+			int velX,
+			int velY,
+			SDL_Rect *b,
+			float *normalX,
+			float *normalY)
+{
+	SDL_Rect center = { a->x, a->y, 0, 0 };
+	SDL_Rect grown[2] = {
+		{ b->x - a->r, b->y, b->w + a->r * 2, b->h },
+		{ b->x, b->y - a->r, b->w, b->h + a->r * 2 } };
+	Circle corner;
+	float time = 1.f, hit, hitX, hitY;
+	int boxX, boxY, i;
+
+	for(i = 0; i < 2; ++i) {
+		hit = sweepBoxes(&center, velX, velY, &grown[i], &boxX, &boxY);
+		if(hit < time) {
+			time = hit;
+			*normalX = boxX;
+			*normalY = boxY;
+		}
+	}
+
+	corner.r = 0;
+	for(i = 0; i < 4; ++i) {
+		corner.x = b->x + (i & 1) * b->w;
+		corner.y = b->y + (i >> 1) * b->h;
+		hit = sweepCircles(a, velX, velY, &corner, &hitX, &hitY);
+		if(hit < time) {
+			time = hit;
+			*normalX = hitX;
+			*normalY = hitY;
+		}
+	}
+
+	return time;
+}
+
 void Dot_shiftColliders(Dot *d)
 {
 	d->mCollider.x = d->mPosX;
@@ -292,24 +478,14 @@ void Dot_shiftColliders(Dot *d)
  * Here we find the closest y position much like we did the x position. If the
  * distance squared between the closest point on the box and the center of the
  * circle is less than the circle's radius squared, then there is a collision.
+ *
+ * Those three cases are just the circle's position clamped to the box's
+ * sides, which the compiler can do with min and max rather than branches.
  */
 short check_collision_rect(Circle *a, SDL_Rect *b)
 {
-	int cX, cY;
-
-	if(a->x < b->x)
-		cX = b->x;
-	else if(a->x > b->x + b->w)
-		cX = b->x + b->w;
-	else
-		cX = a->x;
-
-	if(a->y < b->y)
-		cY = b->y;
-	else if(a->y > b->y + b->h)
-		cY = b->y + b->h;
-	else
-		cY = a->y;
+	int cX = SDL_clamp(a->x, b->x, b->x + b->w);
+	int cY = SDL_clamp(a->y, b->y, b->y + b->h);
 
 	if(distanceSquared(a->x, a->y, cX, cY) < a->r * a->r)
 		return -1;
@@ -319,15 +495,669 @@ short check_collision_rect(Circle *a, SDL_Rect *b)
 
 /*
  * Here is the distance squared function. It's just a distance calculation (
- * squareRoot( x^2 + y^2 ) ) without the square root.
+ * squareRoot( x^2 + y^2 ) ) without the square root. It works in ints, which
+ * is plenty for points less than 32768 pixels apart on each axis.
  */
-double distanceSquared(int x1, int y1, int x2, int y2)
+int distanceSquared(int x1, int y1, int x2, int y2)
 {
 	int deltaX = x2 - x1;
 	int deltaY = y2 - y1;
 	return deltaX*deltaX + deltaY*deltaY;
 }
 
+/*
+ * The plain C batch checks are the single checks in a loop, with each result
+ * shifted into its bit of the mask rather than branched on.
+ */
+void check_collision_circ_batch(
+				Circle *a,
+				int *x,
+				int *y,
+				int *r,
+				int count,
+				Uint32 *hits)
+{
+	int i, radius;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i < count; ++i) {
+		radius = a->r + r[i];
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, x[i], y[i])
+				< radius * radius) << (i & 31);
+	}
+}
+
+void check_collision_rect_batch(
+				Circle *a,
+				int *x,
+				int *y,
+				int *w,
+				int *h,
+				int count,
+				Uint32 *hits)
+{
+	int i, cX, cY;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i < count; ++i) {
+		cX = SDL_clamp(a->x, x[i], x[i] + w[i]);
+		cY = SDL_clamp(a->y, y[i], y[i] + h[i]);
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, cX, cY)
+				< a->r * a->r) << (i & 31);
+	}
+}
+
+/*
+ * The vector versions work on 16 bit offsets from the circle's center. The
+ * offsets are worked out as 32 bit numbers, eight or sixteen at a time, and
+ * packed down to 16 bits with saturation and then clamped to no less than
+ * -32767. The x and y offsets are then interleaved so that each 32 bit lane
+ * holds one x, y pair, and a single multiply-add of the pairs with themselves
+ * gives x * x + y * y for every lane at once.
+ *
+ * The clamp matters: packing saturates to -32768 on the low side, and two of
+ * those squared and added come to 2^31, one more than a 32 bit lane holds,
+ * which wraps round to the most negative number and reads as a hit. Clamped
+ * to 32767 either way, the largest sum is 2 * 32767 * 32767, which fits.
+ * Offsets too big for 16 bits stick at 32767 or -32767, still far too far
+ * away to hit anything, so within the range distanceSquared works in the
+ * results match the plain C versions as long as the radii add up to less
+ * than 32768.
+ *
+ * For boxes, the offset to the closest point is the circle's position
+ * clamped to the box, less the position, which works out as
+ *
+ *	max(left - x, min(right - x, 0))
+ *
+ * and is done on the packed 16 bit offsets since SSE2 only has min and max
+ * for 16 bit numbers.
+ *
+ * The packing instructions interleave their two inputs four at a time, so
+ * the low half of the interleaved pairs is the first four (or, for AVX2,
+ * eight) positions and the high half the next. A compare then gives every
+ * lane that hit all ones, and the move mask instruction gathers the top bit
+ * of each lane into the bits of our mask. Anything left over at the end of
+ * the arrays is done by the plain C code.
+ */
+#ifdef COLLISION_X86
+__attribute__((target("sse2")))
+void check_collision_circ_batchSSE2(
+				Circle *a,
+				int *x,
+				int *y,
+				int *r,
+				int count,
+				Uint32 *hits)
+{
+	__m128i ax = _mm_set1_epi32(a->x);
+	__m128i ay = _mm_set1_epi32(a->y);
+	__m128i ar = _mm_set1_epi32(a->r);
+	__m128i lim = _mm_set1_epi16(-32767);
+	__m128i dx, dy, rlo, rhi;
+	Uint32 mask;
+	int i;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i + 8 <= count; i += 8) {
+		dx = _mm_max_epi16(_mm_packs_epi32(
+				_mm_sub_epi32(_mm_loadu_si128((__m128i*)&x[i]), ax),
+				_mm_sub_epi32(_mm_loadu_si128((__m128i*)&x[i + 4]), ax)), lim);
+		dy = _mm_max_epi16(_mm_packs_epi32(
+				_mm_sub_epi32(_mm_loadu_si128((__m128i*)&y[i]), ay),
+				_mm_sub_epi32(_mm_loadu_si128((__m128i*)&y[i + 4]), ay)), lim);
+		rlo = _mm_add_epi32(_mm_loadu_si128((__m128i*)&r[i]), ar);
+		rhi = _mm_add_epi32(_mm_loadu_si128((__m128i*)&r[i + 4]), ar);
+
+		mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(
+				_mm_madd_epi16(
+					_mm_unpacklo_epi16(dx, dy),
+					_mm_unpacklo_epi16(dx, dy)),
+				_mm_madd_epi16(rlo, rlo))));
+		mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(
+				_mm_madd_epi16(
+					_mm_unpackhi_epi16(dx, dy),
+					_mm_unpackhi_epi16(dx, dy)),
+				_mm_madd_epi16(rhi, rhi)))) << 4;
+
+		hits[i >> 5] |= mask << (i & 31);
+	}
+
+	for(; i < count; ++i)
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, x[i], y[i])
+				< (a->r + r[i]) * (a->r + r[i])) << (i & 31);
+}
+
+__attribute__((target("sse2")))
+void check_collision_rect_batchSSE2(
+				Circle *a,
+				int *x,
+				int *y,
+				int *w,
+				int *h,
+				int count,
+				Uint32 *hits)
+{
+	__m128i ax = _mm_set1_epi32(a->x);
+	__m128i ay = _mm_set1_epi32(a->y);
+	__m128i rr = _mm_set1_epi32(a->r * a->r);
+	__m128i zero = _mm_setzero_si128();
+	__m128i lim = _mm_set1_epi16(-32767);
+	__m128i x0, x1, y0, y1, dx, dy;
+	Uint32 mask;
+	int i, cX, cY;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i + 8 <= count; i += 8) {
+		x0 = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&x[i]), ax);
+		x1 = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&x[i + 4]), ax);
+		dx = _mm_max_epi16(_mm_max_epi16(
+				_mm_packs_epi32(x0, x1),
+				_mm_min_epi16(_mm_packs_epi32(
+					_mm_add_epi32(x0, _mm_loadu_si128((__m128i*)&w[i])),
+					_mm_add_epi32(x1, _mm_loadu_si128((__m128i*)&w[i + 4]))),
+					zero)), lim);
+
+		y0 = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&y[i]), ay);
+		y1 = _mm_sub_epi32(_mm_loadu_si128((__m128i*)&y[i + 4]), ay);
+		dy = _mm_max_epi16(_mm_max_epi16(
+				_mm_packs_epi32(y0, y1),
+				_mm_min_epi16(_mm_packs_epi32(
+					_mm_add_epi32(y0, _mm_loadu_si128((__m128i*)&h[i])),
+					_mm_add_epi32(y1, _mm_loadu_si128((__m128i*)&h[i + 4]))),
+					zero)), lim);
+
+		mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(
+				_mm_madd_epi16(
+					_mm_unpacklo_epi16(dx, dy),
+					_mm_unpacklo_epi16(dx, dy)),
+				rr)));
+		mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmplt_epi32(
+				_mm_madd_epi16(
+					_mm_unpackhi_epi16(dx, dy),
+					_mm_unpackhi_epi16(dx, dy)),
+				rr))) << 4;
+
+		hits[i >> 5] |= mask << (i & 31);
+	}
+
+	for(; i < count; ++i) {
+		cX = SDL_clamp(a->x, x[i], x[i] + w[i]);
+		cY = SDL_clamp(a->y, y[i], y[i] + h[i]);
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, cX, cY)
+				< a->r * a->r) << (i & 31);
+	}
+}
+
+__attribute__((target("avx2")))
+void check_collision_circ_batchAVX2(
+				Circle *a,
+				int *x,
+				int *y,
+				int *r,
+				int count,
+				Uint32 *hits)
+{
+	__m256i ax = _mm256_set1_epi32(a->x);
+	__m256i ay = _mm256_set1_epi32(a->y);
+	__m256i ar = _mm256_set1_epi32(a->r);
+	__m256i lim = _mm256_set1_epi16(-32767);
+	__m256i dx, dy, rlo, rhi;
+	Uint32 mask;
+	int i;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i + 16 <= count; i += 16) {
+		dx = _mm256_max_epi16(_mm256_packs_epi32(
+				_mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&x[i]), ax),
+				_mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&x[i + 8]), ax)),
+				lim);
+		dy = _mm256_max_epi16(_mm256_packs_epi32(
+				_mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&y[i]), ay),
+				_mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&y[i + 8]), ay)),
+				lim);
+		rlo = _mm256_add_epi32(_mm256_loadu_si256((__m256i*)&r[i]), ar);
+		rhi = _mm256_add_epi32(_mm256_loadu_si256((__m256i*)&r[i + 8]), ar);
+
+		mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+				_mm256_madd_epi16(rlo, rlo),
+				_mm256_madd_epi16(
+					_mm256_unpacklo_epi16(dx, dy),
+					_mm256_unpacklo_epi16(dx, dy)))));
+		mask |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+				_mm256_madd_epi16(rhi, rhi),
+				_mm256_madd_epi16(
+					_mm256_unpackhi_epi16(dx, dy),
+					_mm256_unpackhi_epi16(dx, dy))))) << 8;
+
+		hits[i >> 5] |= mask << (i & 31);
+	}
+
+	for(; i < count; ++i)
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, x[i], y[i])
+				< (a->r + r[i]) * (a->r + r[i])) << (i & 31);
+}
+
+__attribute__((target("avx2")))
+void check_collision_rect_batchAVX2(
+				Circle *a,
+				int *x,
+				int *y,
+				int *w,
+				int *h,
+				int count,
+				Uint32 *hits)
+{
+	__m256i ax = _mm256_set1_epi32(a->x);
+	__m256i ay = _mm256_set1_epi32(a->y);
+	__m256i rr = _mm256_set1_epi32(a->r * a->r);
+	__m256i zero = _mm256_setzero_si256();
+	__m256i lim = _mm256_set1_epi16(-32767);
+	__m256i x0, x1, y0, y1, dx, dy;
+	Uint32 mask;
+	int i, cX, cY;
+
+	SDL_memset(hits, 0, (count + 31) / 32 * sizeof(Uint32));
+
+	for(i = 0; i + 16 <= count; i += 16) {
+		x0 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&x[i]), ax);
+		x1 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&x[i + 8]), ax);
+		dx = _mm256_max_epi16(_mm256_max_epi16(
+				_mm256_packs_epi32(x0, x1),
+				_mm256_min_epi16(_mm256_packs_epi32(
+					_mm256_add_epi32(x0, _mm256_loadu_si256((__m256i*)&w[i])),
+					_mm256_add_epi32(x1, _mm256_loadu_si256((__m256i*)&w[i + 8]))),
+					zero)), lim);
+
+		y0 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&y[i]), ay);
+		y1 = _mm256_sub_epi32(_mm256_loadu_si256((__m256i*)&y[i + 8]), ay);
+		dy = _mm256_max_epi16(_mm256_max_epi16(
+				_mm256_packs_epi32(y0, y1),
+				_mm256_min_epi16(_mm256_packs_epi32(
+					_mm256_add_epi32(y0, _mm256_loadu_si256((__m256i*)&h[i])),
+					_mm256_add_epi32(y1, _mm256_loadu_si256((__m256i*)&h[i + 8]))),
+					zero)), lim);
+
+		mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+				rr,
+				_mm256_madd_epi16(
+					_mm256_unpacklo_epi16(dx, dy),
+					_mm256_unpacklo_epi16(dx, dy)))));
+		mask |= _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(
+				rr,
+				_mm256_madd_epi16(
+					_mm256_unpackhi_epi16(dx, dy),
+					_mm256_unpackhi_epi16(dx, dy))))) << 8;
+
+		hits[i >> 5] |= mask << (i & 31);
+	}
+
+	for(; i < count; ++i) {
+		cX = SDL_clamp(a->x, x[i], x[i] + w[i]);
+		cY = SDL_clamp(a->y, y[i], y[i] + h[i]);
+		hits[i >> 5] |= (Uint32)(distanceSquared(a->x, a->y, cX, cY)
+				< a->r * a->r) << (i & 31);
+	}
+}
+#endif
+
+/*
+ * Picks the batch checks for the CPU we're running on, the same way the
+ * particle engine picks its integrator.
+ */
+void select_collision_batch(void)
+{
+	gCheckCircBatch = check_collision_circ_batch;
+	gCheckRectBatch = check_collision_rect_batch;
+
+#ifdef COLLISION_X86
+	if(SDL_HasAVX2()) {
+		gCheckCircBatch = check_collision_circ_batchAVX2;
+		gCheckRectBatch = check_collision_rect_batchAVX2;
+	} else if(SDL_HasSSE2()) {
+		gCheckCircBatch = check_collision_circ_batchSSE2;
+		gCheckRectBatch = check_collision_rect_batchSSE2;
+	}
+#endif
+}
+
+/*
+ * Here is the box collision test from the collision detection tutorial, for
+ * when both bodies are boxes.
+ */
+short checkCollision(SDL_Rect *a, SDL_Rect *b)
+{
+	if(a->y + a->h <= b->y)
+		return 0;
+	if(a->y >= b->y + b->h)
+		return 0;
+	if(a->x + a->w <= b->x)
+		return 0;
+	if(a->x >= b->x + b->w)
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Setting a body's shape also sets its bounding box.
+ */
+void Body_setBox(Body *b, int x, int y, int w, int h)
+{
+	b->mShape = BODY_BOX;
+	b->mBox.x = x;
+	b->mBox.y = y;
+	b->mBox.w = w;
+	b->mBox.h = h;
+}
+
+void Body_setCircle(Body *b, int x, int y, int r)
+{
+	b->mShape = BODY_CIRCLE;
+	b->mCircle.x = x;
+	b->mCircle.y = y;
+	b->mCircle.r = r;
+	b->mBox.x = x - r;
+	b->mBox.y = y - r;
+	b->mBox.w = r * 2;
+	b->mBox.h = r * 2;
+}
+
+/*
+ * This is the narrow phase, it picks the right collision test for the shapes
+ * of the two bodies.
+ */
+short Body_collide(Body *a, Body *b)
+{
+	if(a->mShape == BODY_BOX && b->mShape == BODY_BOX)
+		return checkCollision(&a->mBox, &b->mBox);
+	if(a->mShape == BODY_CIRCLE && b->mShape == BODY_CIRCLE)
+		return check_collision_circ(&a->mCircle, &b->mCircle) != 0;
+	if(a->mShape == BODY_CIRCLE)
+		return check_collision_rect(&a->mCircle, &b->mBox) != 0;
+	return check_collision_rect(&b->mCircle, &a->mBox) != 0;
+}
+
+/*
+ * The grid covers a width by height world; anything outside it is filed
+ * under the cells along its edge, which still works, only more slowly. The
+ * cell size is best set to about the size of the larger bodies, so that each
+ * body lands in one to four cells.
+ */
+short BroadPhase_init(BroadPhase *bp, int width, int height, int cellSize)
+{
+	SDL_memset(bp, 0, sizeof(BroadPhase));
+
+	bp->mCellSize = cellSize;
+	bp->mColumns = SDL_max((width + cellSize - 1) / cellSize, 1);
+	bp->mRows = SDL_max((height + cellSize - 1) / cellSize, 1);
+
+	bp->mCellStart = malloc((bp->mColumns * bp->mRows + 1) * sizeof(int));
+	if(bp->mCellStart == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		return -1;
+	}
+
+	return 0;
+}
+
+void BroadPhase_free(BroadPhase *bp)
+{
+	free(bp->mCellStart);
+	free(bp->mEntries);
+	free(bp->mPairs);
+	SDL_memset(bp, 0, sizeof(BroadPhase));
+}
+
+/*
+ * Returns the column or row a coordinate falls in, kept inside the grid.
+ */
+int BroadPhase_cell(BroadPhase *bp, int v, int cells)
+{
+	return SDL_clamp(v / bp->mCellSize, 0, cells - 1);
+}
+
+short BroadPhase_addPair(BroadPhase *bp, int a, int b)
+{
+	BodyPair *pairs;
+
+	if(bp->mPairCount == bp->mPairCapacity) {
+		pairs = realloc(bp->mPairs,
+				SDL_max(bp->mPairCapacity * 2, 256) * sizeof(BodyPair));
+		if(pairs == NULL) {
+			SDL_Log("%s(), realloc failed.", __func__);
+			return -1;
+		}
+		bp->mPairs = pairs;
+		bp->mPairCapacity = SDL_max(bp->mPairCapacity * 2, 256);
+	}
+
+	bp->mPairs[bp->mPairCount].mA = a;
+	bp->mPairs[bp->mPairCount].mB = b;
+	bp->mPairCount++;
+
+	return 0;
+}
+
+/*
+ * Finding the pairs is done in three passes over the bodies, much like a
+ * counting sort. The first counts how many bodies fall in each cell. A
+ * running total then turns the counts into where each cell's bodies end in
+ * the entries array, and the second pass files each body, stepping each
+ * cell's end back as it goes so that it finishes at the cell's start.
+ *
+ * The last pass tests the bodies in each cell against each other, first
+ * with their bounding boxes and then, if those overlap, with the narrow
+ * phase. Two bodies that overlap several cells would be found in each of
+ * them, so a pair is only counted in the cell holding the top left corner of
+ * where their bounding boxes overlap, which is in exactly one of the cells
+ * they share.
+ *
+ * Returns the number of colliding pairs, which are left in mPairs, or -1 if
+ * we run out of memory.
+ */
+int BroadPhase_findPairs(BroadPhase *bp, Body *bodies, int count)
+{
+	SDL_Rect *a, *b;
+	int cells = bp->mColumns * bp->mRows;
+	int left, right, top, bottom, x, y, i, j, cell, total;
+	int *entries;
+
+	SDL_memset(bp->mCellStart, 0, (cells + 1) * sizeof(int));
+	bp->mPairCount = 0;
+
+	for(i = 0; i < count; ++i) {
+		a = &bodies[i].mBox;
+		left = BroadPhase_cell(bp, a->x, bp->mColumns);
+		right = BroadPhase_cell(bp, a->x + a->w - 1, bp->mColumns);
+		top = BroadPhase_cell(bp, a->y, bp->mRows);
+		bottom = BroadPhase_cell(bp, a->y + a->h - 1, bp->mRows);
+		for(y = top; y <= bottom; ++y)
+			for(x = left; x <= right; ++x)
+				bp->mCellStart[y * bp->mColumns + x]++;
+	}
+
+	for(total = 0, cell = 0; cell < cells; ++cell) {
+		total += bp->mCellStart[cell];
+		bp->mCellStart[cell] = total;
+	}
+	bp->mCellStart[cells] = total;
+
+	if(total > bp->mEntryCapacity) {
+		entries = realloc(bp->mEntries, total * sizeof(int));
+		if(entries == NULL) {
+			SDL_Log("%s(), realloc failed.", __func__);
+			return -1;
+		}
+		bp->mEntries = entries;
+		bp->mEntryCapacity = total;
+	}
+
+	for(i = 0; i < count; ++i) {
+		a = &bodies[i].mBox;
+		left = BroadPhase_cell(bp, a->x, bp->mColumns);
+		right = BroadPhase_cell(bp, a->x + a->w - 1, bp->mColumns);
+		top = BroadPhase_cell(bp, a->y, bp->mRows);
+		bottom = BroadPhase_cell(bp, a->y + a->h - 1, bp->mRows);
+		for(y = top; y <= bottom; ++y)
+			for(x = left; x <= right; ++x)
+				bp->mEntries[--bp->mCellStart[y * bp->mColumns + x]] = i;
+	}
+
+	for(cell = 0; cell < cells; ++cell)
+		for(i = bp->mCellStart[cell]; i < bp->mCellStart[cell + 1]; ++i)
+			for(j = i + 1; j < bp->mCellStart[cell + 1]; ++j) {
+				a = &bodies[bp->mEntries[i]].mBox;
+				b = &bodies[bp->mEntries[j]].mBox;
+				if(!checkCollision(a, b))
+					continue;
+
+				x = BroadPhase_cell(bp, SDL_max(a->x, b->x), bp->mColumns);
+				y = BroadPhase_cell(bp, SDL_max(a->y, b->y), bp->mRows);
+				if(y * bp->mColumns + x != cell)
+					continue;
+
+				if(Body_collide(
+						&bodies[bp->mEntries[i]],
+						&bodies[bp->mEntries[j]])
+						&& BroadPhase_addPair(
+							bp,
+							bp->mEntries[i],
+							bp->mEntries[j]))
+					return -1;
+			}
+
+	return bp->mPairCount;
+}
+
+/*
+ * The crowd is a mix of dot sized boxes and circles scattered over the
+ * screen, each drifting in some direction.
+ */
+void Crowd_init(Body *crowd, int count)
+{
+	int i;
+	for(i = 0; i < count; ++i) {
+		if(i % 2)
+			Body_setCircle(
+					&crowd[i],
+					rand() % (SCREEN_WIDTH - DOT_WIDTH) + DOT_WIDTH / 2,
+					rand() % (SCREEN_HEIGHT - DOT_HEIGHT) + DOT_HEIGHT / 2,
+					DOT_WIDTH / 2);
+		else
+			Body_setBox(
+					&crowd[i],
+					rand() % (SCREEN_WIDTH - DOT_WIDTH),
+					rand() % (SCREEN_HEIGHT - DOT_HEIGHT),
+					DOT_WIDTH,
+					DOT_HEIGHT);
+		crowd[i].mVelX = rand() % 3 - 1;
+		crowd[i].mVelY = rand() % 3 - 1;
+	}
+}
+
+/*
+ * Each body moves by its velocity and bounces off the edges of the screen.
+ */
+void Crowd_move(Body *crowd, int count)
+{
+	Body *b;
+	int i;
+
+	for(i = 0; i < count; ++i) {
+		b = &crowd[i];
+		if(b->mBox.x + b->mVelX < 0
+				|| b->mBox.x + b->mBox.w + b->mVelX > SCREEN_WIDTH)
+			b->mVelX = -b->mVelX;
+		if(b->mBox.y + b->mVelY < 0
+				|| b->mBox.y + b->mBox.h + b->mVelY > SCREEN_HEIGHT)
+			b->mVelY = -b->mVelY;
+
+		if(b->mShape == BODY_CIRCLE)
+			Body_setCircle(
+					b,
+					b->mCircle.x + b->mVelX,
+					b->mCircle.y + b->mVelY,
+					b->mCircle.r);
+		else
+			Body_setBox(
+					b,
+					b->mBox.x + b->mVelX,
+					b->mBox.y + b->mVelY,
+					b->mBox.w,
+					b->mBox.h);
+	}
+}
+
+/*
+ * Flags every body in the crowd touching the given circle, testing them all
+ * at once with the batch checks. The circles and boxes are gathered into the
+ * separate arrays the checks take, with index remembering which body each
+ * one came from. There is room for CROWD_SIZE bodies.
+ */
+void Crowd_hitCircle(Body *crowd, int count, Circle *c, Uint8 *hits)
+{
+	int cx[CROWD_SIZE], cy[CROWD_SIZE], cr[CROWD_SIZE], circIndex[CROWD_SIZE];
+	int bx[CROWD_SIZE], by[CROWD_SIZE], bw[CROWD_SIZE], bh[CROWD_SIZE];
+	int boxIndex[CROWD_SIZE];
+	Uint32 circHits[(CROWD_SIZE + 31) / 32], boxHits[(CROWD_SIZE + 31) / 32];
+	int circles = 0, boxes = 0, i;
+
+	for(i = 0; i < count; ++i) {
+		if(crowd[i].mShape == BODY_CIRCLE) {
+			cx[circles] = crowd[i].mCircle.x;
+			cy[circles] = crowd[i].mCircle.y;
+			cr[circles] = crowd[i].mCircle.r;
+			circIndex[circles++] = i;
+		} else {
+			bx[boxes] = crowd[i].mBox.x;
+			by[boxes] = crowd[i].mBox.y;
+			bw[boxes] = crowd[i].mBox.w;
+			bh[boxes] = crowd[i].mBox.h;
+			boxIndex[boxes++] = i;
+		}
+	}
+
+	gCheckCircBatch(c, cx, cy, cr, circles, circHits);
+	gCheckRectBatch(c, bx, by, bw, bh, boxes, boxHits);
+
+	for(i = 0; i < circles; ++i)
+		if((circHits[i >> 5] >> (i & 31)) & 1)
+			hits[circIndex[i]] = 1;
+	for(i = 0; i < boxes; ++i)
+		if((boxHits[i >> 5] >> (i & 31)) & 1)
+			hits[boxIndex[i]] = 1;
+}
+
+/*
+ * Circles are drawn with the dot texture and boxes as outlines. Anything
+ * touching something else is tinted red; hits has a flag for every body.
+ */
+void Crowd_render(Body *crowd, int count, Uint8 *hits)
+{
+	int i;
+	for(i = 0; i < count; ++i) {
+		if(hits[i]) {
+			SDL_SetTextureColorMod(gDotTexture.mTexture, 0xFF, 0x00, 0x00);
+			SDL_SetRenderDrawColor(gRenderer, 0xFF, 0x00, 0x00, 0xFF);
+		} else {
+			SDL_SetTextureColorMod(gDotTexture.mTexture, 0xFF, 0xFF, 0xFF);
+			SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
+		}
+
+		if(crowd[i].mShape == BODY_CIRCLE)
+			LTexture_render(&gDotTexture, crowd[i].mBox.x, crowd[i].mBox.y, NULL);
+		else
+			SDL_RenderDrawRect(gRenderer, &crowd[i].mBox);
+	}
+
+	SDL_SetTextureColorMod(gDotTexture.mTexture, 0xFF, 0xFF, 0xFF);
+}
+
 short loadMedia(void)
 {
 	if(LTexture_loadFromFile(&gDotTexture, "dot.bmp") < 0)
@@ -384,18 +1214,12 @@ void handle_axis_motion(SDL_Event *e, Dot *d) {
 
 void close_all(void)
 {
-	free_texture(&gDotTexture);
+	LTexture_free(&gDotTexture);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -403,12 +1227,35 @@ void close_all(void)
  *
  * Finally in our main loop we handle input, move the dot with collision check
  * and render the scene objects to the screen.
+ *
+ * Every frame the crowd is moved and run through the broad phase, and every
+ * body in a colliding pair is flagged so it is drawn in red.
+ *
+ * A headless run stops after its ticks and hashes where the crowd and the
+ * dot ended up and which bodies were touching.
  */
+#ifndef BENCHMARK
 int main(int argc, char* argv[])
 {
+	Body crowd[CROWD_SIZE];
+	Uint8 hits[CROWD_SIZE];
+	BroadPhase broadPhase = { 0 };
+	Uint32 hash = HEADLESS_HASH;
+	int pairs, i, tick = 0;
+
+	if(Headless_parseArgs(&gHeadless, argc, argv) < 0)
+		return 1;
+
 	if(init())
 		goto equit;
 
+	if(BroadPhase_init(&broadPhase, SCREEN_WIDTH, SCREEN_HEIGHT, CROWD_CELL))
+		goto equit;
+
+	if(gHeadless.mTicks > 0)
+		srand(HEADLESS_SEED);
+	Crowd_init(crowd, CROWD_SIZE);
+
 	if(loadMedia())
 		goto equit;
 
@@ -424,7 +1271,10 @@ int main(int argc, char* argv[])
 	wall.y = 40;
 	wall.w = 40;
 	wall.h = 400;
-	
+
+	if(gHeadless.mTicks > 0)
+		Headless_start(&gHeadless);
+
 	while(1)
 	{
 		while(SDL_PollEvent(&e) != 0)
@@ -452,11 +1302,32 @@ int main(int argc, char* argv[])
 			}
 		}
 
+		if(gHeadless.mTicks > 0) {
+			if(tick == gHeadless.mTicks)
+				break;
+			Headless_steer(tick++, HEADLESS_TURN, DOT_VEL,
+					&dot.mVelX, &dot.mVelY);
+		}
+
 		Dot_move(&dot, &wall, &otherDot.mCollider);
 
+		Crowd_move(crowd, CROWD_SIZE);
+		pairs = BroadPhase_findPairs(&broadPhase, crowd, CROWD_SIZE);
+		SDL_memset(hits, 0, sizeof(hits));
+		for(i = 0; i < pairs; ++i) {
+			hits[broadPhase.mPairs[i].mA] = 1;
+			hits[broadPhase.mPairs[i].mB] = 1;
+		}
+		Crowd_hitCircle(crowd, CROWD_SIZE, &dot.mCollider, hits);
+
+		if(!gHeadless.mRender)
+			continue;
+
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
+		Crowd_render(crowd, CROWD_SIZE, hits);
+
 		SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0xFF);
 		SDL_RenderDrawRect(gRenderer, &wall);
 		
@@ -465,9 +1336,206 @@ int main(int argc, char* argv[])
 
 		SDL_RenderPresent(gRenderer);
 	}
+
+	for(i = 0; i < CROWD_SIZE; ++i)
+		hash = Headless_hash(hash, &crowd[i].mBox, sizeof(SDL_Rect));
+	hash = Headless_hash(hash, hits, sizeof(hits));
+	hash = Headless_hash(hash, &dot.mCollider, sizeof(Circle));
+	Headless_report(&gHeadless, hash);
 equit:
+	BroadPhase_free(&broadPhase);
 	close_all();
 
 	return 0;
 }
+#else
+/*
+ * Broad phase benchmark
+ *
+ * Building with -DBENCHMARK (make bench) swaps the demo for this main, which
+ * needs no window. For each body count it scatters that many drifting boxes
+ * and circles over a world sized to keep the crowd as dense as the demo's,
+ * then finds the colliding pairs with the broad phase and with the naive loop
+ * that tests every body against every other. Both report the pairs found and
+ * the time taken; the counts should always agree.
+ *
+ * After that it times each version of the batch checks, starting with the
+ * one select_collision_batch picks for this CPU, one circle against
+ * BENCH_BATCH circles and then boxes scattered over the screen, and checks
+ * every bit of their masks against the single checks.
+ */
+#define BENCH_RUNS		4
+#define BENCH_BATCH		4096
+#define BENCH_BATCH_RUNS	2000
+
+double bench_seconds(Uint64 start)
+{
+	return (double)(SDL_GetPerformanceCounter() - start)
+		/ SDL_GetPerformanceFrequency();
+}
+
+void bench_scatter(Body *bodies, int count, int size)
+{
+	int i;
+	for(i = 0; i < count; ++i) {
+		if(i % 2)
+			Body_setCircle(
+					&bodies[i],
+					rand() % size,
+					rand() % size,
+					DOT_WIDTH / 4 + rand() % (DOT_WIDTH / 4));
+		else
+			Body_setBox(
+					&bodies[i],
+					rand() % size,
+					rand() % size,
+					DOT_WIDTH / 2 + rand() % DOT_WIDTH,
+					DOT_HEIGHT / 2 + rand() % DOT_HEIGHT);
+	}
+}
+
+int bench_naive(Body *bodies, int count)
+{
+	int pairs = 0, i, j;
+
+	for(i = 0; i < count; ++i)
+		for(j = i + 1; j < count; ++j)
+			if(checkCollision(&bodies[i].mBox, &bodies[j].mBox)
+					&& Body_collide(&bodies[i], &bodies[j]))
+				pairs++;
+
+	return pairs;
+}
+
+/*
+ * Times one pair of batch checks and returns how many of their results
+ * differ from the single checks.
+ */
+int bench_batch(
+			char *name,
+			CircBatchCheck checkCirc,
+			RectBatchCheck checkRect,
+			int *x,
+			int *y,
+			int *r,
+			int *w,
+			int *h)
+{
+	Uint32 hits[BENCH_BATCH / 32];
+	Circle a = { SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, DOT_WIDTH / 2 }, b;
+	SDL_Rect box;
+	Uint64 start;
+	double circTime, rectTime;
+	int mismatches = 0, run, i;
+
+	start = SDL_GetPerformanceCounter();
+	for(run = 0; run < BENCH_BATCH_RUNS; ++run) {
+		a.x = run % SCREEN_WIDTH;
+		checkCirc(&a, x, y, r, BENCH_BATCH, hits);
+	}
+	circTime = bench_seconds(start);
+
+	for(i = 0; i < BENCH_BATCH; ++i) {
+		b.x = x[i];
+		b.y = y[i];
+		b.r = r[i];
+		if(((hits[i >> 5] >> (i & 31)) & 1) != (check_collision_circ(&a, &b) != 0))
+			mismatches++;
+	}
+
+	start = SDL_GetPerformanceCounter();
+	for(run = 0; run < BENCH_BATCH_RUNS; ++run) {
+		a.x = run % SCREEN_WIDTH;
+		checkRect(&a, x, y, w, h, BENCH_BATCH, hits);
+	}
+	rectTime = bench_seconds(start);
+
+	for(i = 0; i < BENCH_BATCH; ++i) {
+		box.x = x[i];
+		box.y = y[i];
+		box.w = w[i];
+		box.h = h[i];
+		if(((hits[i >> 5] >> (i & 31)) & 1) != (check_collision_rect(&a, &box) != 0))
+			mismatches++;
+	}
+
+	SDL_Log("batch %-6s circles %7.1fM tests/s, boxes %7.1fM tests/s, %d mismatches",
+			name,
+			BENCH_BATCH * (double)BENCH_BATCH_RUNS / circTime / 1e6,
+			BENCH_BATCH * (double)BENCH_BATCH_RUNS / rectTime / 1e6,
+			mismatches);
+
+	return mismatches;
+}
+
+int main(int argc, char* argv[])
+{
+	int counts[] = { 10000, 30000, 100000 };
+	int x[BENCH_BATCH], y[BENCH_BATCH], r[BENCH_BATCH];
+	int w[BENCH_BATCH], h[BENCH_BATCH];
+	BroadPhase bp;
+	Body *bodies;
+	Uint64 start;
+	double gridTime, naiveTime;
+	int pairs = 0, naivePairs, size, i, run;
+
+	bodies = malloc(counts[SDL_arraysize(counts) - 1] * sizeof(Body));
+	if(bodies == NULL)
+		return 1;
+
+	srand(1);
+
+	for(i = 0; i < (int)SDL_arraysize(counts); ++i) {
+		size = (int)SDL_sqrt((double)counts[i]
+				* SCREEN_WIDTH * SCREEN_HEIGHT / CROWD_SIZE);
+		bench_scatter(bodies, counts[i], size);
+
+		if(BroadPhase_init(&bp, size, size, CROWD_CELL))
+			return 1;
+
+		start = SDL_GetPerformanceCounter();
+		for(run = 0; run < BENCH_RUNS; ++run)
+			pairs = BroadPhase_findPairs(&bp, bodies, counts[i]);
+		gridTime = bench_seconds(start) / BENCH_RUNS;
+
+		start = SDL_GetPerformanceCounter();
+		naivePairs = bench_naive(bodies, counts[i]);
+		naiveTime = bench_seconds(start);
+
+		SDL_Log("%6d bodies, %6d pairs: grid %8.3f ms (%.0f pairs/ms),"
+				" naive %9.1f ms (%.1f pairs/ms)%s",
+				counts[i], pairs,
+				gridTime * 1000.0, pairs / (gridTime * 1000.0),
+				naiveTime * 1000.0, naivePairs / (naiveTime * 1000.0),
+				pairs == naivePairs ? "" : ", MISMATCH");
+
+		BroadPhase_free(&bp);
+	}
+
+	free(bodies);
+
+	for(i = 0; i < BENCH_BATCH; ++i) {
+		x[i] = rand() % SCREEN_WIDTH;
+		y[i] = rand() % SCREEN_HEIGHT;
+		r[i] = rand() % DOT_WIDTH;
+		w[i] = rand() % DOT_WIDTH;
+		h[i] = rand() % DOT_HEIGHT;
+	}
+
+	select_collision_batch();
+	bench_batch("chosen", gCheckCircBatch, gCheckRectBatch, x, y, r, w, h);
+	bench_batch("plain", check_collision_circ_batch,
+			check_collision_rect_batch, x, y, r, w, h);
+#ifdef COLLISION_X86
+	if(SDL_HasSSE2())
+		bench_batch("SSE2", check_collision_circ_batchSSE2,
+				check_collision_rect_batchSSE2, x, y, r, w, h);
+	if(SDL_HasAVX2())
+		bench_batch("AVX2", check_collision_circ_batchAVX2,
+				check_collision_rect_batchAVX2, x, y, r, w, h);
+#endif
+
+	return 0;
+}
+#endif
 
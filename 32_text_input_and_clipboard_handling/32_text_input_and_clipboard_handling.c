@@ -5,61 +5,22 @@
  * be getting text using SDL 2's new text input and clip board handling.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 #include <stdio.h>
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 TTF_Font *gFont = NULL;	
-LTexture gPromptTextTexture;
-LTexture gInputTextTexture;
+GlyphAtlas gTextAtlas;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "4") == 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC | LTUT_LINEAR))
 		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 
-	if(TTF_Init() == -1) {
+	if(TTF_Init() < 0) {
 		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
 		return -1;
 	}
@@ -67,59 +28,6 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
-{
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-			gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
-
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-	
-	return 0;
-}
-
-short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
 short loadMedia(void)
 {
 	//gFont = TTF_OpenFont("lazy.ttf", 28);
@@ -129,9 +37,7 @@ short loadMedia(void)
 		return -1;
 	}
 
-	SDL_Color textColor = { 0, 0, 0, 0xFF };
-	if(LTexture_loadFromRenderedText(&gPromptTextTexture,
-						"Enter Text:", textColor))
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
 		return -1;
 
 	return 0;
@@ -143,24 +49,21 @@ short loadMedia(void)
  */
 void close_all(void)
 {
-	free_texture(&gPromptTextTexture);
-	free_texture(&gInputTextTexture);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
  * There are a couple special key presses we want to handle. When the user
  * presses back space we want to remove the last character from the string.
+ * The string is UTF-8, so a character may be several bytes; the bytes after
+ * its first all start with the bits 10, so those go first and then the byte
+ * that began the character.
  *
  * When the user is holding control and presses c, we want to copy the current
  * text to the clip board using SDL_SetClipboardText. You can check if the ctrl
@@ -178,6 +81,8 @@ short get_input(SDL_Event *e, char *inputText)
 	if(e->type == SDL_KEYDOWN)
 	{
 		if(e->key.keysym.sym == SDLK_BACKSPACE && len > 0) {
+			while(len > 1 && (inputText[len-1] & 0xC0) == 0x80)
+				--len;
 			*(inputText+len-1) = '\0';
 			return 1;
 		}
@@ -231,58 +136,44 @@ int main(int argc, char* argv[])
 
 	SDL_Event e;
 	SDL_Color textColor = { 0, 0, 0, 0xFF };
+	char *prompt = "Enter Text:";
+	int promptW, promptH, inputW, inputH;
 
 	char inputText[255] = "Some Text";
-	LTexture_loadFromRenderedText(
-			&gInputTextTexture, inputText, textColor);
 
 	SDL_StartTextInput();
 /*
- * We only want to update the input text texture when we need to so we have a
- * flag that keeps track of whether we need to update the texture.
+ * The text is drawn from the glyph atlas, so there is no texture to update
+ * when the input changes; the new string is simply laid out the next time it
+ * is drawn. An empty string is no trouble either, it just draws nothing.
+ * At the end of the main loop we render the prompt text and the input text.
  */
 	while(1)
 	{
-		short renderText = 0;
-
 		while(SDL_PollEvent(&e) != 0) {
 			if(e.type == SDL_QUIT)
 				goto equit;
 
-			renderText = get_input(&e, inputText);
-		}
-/*
- * If the text render update flag has been set, we rerender the texture. One
- * little hack we have here is if we have an empty string, we render a space
- * because SDL_ttf will not render an empty string.
- * At the end of the main loop we render the prompt text and the input text.
- */
-		if(renderText) {
-			if(strcmp(inputText, ""))
-				LTexture_loadFromRenderedText(
-							&gInputTextTexture,
-							inputText,
-							textColor);
-			else
-				LTexture_loadFromRenderedText(
-							&gInputTextTexture,
-							" ",
-							textColor);
+			get_input(&e, inputText);
 		}
 
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gPromptTextTexture,
-				(SCREEN_WIDTH - gPromptTextTexture.mWidth) / 2,
+		GlyphAtlas_measure(&gTextAtlas, prompt, &promptW, &promptH);
+		GlyphAtlas_measure(&gTextAtlas, inputText, &inputW, &inputH);
+
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - promptW) / 2,
 				0,
-				NULL);
-		LTexture_render(
-				&gInputTextTexture,
-				(SCREEN_WIDTH - gInputTextTexture.mWidth) / 2,
-				gPromptTextTexture.mHeight,
-				NULL);
+				prompt, textColor);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - inputW) / 2,
+				promptH,
+				inputText, textColor);
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
 	}
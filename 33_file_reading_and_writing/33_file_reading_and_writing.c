@@ -6,29 +6,20 @@
  * save data.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_ttf.h>
+#include "ltut_ttf.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 #define TOTAL_DATA	10
 
-typedef struct {
-	SDL_Texture *mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 typedef struct {
 	SDL_Color textColor;
 	SDL_Color highlightColor;
 	int currentData;
 } STdata;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 TTF_Font *gFont = NULL;
-LTexture gPromptTextTexture;
-LTexture gDataTextures[TOTAL_DATA];
+GlyphAtlas gTextAtlas;
 STdata gStr;
 
 /*
@@ -40,36 +31,11 @@ Sint32 gData[TOTAL_DATA];
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC))
 		return -1;
-	}
 
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if(TTF_Init() == -1) {
+	if(TTF_Init() < 0) {
 		SDL_Log("%s(), TTF_Init failed. %s", __func__, TTF_GetError());
 		return -1;
 	}
@@ -77,59 +43,6 @@ short init(void)
 	return 0;
 }
 
-LTexture *free_texture(LTexture *lt)
-{
-	if(lt->mTexture != NULL)
-	{
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-	}
-	return lt;
-}
-
-short LTexture_loadFromRenderedText(
-					LTexture *lt,
-					char *textureText,
-					SDL_Color textColor)
-{
-	free_texture(lt);
-
-	SDL_Surface* textSurface = TTF_RenderText_Solid(
-			gFont, textureText, textColor);
-	if(textSurface == NULL) {
-		SDL_Log("%s(), TTF_RenderText_Solid failed. %s", __func__, TTF_GetError());
-		return -1;
-	}
-
-	lt->mTexture = SDL_CreateTextureFromSurface(gRenderer, textSurface);
-	if(lt->mTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-
-		return -1;
-	}
-
-	lt->mWidth = textSurface->w;
-	lt->mHeight = textSurface->h;
-
-	SDL_FreeSurface(textSurface);
-	
-	return 0;
-}
-
-short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = {x, y, lt->mWidth, lt->mHeight};
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
-}
-
 void gStr_init(STdata *gStr)
 {
 	SDL_Color textColor = { 0, 0, 0, 0xFF };
@@ -149,7 +62,6 @@ void gStr_init(STdata *gStr)
 short loadMedia(void)
 {
 	int i;
-	char string[255];
 
 	gStr_init(&gStr);
 
@@ -159,10 +71,7 @@ short loadMedia(void)
 		return -1;
 	}
 
-	if(LTexture_loadFromRenderedText(
-				&gPromptTextTexture,
-				"Enter Data:",
-				gStr.textColor) < 0)
+	if(GlyphAtlas_init(&gTextAtlas, gFont))
 		return -1;
 
 	SDL_RWops* file = SDL_RWFromFile("nums.bin", "r+b");
@@ -195,24 +104,6 @@ short loadMedia(void)
 
 		SDL_RWclose(file);
 	}
-/*
- * After the file is loaded we render the text textures that correspond with
- * each of our data numbers. Our loadFromRenderedText function only accepts
- * strings so we have to convert the integers to strings.
- */
-	sprintf(string, "%d", gData[0]);
-	LTexture_loadFromRenderedText(
-				&gDataTextures[0],
-				string,
-				gStr.highlightColor);
-
-	for(i = 1; i < TOTAL_DATA; ++i) {
-		sprintf(string, "%d", gData[i]);
-		LTexture_loadFromRenderedText(
-					&gDataTextures[i],
-					string,
-					gStr.textColor);
-	}
 
 	return 0;
 }
@@ -236,84 +127,44 @@ void close_all(void)
 		SDL_Log("%s(), file save failed. %s\n", __func__,
 				SDL_GetError());
 
-	free_texture(&gPromptTextTexture);
-	for(i = 0; i < TOTAL_DATA; ++i)
-		free_texture(&gDataTextures[i]);
+	GlyphAtlas_free(&gTextAtlas);
 
 	TTF_CloseFont(gFont);
 	gFont = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
 	TTF_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
- * When we press up or down we want to re-render the old current data in plain
- * colour, move to the next data point (with some bounds checking), and
- * re-render the new current data in the highlight colour. When we press left
- * or right we decrement or increment the current data and re-render the
- * texture associated with it. 
+ * When we press up or down we move to the next data point (with some bounds
+ * checking). When we press left or right we decrement or increment the
+ * current data. The numbers are drawn from the glyph atlas every frame, in
+ * the highlight colour for the current one, so there is nothing to re-render
+ * here.
  */
 void get_key(SDL_Event *e, STdata *str)
 {
-	char string[255];
 	switch(e->key.keysym.sym)
 	{
 		case SDLK_UP:
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,
-					str->textColor);
 			--(str->currentData);
 			if(str->currentData < 0)
 				str->currentData = TOTAL_DATA - 1;
-			
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,
-					str->highlightColor);
 			break;
 		
 		case SDLK_DOWN:
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,		
-					str->textColor);
 			++(str->currentData);
 			if(str->currentData == TOTAL_DATA)
 				str->currentData = 0;
-			
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,
-					str->highlightColor);
 			break;
 
 		case SDLK_LEFT:
 			--gData[str->currentData];
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,
-					str->highlightColor);
 			break;
 		
 		case SDLK_RIGHT:
 			++gData[str->currentData];
-			sprintf(string, "%d", gData[str->currentData]);
-			LTexture_loadFromRenderedText(
-					&gDataTextures[str->currentData],
-					string,
-					str->highlightColor);
 			break;
 	}
 }
@@ -326,6 +177,9 @@ void get_key(SDL_Event *e, STdata *str)
 int main(int argc, char* args[])
 {
 	int i;
+	char *prompt = "Enter Data:";
+	char string[12];
+	int promptW, promptH, w, h;
 
 	if(init())
 		goto equit;
@@ -348,18 +202,24 @@ int main(int argc, char* args[])
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LTexture_render(
-				&gPromptTextTexture,
-				(SCREEN_WIDTH - gPromptTextTexture.mWidth) / 2,
+		GlyphAtlas_measure(&gTextAtlas, prompt, &promptW, &promptH);
+		GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - promptW) / 2,
 				0,
-				NULL);
-		for(i = 0; i < TOTAL_DATA; ++i)
-			LTexture_render(
-				&gDataTextures[i],
-				(SCREEN_WIDTH - gDataTextures[i].mWidth) / 2,
-				gPromptTextTexture.mHeight
-				+ gDataTextures[0].mHeight * i,
-				NULL);
+				prompt, gStr.textColor);
+		for(i = 0; i < TOTAL_DATA; ++i) {
+			sprintf(string, "%d", gData[i]);
+			GlyphAtlas_measure(&gTextAtlas, string, &w, &h);
+			GlyphAtlas_draw(
+				&gTextAtlas,
+				(SCREEN_WIDTH - w) / 2,
+				promptH + h * i,
+				string,
+				i == gStr.currentData
+				? gStr.highlightColor : gStr.textColor);
+		}
+		GlyphAtlas_flush(&gTextAtlas);
 
 		SDL_RenderPresent(gRenderer);
 	}
@@ -6,7 +6,16 @@
  * shimmering particles.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
+
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_X86
+#include <immintrin.h>
+#endif
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
@@ -19,53 +28,190 @@
 
 #define TOTAL_PARTICLES	40
 #define P_LIFE		10
+#define TOTAL_PARTICLE_TEXTURES	3
+#define RNG_LANES	8
+#define RNG_BUFFER	64
+#define P_ALPHA		192
+#define MAX_EMITTERS	256
+#define MAX_WORKERS	16
+#define EMITTER_CHUNK	4
+#define BATCH_QUADS	8192
+
+/*
+ * Particles are thrown out at up to P_SPEED pixels per second, fall with
+ * P_GRAVITY pixels per second per second, and lose P_FADE alpha per second.
+ */
+#define P_SPEED		60.f
+#define P_GRAVITY	300.f
+#define P_FADE		1152.f
+
+/*
+ * The particle atlas holds the three particle colors followed by the shimmer.
+ */
+#define TOTAL_ATLAS_CLIPS	4
+#define ATLAS_CLIP_SHIMMER	3
+
+/*
+ * A headless run steps the simulation by HEADLESS_STEP seconds a tick from a
+ * fixed seed, and the scripted dot turns a quarter turn every HEADLESS_TURN
+ * ticks. To give the system some work it starts out with HEADLESS_EMITTERS
+ * more emitters of HEADLESS_EMITTER_SIZE particles spread over the screen.
+ */
+#define HEADLESS_STEP	(1.f / 60.f)
+#define HEADLESS_SEED	0x5EED
+#define HEADLESS_TURN	30
+#define HEADLESS_EMITTERS	64
+#define HEADLESS_EMITTER_SIZE	1000
 
 typedef struct {
-	SDL_Texture* mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
+	Uint32 mStartTicks;
+	Uint32 mPausedTicks;
+	short mPaused;
+	short mStarted;
+} LTimer;
+
+/*
+ * Here is our random number generator. Calling srand and rand every time a
+ * particle spawns is slow, every thread shares libc's one generator, and
+ * reseeding with SDL_GetTicks gives every particle spawned in the same
+ * millisecond the same numbers. Instead each emitter owns one of these.
+ *
+ * It is xoshiro128** run as RNG_LANES independent generators side by side,
+ * one per column of mState. Stepping every lane at once is a plain loop over
+ * the lanes with no dependency between them, which the compiler can turn into
+ * vector instructions. Single numbers are handed out from mBuffer, which is
+ * refilled RNG_BUFFER numbers at a time.
+ */
+typedef struct {
+	Uint32 mState[4][RNG_LANES];
+	Uint32 mBuffer[RNG_BUFFER];
+	int mNext;
+} Rng;
+
+/*
+ * Here is our particle pool. Rather than allocating every particle on its own
+ * and chasing a pointer to reach it, the pool keeps each member of the
+ * particles in its own array; particle i is made up of mPosX[i], mPosY[i],
+ * mVelX[i], mVelY[i], mAlpha[i], mFrame[i] and mTexture[i]. In terms of data
+ * members we have a position, a velocity, how opaque the particle still is, a
+ * frame of animation, and the index of the texture in gParticleTextures we'll
+ * render with. Each pool also has its own random number generator to spawn
+ * particles with.
+ *
+ * Like the dot in the frame independent movement tutorial, the particles
+ * move based on time, which is why the position, velocity and alpha are
+ * floats.
+ *
+ * All of the arrays are carved out of one allocation made when the pool is
+ * created, and the live particles are always packed into the first mCount
+ * slots, so walking the particles is walking memory in order.
+ */
+typedef struct {
+	float *mPosX, *mPosY;
+	float *mVelX, *mVelY;
+	float *mAlpha;
+	int *mFrame;
+	Uint8 *mTexture;
+	int mCount;
+	int mCapacity;
+	Rng mRng;
+} ParticlePool;
 
 /*
- * Here is a simple particle struct. We have related functions, a constructor
- * to set the position, and a function to render it, a function to tell if the
- * particle is dead. In terms of data members we have a position, a frame of
- * animation, and a texture we'll render with.
+ * A particle emitter is a pool of particles and the position they spawn
+ * about.
  */
 typedef struct {
+	ParticlePool mParticles;
 	int mPosX, mPosY;
-	int mFrame;
-	LTexture *mTexture;
-} Particle;
+} ParticleEmitter;
 
 /*
- * Here is our dot with an array of particles and a function to render the
- * particles on the dot.
+ * The integrator moves every particle in a pool along by one time step. There
+ * is a plain C version and, on x86, an SSE2 and an AVX2 version that do four
+ * and eight particles at a time; gIntegrateParticles points at the best one
+ * the CPU we're running on supports.
+ */
+typedef void (*ParticleIntegrator)(
+				ParticlePool *pp,
+				float gravity,
+				float fade,
+				float timeStep);
+
+/*
+ * The particle system owns every emitter and updates them all at once. The
+ * update is split between the calling thread and a pool of worker threads:
+ * each of them repeatedly claims the next EMITTER_CHUNK emitters by bumping
+ * mNextEmitter until none are left, so a thread that finishes early simply
+ * takes more of the work. An emitter is only ever updated by one thread, so
+ * its pool and generator need no locking. Rendering is kept out of the
+ * workers entirely and stays on the thread that owns the renderer.
+ *
+ * The workers sleep on mStart until mGeneration changes, which is how the
+ * system tells them a new update has begun, and the last one to finish
+ * signals mDone.
  */
 typedef struct {
-	Particle* particles[TOTAL_PARTICLES];
+	ParticleEmitter *mEmitters;
+	int mCount;
+	int mCapacity;
+	Uint64 mSeed;
+
+	SDL_Thread *mWorkers[MAX_WORKERS];
+	int mWorkerCount;
+	SDL_mutex *mLock;
+	SDL_cond *mStart;
+	SDL_cond *mDone;
+	int mGeneration;
+	int mPending;
+	float mTimeStep;
+	short mQuit;
+	SDL_atomic_t mNextEmitter;
+} ParticleSystem;
+
+/*
+ * Here is our dot with the particle emitter that follows it around.
+ */
+typedef struct {
+	ParticleEmitter *mEmitter;
 	int mPosX, mPosY;
 	int mVelX, mVelY;
 } Dot;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
-LTexture gDotTexture;
-LTexture gRedTexture;
-LTexture gGreenTexture;
-LTexture gBlueTexture;
-LTexture gShimmerTexture;
+
+/*
+ * The textures come from gTextures, the texture cache, which loads each image
+ * once however many times it is asked for. Particles keep the index of their
+ * texture in gParticleTextures rather than a pointer of their own, so however
+ * many there are they all share the three textures in the cache.
+ */
+LTextureCache gTextures;
+LTexture *gDotTexture = NULL;
+LTexture *gShimmerTexture = NULL;
+LTexture *gParticleTextures[TOTAL_PARTICLE_TEXTURES] = { NULL };
+
+/*
+ * For the batched path all of the particle images live in one atlas texture
+ * and every particle is added to gParticleBatch. gDrawCalls counts the draw
+ * calls made in the current frame so we can see what batching saves; press b
+ * to switch between the batched and the per particle paths.
+ */
+LTexture gParticleAtlas;
+SDL_Rect gParticleClips[TOTAL_ATLAS_CLIPS];
+QuadBatch gParticleBatch;
+short gBatchParticles = 1;
+int gDrawCalls = 0;
+ParticleIntegrator gIntegrateParticles = NULL;
+Headless gHeadless = { 0, 1, 0 };
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_GAMECONTROLLER,
+				LTUT_VSYNC | LTUT_LINEAR
+				| (gHeadless.mTicks > 0 ? LTUT_HEADLESS : 0)))
 		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering not enabled.");
 
     for (int i = 0; i < SDL_NumJoysticks(); i++) {
         if (SDL_IsGameController(i)) {
@@ -77,179 +223,731 @@ short init(void)
         }
     }
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
+	LTextureCache_init(&gTextures);
+
+	return 0;
+}
+
+/*
+ * To build an atlas we lay the images out side by side and copy each of them
+ * into a blank texture that we render to. The images are already textures,
+ * so nothing is decoded or uploaded a second time. They are copied without
+ * blending and at full alpha so the atlas gets their pixels exactly,
+ * transparent parts and all, and whatever blend mode and alpha they had is
+ * put back afterwards. The position of each image within the atlas is
+ * returned in clips.
+ *
+ * Some renderers lose what was rendered to a texture when their render
+ * targets are reset, so main builds the atlas again when that happens.
+ */
+short LTexture_buildAtlas(
+				LTexture *lt,
+				LTexture *images[],
+				int count,
+				SDL_Rect clips[])
+{
+	SDL_BlendMode blending;
+	Uint8 alpha;
+	short ret = 0;
+	int i, width = 0, height = 0;
+
+	for(i = 0; i < count; ++i) {
+		clips[i].x = width;
+		clips[i].y = 0;
+		clips[i].w = images[i]->mWidth;
+		clips[i].h = images[i]->mHeight;
+
+		width += images[i]->mWidth;
+		if(images[i]->mHeight > height)
+			height = images[i]->mHeight;
 	}
 
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+	if(LTexture_createBlank(lt, width, height, SDL_TEXTUREACCESS_TARGET))
+		return -1;
+
+	if(LTexture_setAsRenderTarget(lt))
 		return -1;
+
+	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x00);
+	SDL_RenderClear(gRenderer);
+
+	for(i = 0; i < count; ++i) {
+		SDL_GetTextureBlendMode(images[i]->mTexture, &blending);
+		SDL_GetTextureAlphaMod(images[i]->mTexture, &alpha);
+		LTexture_setBlendMode(images[i], SDL_BLENDMODE_NONE);
+		LTexture_setAlpha(images[i], 0xFF);
+
+		if(LTexture_render(images[i], clips[i].x, clips[i].y, NULL) < 0) {
+			SDL_Log("%s(), SDL_RenderCopy failed. %s", __func__, SDL_GetError());
+			ret = -1;
+		}
+
+		LTexture_setBlendMode(images[i], blending);
+		LTexture_setAlpha(images[i], alpha);
 	}
 
+	SDL_SetRenderTarget(gRenderer, NULL);
 	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	LTexture_setBlendMode(lt, SDL_BLENDMODE_BLEND);
+
+	return ret;
+}
+
+void LTimer_start(LTimer *t)
+{
+	t->mStarted = 1;
+	t->mPaused = 0;
+	t->mStartTicks = SDL_GetTicks();
+	t->mPausedTicks = 0;
+}
+
+Uint32 LTimer_getTicks(LTimer *t)
+{
+	Uint32 time = 0;
+
+	if(t->mStarted) {
+		if(t->mPaused)
+			time = t->mPausedTicks;
+		else
+			time = SDL_GetTicks() - t->mStartTicks;
+	}
+
+	return time;
+}
+
+/*
+ * The generator is seeded by running the seed through splitmix64, which turns
+ * even neighbouring seeds into unrelated states, once for every word of every
+ * lane. The buffer starts out empty.
+ */
+void Rng_seed(Rng *r, Uint64 seed)
+{
+	Uint64 z;
+	int w, l;
+
+	for(w = 0; w < 4; ++w)
+		for(l = 0; l < RNG_LANES; ++l) {
+			seed += 0x9E3779B97F4A7C15ULL;
+			z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			r->mState[w][l] = (Uint32)((z ^ (z >> 31)) >> 32);
+		}
 
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+	r->mNext = RNG_BUFFER;
+}
+
+/*
+ * Here is the bulk fill which writes n random numbers to out. The state is
+ * copied into local arrays for the duration so the compiler knows that out
+ * can't alias it, and every pass of the outer loop steps all of the lanes and
+ * produces RNG_LANES numbers.
+ */
+void Rng_fill(Rng *r, Uint32 *out, int n)
+{
+	Uint32 s0[RNG_LANES], s1[RNG_LANES], s2[RNG_LANES], s3[RNG_LANES];
+	Uint32 block[RNG_LANES];
+	Uint32 x, t;
+	int i, l;
+
+	memcpy(s0, r->mState[0], sizeof(s0));
+	memcpy(s1, r->mState[1], sizeof(s1));
+	memcpy(s2, r->mState[2], sizeof(s2));
+	memcpy(s3, r->mState[3], sizeof(s3));
+
+	for(i = 0; i < n; i += RNG_LANES) {
+		for(l = 0; l < RNG_LANES; ++l) {
+			x = s1[l] * 5;
+			block[l] = ((x << 7) | (x >> 25)) * 9;
+
+			t = s1[l] << 9;
+			s2[l] ^= s0[l];
+			s3[l] ^= s1[l];
+			s1[l] ^= s2[l];
+			s0[l] ^= s3[l];
+			s2[l] ^= t;
+			s3[l] = (s3[l] << 11) | (s3[l] >> 21);
+		}
+
+		memcpy(out + i, block,
+				SDL_min(RNG_LANES, n - i) * sizeof(Uint32));
+	}
+
+	memcpy(r->mState[0], s0, sizeof(s0));
+	memcpy(r->mState[1], s1, sizeof(s1));
+	memcpy(r->mState[2], s2, sizeof(s2));
+	memcpy(r->mState[3], s3, sizeof(s3));
+}
+
+Uint32 Rng_next(Rng *r)
+{
+	if(r->mNext == RNG_BUFFER) {
+		Rng_fill(r, r->mBuffer, RNG_BUFFER);
+		r->mNext = 0;
+	}
+
+	return r->mBuffer[r->mNext++];
+}
+
+/*
+ * Returns a number from 0 up to but not including n. Rather than taking the
+ * remainder, which needs a divide, we scale the 32 bit number into the range
+ * with a multiply and a shift.
+ */
+int Rng_range(Rng *r, int n)
+{
+	return (int)(((Uint64)Rng_next(r) * (Uint32)n) >> 32);
+}
+
+/*
+ * The pool makes a single allocation large enough for every array and then
+ * points each array at its own part of it. The floats and ints come first so
+ * that every array stays aligned. The pool starts out empty; it is filled the
+ * first time it is updated. The seed is for the pool's random number generator.
+ */
+short ParticlePool_init(ParticlePool *pp, int capacity, Uint64 seed)
+{
+	char *block;
+
+	block = malloc(capacity
+			* (5 * sizeof(float) + sizeof(int) + sizeof(Uint8)));
+	if(block == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
 		return -1;
 	}
 
+	pp->mPosX = (float*)block;
+	pp->mPosY = pp->mPosX + capacity;
+	pp->mVelX = pp->mPosY + capacity;
+	pp->mVelY = pp->mVelX + capacity;
+	pp->mAlpha = pp->mVelY + capacity;
+	pp->mFrame = (int*)(pp->mAlpha + capacity);
+	pp->mTexture = (Uint8*)(pp->mFrame + capacity);
+
+	pp->mCount = 0;
+	pp->mCapacity = capacity;
+
+	Rng_seed(&pp->mRng, seed);
+
 	return 0;
 }
 
-void LTexture_free(LTexture *lt)
+void ParticlePool_free(ParticlePool *pp)
+{
+	free(pp->mPosX);
+	pp->mPosX = NULL;
+	pp->mPosY = NULL;
+	pp->mVelX = NULL;
+	pp->mVelY = NULL;
+	pp->mAlpha = NULL;
+	pp->mFrame = NULL;
+	pp->mTexture = NULL;
+	pp->mCount = 0;
+	pp->mCapacity = 0;
+}
+
+/*
+ * To spawn a particle in slot i we initialize the position around the given
+ * position with some randomness to it, and throw it out in a random direction.
+ * It starts at full alpha. We then initialize the frame of animation with
+ * some randomness so the particles will have varying life.
+ * Finally we pick the type of texture we'll use for the particle also at
+ * random. All of the randomness comes from the pool's own generator.
+ */
+void ParticlePool_spawn(ParticlePool *pp, int i, int x, int y)
+{
+	pp->mPosX[i] = x - 5 + Rng_range(&pp->mRng, 25);
+	pp->mPosY[i] = y - 5 + Rng_range(&pp->mRng, 25);
+
+	pp->mVelX[i] = (Rng_range(&pp->mRng, 201) - 100) * (P_SPEED / 100);
+	pp->mVelY[i] = (Rng_range(&pp->mRng, 201) - 100) * (P_SPEED / 100);
+
+	pp->mAlpha[i] = P_ALPHA;
+
+	pp->mFrame[i] = Rng_range(&pp->mRng, 5);
+
+	pp->mTexture[i] = Rng_range(&pp->mRng, TOTAL_PARTICLE_TEXTURES);
+}
+
+/*
+ * Here is the integration itself for particles first up to but not including
+ * last. Gravity speeds the particle up, the velocity moves it, and the alpha
+ * fades until it hits zero. Velocity is updated before position, so this is
+ * semi-implicit Euler, which holds up better than updating position first.
+ *
+ * This is the plain C integrator when run over the whole pool, and the
+ * vector integrators use it for the particles left over at the end.
+ */
+void Particle_integrateRange(
+			ParticlePool *pp,
+			int first, int last,
+			float gravity,
+			float fade,
+			float timeStep)
 {
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
+	int i;
+	for(i = first; i < last; ++i) {
+		pp->mVelY[i] += gravity * timeStep;
+
+		pp->mPosX[i] += pp->mVelX[i] * timeStep;
+		pp->mPosY[i] += pp->mVelY[i] * timeStep;
+
+		pp->mAlpha[i] -= fade * timeStep;
+		if(pp->mAlpha[i] < 0)
+			pp->mAlpha[i] = 0;
 	}
 }
 
-short LTexture_loadFromFile(LTexture *lt, char *path)
+void Particle_integrateScalar(
+			ParticlePool *pp,
+			float gravity,
+			float fade,
+			float timeStep)
 {
-	LTexture_free(lt);
+	Particle_integrateRange(pp, 0, pp->mCount, gravity, fade, timeStep);
+}
+
+/*
+ * The vector integrators do exactly the same math on four (SSE2) or eight
+ * (AVX2) particles at a time. The arrays are not aligned to the vector size,
+ * so we use unaligned loads and stores. Each version is compiled for its own
+ * instruction set with the target attribute, which is why the program as a
+ * whole still runs on a CPU without AVX2; we just never call that version.
+ */
+#ifdef PARTICLE_X86
+__attribute__((target("sse2")))
+void Particle_integrateSSE2(
+			ParticlePool *pp,
+			float gravity,
+			float fade,
+			float timeStep)
+{
+	__m128 dv = _mm_set1_ps(gravity * timeStep);
+	__m128 dt = _mm_set1_ps(timeStep);
+	__m128 da = _mm_set1_ps(fade * timeStep);
+	__m128 zero = _mm_setzero_ps();
+	__m128 vx, vy;
+	int i;
 
-	SDL_Texture* newTexture = NULL;
+	for(i = 0; i + 4 <= pp->mCount; i += 4) {
+		vx = _mm_loadu_ps(&pp->mVelX[i]);
+		vy = _mm_add_ps(_mm_loadu_ps(&pp->mVelY[i]), dv);
+		_mm_storeu_ps(&pp->mVelY[i], vy);
 
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
+		_mm_storeu_ps(&pp->mPosX[i], _mm_add_ps(
+				_mm_loadu_ps(&pp->mPosX[i]), _mm_mul_ps(vx, dt)));
+		_mm_storeu_ps(&pp->mPosY[i], _mm_add_ps(
+				_mm_loadu_ps(&pp->mPosY[i]), _mm_mul_ps(vy, dt)));
 
-		return -1;
+		_mm_storeu_ps(&pp->mAlpha[i], _mm_max_ps(
+				_mm_sub_ps(_mm_loadu_ps(&pp->mAlpha[i]), da), zero));
 	}
 
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+	Particle_integrateRange(pp, i, pp->mCount, gravity, fade, timeStep);
+}
 
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
+__attribute__((target("avx2")))
+void Particle_integrateAVX2(
+			ParticlePool *pp,
+			float gravity,
+			float fade,
+			float timeStep)
+{
+	__m256 dv = _mm256_set1_ps(gravity * timeStep);
+	__m256 dt = _mm256_set1_ps(timeStep);
+	__m256 da = _mm256_set1_ps(fade * timeStep);
+	__m256 zero = _mm256_setzero_ps();
+	__m256 vx, vy;
+	int i;
+
+	for(i = 0; i + 8 <= pp->mCount; i += 8) {
+		vx = _mm256_loadu_ps(&pp->mVelX[i]);
+		vy = _mm256_add_ps(_mm256_loadu_ps(&pp->mVelY[i]), dv);
+		_mm256_storeu_ps(&pp->mVelY[i], vy);
+
+		_mm256_storeu_ps(&pp->mPosX[i], _mm256_add_ps(
+				_mm256_loadu_ps(&pp->mPosX[i]), _mm256_mul_ps(vx, dt)));
+		_mm256_storeu_ps(&pp->mPosY[i], _mm256_add_ps(
+				_mm256_loadu_ps(&pp->mPosY[i]), _mm256_mul_ps(vy, dt)));
+
+		_mm256_storeu_ps(&pp->mAlpha[i], _mm256_max_ps(
+				_mm256_sub_ps(_mm256_loadu_ps(&pp->mAlpha[i]), da), zero));
 	}
 
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
+	Particle_integrateRange(pp, i, pp->mCount, gravity, fade, timeStep);
+}
+#endif
 
-	SDL_FreeSurface(loadedSurface);
+/*
+ * Picks the integrator for the CPU we're running on. SDL's CPU feature checks
+ * ask the CPU itself through cpuid, so an x86 build only uses AVX2 where it is
+ * really there. Everywhere else the plain C version is used.
+ */
+void Particle_selectIntegrator(void)
+{
+	gIntegrateParticles = Particle_integrateScalar;
+
+#ifdef PARTICLE_X86
+	if(SDL_HasAVX2())
+		gIntegrateParticles = Particle_integrateAVX2;
+	else if(SDL_HasSSE2())
+		gIntegrateParticles = Particle_integrateSSE2;
+#endif
+}
 
-	lt->mTexture = newTexture;
+/*
+ * Updating the pool starts by moving every particle along by the time step
+ * with the integrator. After that is one pass over the arrays. Each
+ * particle's frame of animation is advanced, and once a particle has lived
+ * for more than P_LIFE frames it is dead. Rather than leaving a hole, the last
+ * live particle is moved into the dead one's slot and the count shrinks by
+ * one; we then look at the same slot again since it now holds a particle we
+ * have not aged yet.
+ *
+ * Once the pass is done, the free slots at the end of the pool are filled
+ * with fresh particles spawned about the given position.
+ */
+void ParticlePool_update(ParticlePool *pp, int x, int y, float timeStep)
+{
+	int i = 0, last;
+
+	gIntegrateParticles(pp, P_GRAVITY, P_FADE, timeStep);
+
+	while(i < pp->mCount) {
+		if(++pp->mFrame[i] > P_LIFE) {
+			last = --pp->mCount;
+			pp->mPosX[i] = pp->mPosX[last];
+			pp->mPosY[i] = pp->mPosY[last];
+			pp->mVelX[i] = pp->mVelX[last];
+			pp->mVelY[i] = pp->mVelY[last];
+			pp->mAlpha[i] = pp->mAlpha[last];
+			pp->mFrame[i] = pp->mFrame[last];
+			pp->mTexture[i] = pp->mTexture[last];
+		} else
+			++i;
+	}
 
-	return 0;
+	while(pp->mCount < pp->mCapacity)
+		ParticlePool_spawn(pp, pp->mCount++, x, y);
+}
+
+/*
+ * In the rendering function we render the texture selected when each
+ * particle was spawned and then every other frame we render a semitransparent
+ * shimmer texture over it to make it look like the particle is shining. Both
+ * are drawn with the particle's current alpha.
+ */
+void ParticlePool_render(ParticlePool *pp)
+{
+	LTexture *lt;
+	int i;
+	for(i = 0; i < pp->mCount; ++i) {
+		lt = gParticleTextures[pp->mTexture[i]];
+		LTexture_setAlpha(lt, (Uint8)pp->mAlpha[i]);
+		LTexture_render(
+				lt,
+				(int)pp->mPosX[i],
+				(int)pp->mPosY[i],
+				NULL);
+		++gDrawCalls;
+
+		if(pp->mFrame[i] % 2 == 0) {
+			LTexture_setAlpha(gShimmerTexture, (Uint8)pp->mAlpha[i]);
+			LTexture_render(
+					gShimmerTexture,
+					(int)pp->mPosX[i],
+					(int)pp->mPosY[i],
+					NULL);
+			++gDrawCalls;
+		}
+	}
 }
 
-void LTexture_setAlpha(LTexture *lt, Uint8 alpha)
+/*
+ * The batched renderer draws exactly the same thing as ParticlePool_render
+ * but rather than two copies per particle, each particle adds its quad and
+ * its shimmer quad to the batch. The shimmer quad is added straight after its
+ * particle so it is still drawn on top of it. Nothing is drawn until the
+ * batch is flushed, so any number of pools can go into the same
+ * SDL_RenderGeometry call.
+ */
+void ParticlePool_renderBatched(ParticlePool *pp)
 {
-	SDL_SetTextureAlphaMod(lt->mTexture, alpha);
+	SDL_Color color = { 0xFF, 0xFF, 0xFF, 0xFF };
+	int i;
+	for(i = 0; i < pp->mCount; ++i) {
+		color.a = (Uint8)pp->mAlpha[i];
+		QuadBatch_addQuad(
+				&gParticleBatch,
+				&gParticleAtlas,
+				&gParticleClips[pp->mTexture[i]],
+				pp->mPosX[i],
+				pp->mPosY[i],
+				color);
+
+		if(pp->mFrame[i] % 2 == 0)
+			QuadBatch_addQuad(
+					&gParticleBatch,
+					&gParticleAtlas,
+					&gParticleClips[ATLAS_CLIP_SHIMMER],
+					pp->mPosX[i],
+					pp->mPosY[i],
+					color);
+	}
 }
 
-void LTexture_render(
-			LTexture *lt,
-			int x,
-			int y,
-			SDL_Rect* clip)
+/*
+ * Updating an emitter moves, ages, kills and respawns its particles about its
+ * current position.
+ */
+void ParticleEmitter_update(ParticleEmitter *pe, float timeStep)
 {
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+	ParticlePool_update(&pe->mParticles, pe->mPosX, pe->mPosY, timeStep);
+}
+
+/*
+ * This is the part of the update every thread runs, the calling thread
+ * included. Each pass claims the next chunk of emitters and updates them.
+ */
+void ParticleSystem_updateShare(ParticleSystem *ps)
+{
+	float timeStep = ps->mTimeStep;
+	int first, last, i;
+
+	while((first = SDL_AtomicAdd(&ps->mNextEmitter, EMITTER_CHUNK))
+			< ps->mCount) {
+		last = SDL_min(first + EMITTER_CHUNK, ps->mCount);
+		for(i = first; i < last; ++i)
+			ParticleEmitter_update(&ps->mEmitters[i], timeStep);
+	}
+}
+
+/*
+ * Each worker waits for the generation to move on, does its share of the
+ * update without holding the lock, and then reports back. The last worker to
+ * finish wakes up the thread waiting in ParticleSystem_update.
+ */
+int ParticleSystem_worker(void *data)
+{
+	ParticleSystem *ps = data;
+	int generation = 0;
+
+	SDL_LockMutex(ps->mLock);
+	while(1) {
+		while(ps->mGeneration == generation && !ps->mQuit)
+			SDL_CondWait(ps->mStart, ps->mLock);
+
+		if(ps->mQuit)
+			break;
+
+		generation = ps->mGeneration;
+		SDL_UnlockMutex(ps->mLock);
+
+		ParticleSystem_updateShare(ps);
 
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
+		SDL_LockMutex(ps->mLock);
+		if(--ps->mPending == 0)
+			SDL_CondSignal(ps->mDone);
 	}
+	SDL_UnlockMutex(ps->mLock);
 
-	SDL_RenderCopy(
-			gRenderer,
-			lt->mTexture,
-			clip,
-			&renderQuad);
+	return 0;
 }
 
 /*
- * For our particle constructor we initialize the position around the given
- * position with some randomness to it. We then initialize the frame of
- * animation with some randomness so the particles will have varying life.
- * Finally we pick the type of texture we'll use for the particle also at
- * random.
+ * The system makes room for maxEmitters emitters up front so the emitters
+ * never move and a pointer to one stays good. It then starts the given
+ * number of workers; with none the whole update simply runs on the calling
+ * thread. Each emitter's generator is seeded from the system's seed.
  */
-void Particle_init(Particle *p, int x, int y)
+short ParticleSystem_init(
+				ParticleSystem *ps,
+				int maxEmitters,
+				int workers,
+				Uint64 seed)
 {
-	srand(SDL_GetTicks());
+	int i;
+
+	ps->mEmitters = malloc(maxEmitters * sizeof(ParticleEmitter));
+	if(ps->mEmitters == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		return -1;
+	}
+	ps->mCount = 0;
+	ps->mCapacity = maxEmitters;
+	ps->mSeed = seed;
+
+	ps->mWorkerCount = 0;
+	ps->mGeneration = 0;
+	ps->mPending = 0;
+	ps->mTimeStep = 0;
+	ps->mQuit = 0;
+	SDL_AtomicSet(&ps->mNextEmitter, 0);
+
+	ps->mLock = SDL_CreateMutex();
+	ps->mStart = SDL_CreateCond();
+	ps->mDone = SDL_CreateCond();
+	if(ps->mLock == NULL || ps->mStart == NULL || ps->mDone == NULL) {
+		SDL_Log("%s(), failed to create lock. %s", __func__, SDL_GetError());
+		return -1;
+	}
 
-	p->mPosX = x - 5 + (rand() % 25);
-	p->mPosY = y - 5 + (rand() % 25);
+	if(workers > MAX_WORKERS)
+		workers = MAX_WORKERS;
+
+	for(i = 0; i < workers; ++i) {
+		ps->mWorkers[i] = SDL_CreateThread(
+						ParticleSystem_worker,
+						"ParticleWorker",
+						ps);
+		if(ps->mWorkers[i] == NULL) {
+			SDL_Log("%s(), SDL_CreateThread failed. %s", __func__, SDL_GetError());
+			return -1;
+		}
+		ps->mWorkerCount++;
+	}
 
-	p->mFrame = rand() % 5;
+	return 0;
+}
 
-	switch(rand() % 3)
-	{
-		case 0: p->mTexture = &gRedTexture; break;
-		case 1: p->mTexture = &gGreenTexture; break;
-		case 2: p->mTexture = &gBlueTexture; break;
+/*
+ * Tells the workers to quit and waits for them before freeing the emitters.
+ * This is safe to call on a system that failed part way through
+ * ParticleSystem_init.
+ */
+void ParticleSystem_free(ParticleSystem *ps)
+{
+	int i;
+
+	if(ps->mLock != NULL) {
+		SDL_LockMutex(ps->mLock);
+		ps->mQuit = 1;
+		SDL_CondBroadcast(ps->mStart);
+		SDL_UnlockMutex(ps->mLock);
 	}
+
+	for(i = 0; i < ps->mWorkerCount; ++i)
+		SDL_WaitThread(ps->mWorkers[i], NULL);
+	ps->mWorkerCount = 0;
+
+	for(i = 0; i < ps->mCount; ++i)
+		ParticlePool_free(&ps->mEmitters[i].mParticles);
+	free(ps->mEmitters);
+	ps->mEmitters = NULL;
+	ps->mCount = 0;
+	ps->mCapacity = 0;
+
+	SDL_DestroyCond(ps->mDone);
+	SDL_DestroyCond(ps->mStart);
+	SDL_DestroyMutex(ps->mLock);
+	ps->mDone = NULL;
+	ps->mStart = NULL;
+	ps->mLock = NULL;
 }
 
 /*
- * In the rendering function we render our texture selected in the constructor
- * and then every other frame we render a semitransparent shimmer texture over
- * it to make it look like the particle is shining. We then update the frame of
- * animation.
+ * Adds an emitter of capacity particles at the given position. Emitters may
+ * only be added between updates.
  */
-void Particle_render(Particle *p)
+ParticleEmitter *ParticleSystem_addEmitter(
+				ParticleSystem *ps,
+				int capacity,
+				int x, int y)
 {
-	LTexture_render(p->mTexture, p->mPosX, p->mPosY, NULL);
+	ParticleEmitter *pe;
+
+	if(ps->mCount == ps->mCapacity) {
+		SDL_Log("%s(), too many emitters.", __func__);
+		return NULL;
+	}
 
-	if(p->mFrame % 2 == 0)
-		LTexture_render(&gShimmerTexture, p->mPosX, p->mPosY, NULL);
+	pe = &ps->mEmitters[ps->mCount];
+	if(ParticlePool_init(&pe->mParticles, capacity, ps->mSeed + ps->mCount))
+		return NULL;
 
-	p->mFrame++;
+	pe->mPosX = x;
+	pe->mPosY = y;
+	ps->mCount++;
+
+	return pe;
 }
 
 /*
- * Once the particle has rendered for a max of 10 frames, we mark it as dead.
+ * To update the system we reset the emitter counter, start a new generation
+ * to wake the workers, take our own share of the emitters and then wait for
+ * the workers to finish theirs. When this returns every emitter is up to date
+ * and the workers are asleep again. The time step is set before the workers
+ * are woken, so they all read the same one.
  */
-short Particle_isDead(Particle *p)
+void ParticleSystem_update(ParticleSystem *ps, float timeStep)
 {
-	return p->mFrame > P_LIFE;
+	SDL_AtomicSet(&ps->mNextEmitter, 0);
+	ps->mTimeStep = timeStep;
+
+	if(ps->mWorkerCount > 0) {
+		SDL_LockMutex(ps->mLock);
+		ps->mGeneration++;
+		ps->mPending = ps->mWorkerCount;
+		SDL_CondBroadcast(ps->mStart);
+		SDL_UnlockMutex(ps->mLock);
+	}
+
+	ParticleSystem_updateShare(ps);
+
+	if(ps->mWorkerCount > 0) {
+		SDL_LockMutex(ps->mLock);
+		while(ps->mPending > 0)
+			SDL_CondWait(ps->mDone, ps->mLock);
+		SDL_UnlockMutex(ps->mLock);
+	}
 }
 
 /*
- * The constructor/destructor now have to allocate/deallocate the particles we
- * render about the dot.
+ * Rendering walks every emitter on the calling thread. On the batched path
+ * all of the emitters share the one batch, so the whole system is drawn with
+ * a single SDL_RenderGeometry call when it is flushed at the end. Should
+ * the batch fill up it flushes along the way too, so the draw calls it made
+ * are taken from its count rather than assumed to be one.
  */
-void Dot_init(Dot *d)
+void ParticleSystem_render(ParticleSystem *ps)
 {
 	int i;
+
+	for(i = 0; i < ps->mCount; ++i) {
+		if(gBatchParticles)
+			ParticlePool_renderBatched(&ps->mEmitters[i].mParticles);
+		else
+			ParticlePool_render(&ps->mEmitters[i].mParticles);
+	}
+
+	if(gBatchParticles) {
+		QuadBatch_flush(&gParticleBatch, &gParticleAtlas);
+		gDrawCalls += gParticleBatch.mDrawCalls;
+		gParticleBatch.mDrawCalls = 0;
+	}
+}
+
+/*
+ * The dot no longer owns its particles, instead it asks the particle system
+ * for an emitter.
+ */
+short Dot_init(Dot *d, ParticleSystem *ps)
+{
 	d->mPosX = 0;
 	d->mPosY = 0;
 
 	d->mVelX = 0;
 	d->mVelY = 0;
 
-	for(i = 0; i < TOTAL_PARTICLES; ++i) {
-		d->particles[i] = malloc(sizeof(Particle));
-		Particle_init(d->particles[i], d->mPosX, d->mPosY);
-	}
-}
+	d->mEmitter = ParticleSystem_addEmitter(
+					ps,
+					TOTAL_PARTICLES,
+					d->mPosX,
+					d->mPosY);
+	if(d->mEmitter == NULL)
+		return -1;
 
-void Dot_free(Dot *d)
-{
-	int i;
-	for(i = 0; i < TOTAL_PARTICLES; ++i)
-		free(d->particles[i]);
+	return 0;
 }
 
 void handle_keyboard_events(Dot *d, SDL_Event *e)
@@ -308,95 +1006,130 @@ void Dot_move(Dot *d)
 
 	if((d->mPosY < 0) || (d->mPosY + DOT_HEIGHT > SCREEN_HEIGHT))
 		d->mPosY -= d->mVelY;
-}
 
-/*
- * Our dot's rendering function now calls our particle rendering function. The
- * particle rendering function checks if there is any particles that are dead
- * and replaces them. After the dead particles are replaced we render all the
- * current particles to the screen.
- */
-void Dot_renderParticles(Dot *d)
-{
-	int i;
-	for(i = 0; i < TOTAL_PARTICLES; ++i) {
-		if(Particle_isDead(d->particles[i])) {
-			Particle_init(d->particles[i], d->mPosX, d->mPosY);
-		}
-		Particle_render(d->particles[i]);
-	}
+	d->mEmitter->mPosX = d->mPosX;
+	d->mEmitter->mPosY = d->mPosY;
 }
 
 void Dot_render(Dot *d)
 {
-	LTexture_render(&gDotTexture, d->mPosX, d->mPosY, NULL);
+	LTexture_render(gDotTexture, d->mPosX, d->mPosY, NULL);
+	++gDrawCalls;
+}
 
-	Dot_renderParticles(d);
+/*
+ * The particle atlas is built from the three particle textures and the
+ * shimmer, as they are in the cache.
+ */
+short buildParticleAtlas(void)
+{
+	LTexture *images[TOTAL_ATLAS_CLIPS] = {
+		gParticleTextures[0], gParticleTextures[1], gParticleTextures[2],
+		gShimmerTexture
+	};
+
+	return LTexture_buildAtlas(
+				&gParticleAtlas,
+				images,
+				TOTAL_ATLAS_CLIPS,
+				gParticleClips);
 }
 
 /*
  * To give our particles a semi transparent look we set their alpha to 192.
+ * The textures are shared through the cache, so the alpha set here is the
+ * one every user of them sees. The same four textures are also copied into
+ * the particle atlas for the batched path, which gives its quads the alpha
+ * through their vertex color instead. Once everything is loaded we log what
+ * the cache has loaded and what that cost.
  */
 short loadMedia(void)
 {
-	if(LTexture_loadFromFile(&gDotTexture, "dot.bmp") < 0)
-		return -1;
+	char *particlePaths[TOTAL_PARTICLE_TEXTURES] = {
+		"red.bmp", "green.bmp", "blue.bmp"
+	};
+	int i;
 
-	if(LTexture_loadFromFile(&gRedTexture, "red.bmp") < 0)
+	gDotTexture = LTextureCache_load(&gTextures, "dot.bmp");
+	if(gDotTexture == NULL)
 		return -1;
 
-	if(LTexture_loadFromFile(&gGreenTexture, "green.bmp") < 0)
+	for(i = 0; i < TOTAL_PARTICLE_TEXTURES; ++i) {
+		gParticleTextures[i] = LTextureCache_load(&gTextures, particlePaths[i]);
+		if(gParticleTextures[i] == NULL)
+			return -1;
+		LTexture_setAlpha(gParticleTextures[i], P_ALPHA);
+	}
+
+	gShimmerTexture = LTextureCache_load(&gTextures, "shimmer.bmp");
+	if(gShimmerTexture == NULL)
 		return -1;
+	LTexture_setAlpha(gShimmerTexture, P_ALPHA);
 
-	if(LTexture_loadFromFile(&gBlueTexture, "blue.bmp") < 0)
+	if(buildParticleAtlas())
 		return -1;
 
-	if(LTexture_loadFromFile(&gShimmerTexture, "shimmer.bmp") < 0)
+	if(QuadBatch_init(&gParticleBatch, BATCH_QUADS) < 0)
 		return -1;
 
-	LTexture_setAlpha(&gRedTexture, 192);
-	LTexture_setAlpha(&gGreenTexture, 192);
-	LTexture_setAlpha(&gBlueTexture, 192);
-	LTexture_setAlpha(&gShimmerTexture, 192);
+	LTextureCache_report(&gTextures);
 
 	return 0;
 }
 
-void close_all(Dot *d)
+void close_all(ParticleSystem *ps)
 {
-	Dot_free(d);
+	int i;
+
+	ParticleSystem_free(ps);
 
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	LTexture_free(&gDotTexture);
-	LTexture_free(&gRedTexture);
-	LTexture_free(&gGreenTexture);
-	LTexture_free(&gBlueTexture);
-	LTexture_free(&gShimmerTexture);
+	LTextureCache_release(&gTextures, gDotTexture);
+	LTextureCache_release(&gTextures, gShimmerTexture);
+	for(i = 0; i < TOTAL_PARTICLE_TEXTURES; ++i)
+		LTextureCache_release(&gTextures, gParticleTextures[i]);
+	gDotTexture = NULL;
+	gShimmerTexture = NULL;
+	SDL_memset(gParticleTextures, 0, sizeof(gParticleTextures));
+	LTextureCache_free(&gTextures);
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
+	LTexture_free(&gParticleAtlas);
+	QuadBatch_free(&gParticleBatch);
 
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
- * Again, since our code is well encapsulated the code in the main loop hardly
- * changes.
+ * Now like most of the tutorials this started out as a super simplified
+ * example with the Dot class functioning as the particle emitter. Here the
+ * particles are controlled by a particle system with its own emitters, and
+ * the dot simply moves its emitter about. Press e to leave a new emitter
+ * wherever the dot is.
  *
- * Now like most of the tutorials this is a super simplified example. In larger
- * program there would be particles controlled by a particle emitter that's its
- * own class, but for the sake of simplicity we're having the Dot class
- * function as a particle emitter.
+ * The particles are updated for the whole system, on every core we have,
+ * once the dot has moved; rendering them happens afterwards on this thread.
+ * As in the frame independent movement tutorial, a step timer tells us how
+ * much time has passed since the particles last moved.
+ *
+ * A headless run steps by HEADLESS_STEP instead and stops after its ticks,
+ * hashing every particle's position on the way out.
  */
-int main(void)
+#ifndef BENCHMARK
+int main(int argc, char* argv[])
 {
 	SDL_Event e;
-	Dot dot;
+	Dot dot = { 0 };
+	ParticleSystem particleSystem = { 0 };
+	ParticlePool *pp;
+	Uint32 lastReport = 0, hash;
+	LTimer stepTimer;
+	float timeStep;
+	int tick = 0, i;
+
+	if(Headless_parseArgs(&gHeadless, argc, argv) < 0)
+		return 1;
 
 	if(init())
 		goto equit;
@@ -404,7 +1137,31 @@ int main(void)
 	if(loadMedia())
 		goto equit;
 
-	Dot_init(&dot);
+	Particle_selectIntegrator();
+
+	if(ParticleSystem_init(
+				&particleSystem,
+				MAX_EMITTERS,
+				SDL_GetCPUCount() - 1,
+				gHeadless.mTicks > 0
+				? HEADLESS_SEED : SDL_GetPerformanceCounter()))
+		goto equit;
+
+	if(Dot_init(&dot, &particleSystem))
+		goto equit;
+
+	if(gHeadless.mTicks > 0) {
+		for(i = 0; i < HEADLESS_EMITTERS; ++i)
+			if(ParticleSystem_addEmitter(
+						&particleSystem,
+						HEADLESS_EMITTER_SIZE,
+						(i % 8 * 2 + 1) * SCREEN_WIDTH / 16,
+						(i / 8 * 2 + 1) * SCREEN_HEIGHT / 16) == NULL)
+				goto equit;
+		Headless_start(&gHeadless);
+	}
+
+	LTimer_start(&stepTimer);
 
 	while(1)
 	{
@@ -428,22 +1185,262 @@ int main(void)
 					gGameController = NULL;
 				}
 				break;
+			case SDL_RENDER_TARGETS_RESET:
+				buildParticleAtlas();
+				break;
+			case SDL_KEYDOWN:
+				if(e.key.keysym.sym == SDLK_b && e.key.repeat == 0)
+					gBatchParticles = !gBatchParticles;
+				if(e.key.keysym.sym == SDLK_e && e.key.repeat == 0)
+					ParticleSystem_addEmitter(
+							&particleSystem,
+							TOTAL_PARTICLES,
+							dot.mPosX,
+							dot.mPosY);
+				handle_keyboard_events(&dot, &e);
+				break;
 			default:
 				handle_keyboard_events(&dot, &e);
 			}
 		}
 
+		if(gHeadless.mTicks > 0) {
+			if(tick == gHeadless.mTicks)
+				break;
+			Headless_steer(tick++, HEADLESS_TURN, DOT_VEL,
+					&dot.mVelX, &dot.mVelY);
+		}
+
 		Dot_move(&dot);
 
+		if(gHeadless.mTicks > 0)
+			timeStep = HEADLESS_STEP;
+		else
+			timeStep = LTimer_getTicks(&stepTimer) / 1000.f;
+		ParticleSystem_update(&particleSystem, timeStep);
+		LTimer_start(&stepTimer);
+
+		if(!gHeadless.mRender)
+			continue;
+
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
+		gDrawCalls = 0;
 		Dot_render(&dot);
+		ParticleSystem_render(&particleSystem);
+
+		if(gHeadless.mTicks == 0 && SDL_GetTicks() - lastReport >= 1000) {
+			SDL_Log("%s particles: %d draw calls per frame.",
+					gBatchParticles ? "Batched" : "Unbatched",
+					gDrawCalls);
+			lastReport = SDL_GetTicks();
+		}
 
 		SDL_RenderPresent(gRenderer);
 	}
+
+	hash = HEADLESS_HASH;
+	for(i = 0; i < particleSystem.mCount; ++i) {
+		pp = &particleSystem.mEmitters[i].mParticles;
+		hash = Headless_hash(hash, pp->mPosX, pp->mCount * sizeof(float));
+		hash = Headless_hash(hash, pp->mPosY, pp->mCount * sizeof(float));
+	}
+	Headless_report(&gHeadless, hash);
 equit:
-	close_all(&dot);
+	close_all(&particleSystem);
 
 	return 0;
 }
+#else
+/*
+ * Particle benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which needs no window and runs each loop through the
+ * benchmark harness.
+ *
+ * It spawns BENCH_SPAWNS particles an iteration the way we used to, with
+ * srand and rand, and then the same number from the pool's generator. It
+ * also times BENCH_NUMBERS raw numbers from rand against Rng_fill.
+ *
+ * It then runs each integrator the CPU supports over a pool of
+ * BENCH_EMITTER_SIZE * BENCH_EMITTERS particles, and finally updates a
+ * particle system of BENCH_EMITTERS emitters with BENCH_EMITTER_SIZE
+ * particles each, first on this thread alone and then with a worker for every
+ * other core.
+ */
+#define BENCH_SPAWNS	100000
+#define BENCH_NUMBERS	(BENCH_SPAWNS * 4)
+#define BENCH_EMITTERS	1000
+#define BENCH_EMITTER_SIZE	1000
+
+typedef struct {
+	ParticlePool mPool;
+	Uint32 *mNumbers;
+	ParticleIntegrator mIntegrate;
+	ParticleSystem mSystem;
+} BenchParticles;
+
+void ParticlePool_spawnLibc(ParticlePool *pp, int i, int x, int y)
+{
+	srand(SDL_GetTicks());
+
+	pp->mPosX[i] = x - 5 + (rand() % 25);
+	pp->mPosY[i] = y - 5 + (rand() % 25);
+
+	pp->mVelX[i] = (rand() % 201 - 100) * (P_SPEED / 100);
+	pp->mVelY[i] = (rand() % 201 - 100) * (P_SPEED / 100);
+
+	pp->mAlpha[i] = P_ALPHA;
+
+	pp->mFrame[i] = rand() % 5;
+
+	pp->mTexture[i] = rand() % TOTAL_PARTICLE_TEXTURES;
+}
+
+void bench_spawnLibc(void *data)
+{
+	BenchParticles *bp = data;
+	int i;
+
+	for(i = 0; i < BENCH_SPAWNS; ++i)
+		ParticlePool_spawnLibc(&bp->mPool, i % TOTAL_PARTICLES, 100, 100);
+}
+
+void bench_spawnRng(void *data)
+{
+	BenchParticles *bp = data;
+	int i;
+
+	for(i = 0; i < BENCH_SPAWNS; ++i)
+		ParticlePool_spawn(&bp->mPool, i % TOTAL_PARTICLES, 100, 100);
+}
+
+void bench_numbersLibc(void *data)
+{
+	BenchParticles *bp = data;
+	int i;
+
+	for(i = 0; i < BENCH_NUMBERS; ++i)
+		bp->mNumbers[i] = rand();
+}
+
+void bench_numbersRng(void *data)
+{
+	BenchParticles *bp = data;
+
+	Rng_fill(&bp->mPool.mRng, bp->mNumbers, BENCH_NUMBERS);
+}
+
+void bench_integrate(void *data)
+{
+	BenchParticles *bp = data;
+
+	bp->mIntegrate(&bp->mPool, P_GRAVITY, P_FADE, 1 / 60.f);
+}
+
+void bench_update(void *data)
+{
+	BenchParticles *bp = data;
+
+	ParticleSystem_update(&bp->mSystem, 1 / 60.f);
+}
+
+/*
+ * Times the integrator over a freshly spawned pool of every benchmark
+ * particle.
+ */
+short bench_integrator(Bench *b, char *name, ParticleIntegrator integrate)
+{
+	BenchParticles bp;
+	int count = BENCH_EMITTERS * BENCH_EMITTER_SIZE;
+
+	if(ParticlePool_init(&bp.mPool, count, 1))
+		return -1;
+
+	for(bp.mPool.mCount = 0; bp.mPool.mCount < count; ++bp.mPool.mCount)
+		ParticlePool_spawn(&bp.mPool, bp.mPool.mCount, 100, 100);
+
+	bp.mIntegrate = integrate;
+	Bench_run(b, name, bench_integrate, &bp, count);
+
+	ParticlePool_free(&bp.mPool);
+
+	return 0;
+}
+
+short bench_particleSystem(Bench *b, char *name, int workers)
+{
+	BenchParticles bp;
+	int i;
+
+	SDL_memset(&bp.mSystem, 0, sizeof(ParticleSystem));
+	if(ParticleSystem_init(&bp.mSystem, BENCH_EMITTERS, workers, 1))
+		goto efree;
+
+	for(i = 0; i < BENCH_EMITTERS; ++i)
+		if(ParticleSystem_addEmitter(&bp.mSystem, BENCH_EMITTER_SIZE,
+					i % SCREEN_WIDTH, i % SCREEN_HEIGHT) == NULL)
+			goto efree;
+
+	Bench_run(b, name, bench_update, &bp,
+			(double)BENCH_EMITTERS * BENCH_EMITTER_SIZE);
+
+	ParticleSystem_free(&bp.mSystem);
+	return 0;
+efree:
+	ParticleSystem_free(&bp.mSystem);
+	return -1;
+}
+
+int main(int argc, char* argv[])
+{
+	Bench bench;
+	BenchParticles bp;
+	int ret = 1;
+
+	if(Bench_init(&bench, "38_particle_engines", argc, argv))
+		return 1;
+
+	Particle_selectIntegrator();
+
+	if(ParticlePool_init(&bp.mPool, TOTAL_PARTICLES, 1))
+		goto equit;
+
+	bp.mNumbers = malloc(BENCH_NUMBERS * sizeof(Uint32));
+	if(bp.mNumbers == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		ParticlePool_free(&bp.mPool);
+		goto equit;
+	}
+
+	Bench_run(&bench, "spawn srand+rand", bench_spawnLibc, &bp, BENCH_SPAWNS);
+	Bench_run(&bench, "spawn Rng", bench_spawnRng, &bp, BENCH_SPAWNS);
+	Bench_run(&bench, "numbers rand", bench_numbersLibc, &bp, BENCH_NUMBERS);
+	Bench_run(&bench, "numbers Rng_fill", bench_numbersRng, &bp, BENCH_NUMBERS);
+
+	free(bp.mNumbers);
+	ParticlePool_free(&bp.mPool);
+
+	if(bench_integrator(&bench, "integrate scalar", Particle_integrateScalar))
+		goto equit;
+#ifdef PARTICLE_X86
+	if(SDL_HasSSE2()
+			&& bench_integrator(&bench, "integrate SSE2", Particle_integrateSSE2))
+		goto equit;
+	if(SDL_HasAVX2()
+			&& bench_integrator(&bench, "integrate AVX2", Particle_integrateAVX2))
+		goto equit;
+#endif
+
+	if(bench_particleSystem(&bench, "update 1 thread", 0))
+		goto equit;
+	if(bench_particleSystem(&bench, "update all threads", SDL_GetCPUCount() - 1))
+		goto equit;
+
+	ret = 0;
+equit:
+	return Bench_finish(&bench) || ret;
+}
+#endif
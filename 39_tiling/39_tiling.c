@@ -17,7 +17,13 @@
  * and is relatively easy to use with text files.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include <sys/stat.h>
+
+#include "ltut.h"
+
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
 
 #define SCREEN_WIDTH	    640
 #define SCREEN_HEIGHT	    480
@@ -27,11 +33,46 @@
 #define TILE_HEIGHT		    80
 #define TOTAL_TILES		    192
 #define TOTAL_TILE_SPRITES	12
+#define MAP_MAGIC		"LMAP"
+#define MAP_VERSION		1
+#define MAP_HEADER_SIZE		20
+#define TILE_BATCH_QUADS	((SCREEN_WIDTH / TILE_WIDTH + 2) \
+				* (SCREEN_HEIGHT / TILE_HEIGHT + 2))
+
+/*
+ * The chunk cache pre-renders CHUNK_TILES by CHUNK_TILES blocks of tiles into
+ * textures, keeping as many as fit in CHUNK_CACHE_BUDGET bytes of video
+ * memory.
+ */
+#define CHUNK_TILES		8
+#define CHUNK_WIDTH		(CHUNK_TILES * TILE_WIDTH)
+#define CHUNK_HEIGHT		(CHUNK_TILES * TILE_HEIGHT)
+#define CHUNK_BYTES		(CHUNK_WIDTH * CHUNK_HEIGHT * 4)
+#define CHUNK_CACHE_BUDGET	(32 * 1024 * 1024)
+#define MAX_VISIBLE_CHUNKS	((SCREEN_WIDTH / CHUNK_WIDTH + 2) \
+				* (SCREEN_HEIGHT / CHUNK_HEIGHT + 2))
+
+/*
+ * The streaming world keeps STREAM_SLOTS chunks of CHUNK_TILES by CHUNK_TILES
+ * tiles in memory, loading the chunks the camera can see along with a ring of
+ * STREAM_RING chunks around them. Chunks are handed between threads through
+ * queues of STREAM_QUEUE entries, which must be a power of two.
+ */
+#define STREAM_SLOTS		64
+#define STREAM_RING		1
+#define STREAM_QUEUE		64
 
 #define DOT_WIDTH		20
 #define DOT_HEIGHT		20
 #define DOT_VEL			10
 
+/*
+ * In a headless run the scripted dot turns a quarter turn every HEADLESS_TURN
+ * ticks, long enough for it to cross most of the level and drag the camera
+ * along.
+ */
+#define HEADLESS_TURN	90
+
 /*
  * Here we're defining some constants. We'll be using scrolling so we have
  * constants for both the screen and the level. We'll also have constants to
@@ -50,26 +91,111 @@
 #define TILE_LEFT		 10
 #define TILE_TOPLEFT	 11
 
+/*
+ * Here is our tile map with related functions to render a tile using a
+ * camera, and some accessors to get a tile's type and collision box. Rather
+ * than keeping a separate tile with its own collision box for every spot in
+ * the level, the map is a dense grid of tile types stored row by row. Since
+ * every tile is the same size, a tile's position follows from where it is in
+ * the grid: the tile in column x and row y covers the box that starts at
+ * (x * TILE_WIDTH, y * TILE_HEIGHT). Going the other way, the tile under any
+ * point in the level is found with a divide rather than a search.
+ *
+ * In terms of data members we have the type of each tile and the width and
+ * height of the map counted in tiles.
+ */
 typedef struct {
-	SDL_Texture* mTexture;
-	int mWidth;
-	int mHeight;
-} LTexture;
+	Uint8 *mTypes;
+	int mWidth, mHeight;
+} TileMap;
 
 /*
- * Here is our tile struct with related functions that defines position and
- * type, a renderer that uses a camera, and some accessors to get the tile's
- * type and collision box. In terms of data members we have a collision box and
- * type indicator.
+ * Most of a level never changes, so there's no need to draw it tile by tile
+ * every frame. The chunk cache renders blocks of tiles once into target
+ * textures, as in the render to texture tutorial, and from then on each
+ * block on screen is a single copy: with chunks the size of the screen that
+ * is four copies at most, however many tiles they hold.
  *
- * Normally it's a good idea to have position and collider separate when doing
- * collision detection, but for the sake of simplicity we're using the collider
- * to hold position. 
+ * Each tile chunk is a slot in the cache holding the texture for the chunk
+ * at mChunkX, mChunkY (counted in chunks), whether the texture needs to be
+ * redrawn, and the frame it was last drawn on. The cache has room for as
+ * many chunks as fit in its video memory budget; once it is full, the chunk
+ * that has gone unused the longest is evicted and its texture reused.
  */
 typedef struct {
-	SDL_Rect mBox;
-	int mType;
-} Tile;
+	LTexture mTexture;
+	int mChunkX, mChunkY;
+	short mDirty;
+	Uint32 mLastUsed;
+} TileChunk;
+
+typedef struct {
+	TileChunk *mChunks;
+	int mCount;
+	int mCapacity;
+	Uint32 mFrame;
+	TileChunk *mVisible[MAX_VISIBLE_CHUNKS];
+	int mVisibleCount;
+} ChunkCache;
+
+/*
+ * A level that is bigger than memory can't be loaded all at once. Instead the
+ * streaming world reads the map file a chunk at a time on a worker thread,
+ * keeping only the chunks around the camera in memory, so the main thread
+ * never waits on the disk.
+ *
+ * Chunks are passed between the threads through two chunk queues: the main
+ * thread pushes the slots it wants loaded onto the request queue, and the
+ * worker pushes them onto the done queue once they are read. Each queue has
+ * exactly one thread pushing and one popping, so it needs no lock; a ring
+ * buffer with an atomic head, only moved by the popping thread, and an atomic
+ * tail, only moved by the pushing thread, is enough. The slot is written
+ * before the tail is moved, so by the time the other thread sees it the slot
+ * is ready.
+ */
+typedef struct {
+	int mSlots[STREAM_QUEUE];
+	SDL_atomic_t mHead, mTail;
+} ChunkQueue;
+
+/*
+ * A stream chunk is a small tile map holding the tiles of the chunk at
+ * mChunkX, mChunkY. A free slot can be given a chunk to load; while it is
+ * loading it belongs to the worker thread, and once loaded it is ready for
+ * the main thread to use.
+ */
+enum StreamStates {
+	STREAM_FREE,
+	STREAM_LOADING,
+	STREAM_READY
+};
+
+typedef struct {
+	TileMap mMap;
+	int mChunkX, mChunkY;
+	int mState;
+} StreamChunk;
+
+/*
+ * The streaming world holds the map file and its layout, the width and
+ * height of the world in tiles and the chunk slots, along with the worker
+ * thread, the semaphore that wakes it and the two queues.
+ *
+ * A synchronous world has no worker; the update loads every chunk it asks
+ * for there and then. Headless runs stream this way so that what the dot
+ * collides with never depends on how quickly a thread kept up.
+ */
+typedef struct {
+	SDL_RWops *mFile;
+	int mTileSize;
+	int mWidth, mHeight;
+	StreamChunk mChunks[STREAM_SLOTS];
+	ChunkQueue mRequests, mDone;
+	SDL_Thread *mWorker;
+	SDL_sem *mWake;
+	SDL_atomic_t mQuit;
+	short mSync;
+} StreamWorld;
 
 /*
  * Here is the dot class yet again, now with the ability to check for collision
@@ -81,165 +207,700 @@ typedef struct {
 } Dot;
 
 /*
- * Our media loading function will also be initializing tiles so it need to
- * take them in as an argument.
+ * Our media loading function will also be initializing the tile map so it
+ * need to take it in as an argument.
  *
- * We also the touchesWall function that checks a collision box against every
- * wall in a tile set which will be used when we need to check the dot against
- * the whole tile set. Finally the setTiles function loads and sets the tiles.
+ * We also the touchesWall function that checks a collision box against the
+ * walls in a tile map which will be used when we need to check the dot
+ * against the level. Finally the setTiles function loads and sets the tiles.
  */
 short checkCollision(SDL_Rect *a, SDL_Rect *b);
-short touchesWall(SDL_Rect *box, Tile *tiles[]);
-short setTiles(Tile *tiles[]);
+short touchesWall(SDL_Rect *box, TileMap *map);
+short setTiles(TileMap *map);
+short TileMap_loadText(TileMap *map, char *path);
+short TileMap_loadBinary(TileMap *map, char *path);
+short isNewer(char *path, char *than);
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 LTexture gDotTexture;
 LTexture gTileTexture;
 SDL_Rect gTileClips[TOTAL_TILE_SPRITES];
+QuadBatch gTileBatch;
+Headless gHeadless = { 0, 1, 0 };
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
+	return LTut_init(
+			"SDL Tutorial",
+			SCREEN_WIDTH,
+			SCREEN_HEIGHT,
+			0,
+			LTUT_VSYNC | LTUT_LINEAR
+			| (gHeadless.mTicks > 0 ? LTUT_HEADLESS : 0));
+}
 
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering not enabled.");
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
+/*
+ * The tile map constructor allocates the grid for a map of the given number
+ * of tiles across and down; the tiles themselves are set by setTiles.
+ */
+short TileMap_init(TileMap *map, int width, int height)
+{
+	map->mTypes = malloc(width * height);
+	if(map->mTypes == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
 		return -1;
 	}
 
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+	map->mWidth = width;
+	map->mHeight = height;
+
+	return 0;
+}
+
+void TileMap_free(TileMap *map)
+{
+	free(map->mTypes);
+	map->mTypes = NULL;
+	map->mWidth = 0;
+	map->mHeight = 0;
+}
+
+/*
+ * And here are the accessors to get a tile's type and collision box.
+ */
+int TileMap_getType(TileMap *map, int x, int y)
+{
+	return map->mTypes[y * map->mWidth + x];
+}
+
+void TileMap_setType(TileMap *map, int x, int y, int tileType)
+{
+	map->mTypes[y * map->mWidth + x] = tileType;
+}
+
+SDL_Rect TileMap_getBox(int x, int y)
+{
+	SDL_Rect box = { x * TILE_WIDTH, y * TILE_HEIGHT, TILE_WIDTH, TILE_HEIGHT };
+	return box;
+}
+
+/*
+ * If you check back when we defined the tile constants, you'll see that the
+ * wall tiles TILE_CENTER through TILE_TOPLEFT are numbered right next to each
+ * other so all we have to do is check if the type is between them.
+ */
+short Tile_isWall(int tileType)
+{
+	return (tileType >= TILE_CENTER) && (tileType <= TILE_TOPLEFT);
+}
+
+/*
+ * When we render we only want to show tiles that are in the camera's sight.
+ * Rather than checking every tile in the level against the camera, we work
+ * out the span of columns and rows the camera covers, the same way
+ * touchesWall does for a collision box, and only visit those tiles. The cost
+ * of a frame then depends on the size of the screen and not the size of the
+ * level. Notice also that we render the tiles relative to the camera.
+ *
+ * Every tile comes from the one tile sheet, so rather than a copy per tile we
+ * add each one to the tile batch and draw the whole screen of tiles with a
+ * single SDL_RenderGeometry call when it is flushed.
+ */
+void TileMap_render(TileMap *map, SDL_Rect *camera)
+{
+	SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+	int left, right, top, bottom, x, y;
+
+	if(camera->x + camera->w <= 0 || camera->y + camera->h <= 0)
+		return;
+
+	left = SDL_max(camera->x / TILE_WIDTH, 0);
+	top = SDL_max(camera->y / TILE_HEIGHT, 0);
+	right = SDL_min((camera->x + camera->w - 1) / TILE_WIDTH, map->mWidth - 1);
+	bottom = SDL_min((camera->y + camera->h - 1) / TILE_HEIGHT, map->mHeight - 1);
+
+	for(y = top; y <= bottom; ++y)
+		for(x = left; x <= right; ++x)
+			QuadBatch_addQuad(
+					&gTileBatch,
+					&gTileTexture,
+					&gTileClips[TileMap_getType(map, x, y)],
+					x * TILE_WIDTH - camera->x,
+					y * TILE_HEIGHT - camera->y,
+					white);
+
+	QuadBatch_flush(&gTileBatch, &gTileTexture);
+}
+
+/*
+ * The cache works out how many chunks fit in the budget and allocates the
+ * slots for them; the textures themselves are only created as slots are
+ * first used.
+ */
+short ChunkCache_init(ChunkCache *cc, int budget)
+{
+	cc->mCapacity = SDL_max(budget / CHUNK_BYTES, 1);
+	cc->mChunks = calloc(cc->mCapacity, sizeof(TileChunk));
+	if(cc->mChunks == NULL) {
+		SDL_Log("%s(), calloc failed.", __func__);
 		return -1;
 	}
 
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+	cc->mCount = 0;
+	cc->mFrame = 0;
+	cc->mVisibleCount = 0;
 
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
+	SDL_Log("Chunk cache holds %d chunks of %dx%d tiles.",
+			cc->mCapacity, CHUNK_TILES, CHUNK_TILES);
+
+	return 0;
+}
+
+void ChunkCache_free(ChunkCache *cc)
+{
+	int i;
+	for(i = 0; i < cc->mCount; ++i)
+		LTexture_free(&cc->mChunks[i].mTexture);
+
+	free(cc->mChunks);
+	cc->mChunks = NULL;
+	cc->mCount = 0;
+	cc->mCapacity = 0;
+	cc->mVisibleCount = 0;
+}
+
+/*
+ * When a tile changes, the chunk holding it has to be redrawn. Nothing
+ * happens if the chunk isn't in the cache since it'll be drawn fresh anyway.
+ */
+void ChunkCache_invalidateTile(ChunkCache *cc, int x, int y)
+{
+	int i;
+	for(i = 0; i < cc->mCount; ++i)
+		if(cc->mChunks[i].mChunkX == x / CHUNK_TILES
+				&& cc->mChunks[i].mChunkY == y / CHUNK_TILES)
+			cc->mChunks[i].mDirty = 1;
+}
+
+/*
+ * The renderer can lose the contents of target textures, for instance when
+ * the window is moved to another display; when it does every chunk has to be
+ * redrawn.
+ */
+void ChunkCache_invalidateAll(ChunkCache *cc)
+{
+	int i;
+	for(i = 0; i < cc->mCount; ++i)
+		cc->mChunks[i].mDirty = 1;
+}
+
+/*
+ * Returns the slot for the chunk at x, y. If the chunk is cached we simply
+ * return it. Otherwise we take an unused slot, creating its texture, or once
+ * every slot is in use the least recently used one. Chunks already used this
+ * frame are on screen and can't be evicted, so if there is nothing else to
+ * evict we return NULL.
+ */
+TileChunk *ChunkCache_find(ChunkCache *cc, int x, int y)
+{
+	TileChunk *chunk = NULL;
+	int i;
+
+	for(i = 0; i < cc->mCount; ++i)
+		if(cc->mChunks[i].mChunkX == x && cc->mChunks[i].mChunkY == y)
+			return &cc->mChunks[i];
+
+	if(cc->mCount < cc->mCapacity) {
+		chunk = &cc->mChunks[cc->mCount];
+		if(LTexture_createBlank(
+					&chunk->mTexture,
+					CHUNK_WIDTH,
+					CHUNK_HEIGHT,
+					SDL_TEXTUREACCESS_TARGET))
+			return NULL;
+		SDL_SetTextureBlendMode(chunk->mTexture.mTexture, SDL_BLENDMODE_BLEND);
+		cc->mCount++;
+	} else {
+		for(i = 0; i < cc->mCount; ++i)
+			if(cc->mChunks[i].mLastUsed != cc->mFrame
+					&& (chunk == NULL
+						|| cc->mChunks[i].mLastUsed < chunk->mLastUsed))
+				chunk = &cc->mChunks[i];
+
+		if(chunk == NULL)
+			return NULL;
 	}
 
+	chunk->mChunkX = x;
+	chunk->mChunkY = y;
+	chunk->mDirty = 1;
+
+	return chunk;
+}
+
+/*
+ * To draw a chunk into its texture we make the texture the render target,
+ * clear it to transparent and render the tiles using the chunk's box in the
+ * level as the camera; TileMap_render then draws exactly the tiles in the
+ * chunk, relative to its corner.
+ */
+void TileChunk_redraw(TileChunk *chunk, TileMap *map)
+{
+	SDL_Rect box = {
+		chunk->mChunkX * CHUNK_WIDTH,
+		chunk->mChunkY * CHUNK_HEIGHT,
+		CHUNK_WIDTH,
+		CHUNK_HEIGHT };
+
+	LTexture_setAsRenderTarget(&chunk->mTexture);
+
+	SDL_SetRenderDrawColor(gRenderer, 0x00, 0x00, 0x00, 0x00);
+	SDL_RenderClear(gRenderer);
+
+	TileMap_render(map, &box);
+
+	chunk->mDirty = 0;
+}
+
+/*
+ * Before we clear the screen we make sure every chunk the camera can see is
+ * in the cache and up to date, redrawing the ones that aren't. This is done
+ * before rendering the frame since drawing the chunks changes the render
+ * target. If the cache is too small to hold every chunk on screen this
+ * returns -1, and the tiles have to be rendered directly instead.
+ */
+short ChunkCache_prepare(ChunkCache *cc, TileMap *map, SDL_Rect *camera)
+{
+	TileChunk *chunk;
+	int left, right, top, bottom, x, y;
+
+	cc->mFrame++;
+	cc->mVisibleCount = 0;
+
+	if(camera->x + camera->w <= 0 || camera->y + camera->h <= 0)
+		return 0;
+
+	left = SDL_max(camera->x / CHUNK_WIDTH, 0);
+	top = SDL_max(camera->y / CHUNK_HEIGHT, 0);
+	right = SDL_min((camera->x + camera->w - 1) / CHUNK_WIDTH,
+			(map->mWidth - 1) / CHUNK_TILES);
+	bottom = SDL_min((camera->y + camera->h - 1) / CHUNK_HEIGHT,
+			(map->mHeight - 1) / CHUNK_TILES);
+
+	for(y = top; y <= bottom; ++y)
+		for(x = left; x <= right; ++x) {
+			chunk = ChunkCache_find(cc, x, y);
+			if(chunk == NULL || cc->mVisibleCount == MAX_VISIBLE_CHUNKS) {
+				SDL_SetRenderTarget(gRenderer, NULL);
+				return -1;
+			}
+
+			if(chunk->mDirty)
+				TileChunk_redraw(chunk, map);
+
+			chunk->mLastUsed = cc->mFrame;
+			cc->mVisibleCount++;
+			cc->mVisible[cc->mVisibleCount - 1] = chunk;
+		}
+
+	SDL_SetRenderTarget(gRenderer, NULL);
+
 	return 0;
 }
 
-void LTexture_free(LTexture *lt)
+/*
+ * Rendering the chunks the camera can see is a copy each, relative to the
+ * camera.
+ */
+void ChunkCache_render(ChunkCache *cc, SDL_Rect *camera)
 {
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
+	TileChunk *chunk;
+	int i;
+
+	for(i = 0; i < cc->mVisibleCount; ++i) {
+		chunk = cc->mVisible[i];
+		LTexture_render(
+				&chunk->mTexture,
+				chunk->mChunkX * CHUNK_WIDTH - camera->x,
+				chunk->mChunkY * CHUNK_HEIGHT - camera->y,
+				NULL);
 	}
 }
 
-short LTexture_loadFromFile(LTexture *lt, char *path)
+/*
+ * Pushing fails if the queue is full and popping if it is empty. The head
+ * and tail only ever count up, the slot they point to is found by masking
+ * them with the size of the ring.
+ */
+short ChunkQueue_push(ChunkQueue *q, int slot)
 {
-	LTexture_free(lt);
+	Uint32 tail = SDL_AtomicGet(&q->mTail);
 
-	SDL_Texture* newTexture = NULL;
+	if(tail - (Uint32)SDL_AtomicGet(&q->mHead) == STREAM_QUEUE)
+		return -1;
 
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
+	q->mSlots[tail & (STREAM_QUEUE - 1)] = slot;
+	SDL_AtomicSet(&q->mTail, tail + 1);
 
+	return 0;
+}
+
+short ChunkQueue_pop(ChunkQueue *q, int *slot)
+{
+	Uint32 head = SDL_AtomicGet(&q->mHead);
+
+	if(head == (Uint32)SDL_AtomicGet(&q->mTail))
 		return -1;
+
+	*slot = q->mSlots[head & (STREAM_QUEUE - 1)];
+	SDL_AtomicSet(&q->mHead, head + 1);
+
+	return 0;
+}
+
+/*
+ * The worker reads a chunk one row at a time, seeking to where the row
+ * starts in the first layer of the map. Should the read fail or the map hold
+ * a tile type we have no sprite for, the chunk is filled with wall so the dot
+ * can't walk into it.
+ */
+void StreamWorld_loadChunk(StreamWorld *sw, StreamChunk *chunk)
+{
+	TileMap *map = &chunk->mMap;
+	Uint16 wide[CHUNK_TILES];
+	Uint8 *row;
+	Sint64 offset;
+	int x, y;
+
+	for(y = 0; y < map->mHeight; ++y) {
+		row = map->mTypes + y * map->mWidth;
+		offset = MAP_HEADER_SIZE + ((Sint64)(chunk->mChunkY * CHUNK_TILES + y)
+				* sw->mWidth + chunk->mChunkX * CHUNK_TILES) * sw->mTileSize;
+
+		if(SDL_RWseek(sw->mFile, offset, RW_SEEK_SET) < 0)
+			goto error;
+
+		if(sw->mTileSize == 1) {
+			if(SDL_RWread(sw->mFile, row, map->mWidth, 1) != 1)
+				goto error;
+		} else {
+			if(SDL_RWread(sw->mFile, wide, map->mWidth * sizeof(Uint16), 1) != 1)
+				goto error;
+			for(x = 0; x < map->mWidth; ++x) {
+				wide[x] = SDL_SwapLE16(wide[x]);
+				row[x] = wide[x] < TOTAL_TILE_SPRITES
+					? wide[x] : TOTAL_TILE_SPRITES;
+			}
+		}
+
+		for(x = 0; x < map->mWidth; ++x)
+			if(row[x] >= TOTAL_TILE_SPRITES)
+				goto error;
 	}
 
-	SDL_SetColorKey(
-			loadedSurface,
-			SDL_TRUE,
-			SDL_MapRGB(loadedSurface->format, 0, 0xFF, 0xFF));
+	return;
+error:
+	SDL_Log("%s(), failed to load chunk %d, %d.",
+			__func__, chunk->mChunkX, chunk->mChunkY);
+	memset(map->mTypes, TILE_CENTER, map->mWidth * map->mHeight);
+}
+
+/*
+ * The worker sleeps on the semaphore until the main thread has requests for
+ * it, then loads every chunk in the request queue and hands each one back.
+ * The done queue has room for every slot, so pushing onto it can't fail.
+ */
+int StreamWorld_worker(void *data)
+{
+	StreamWorld *sw = data;
+	int slot;
 
-	newTexture = SDL_CreateTextureFromSurface(gRenderer, loadedSurface);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
+	while(SDL_SemWait(sw->mWake) == 0 && SDL_AtomicGet(&sw->mQuit) == 0)
+		while(ChunkQueue_pop(&sw->mRequests, &slot) == 0) {
+			StreamWorld_loadChunk(sw, &sw->mChunks[slot]);
+			ChunkQueue_push(&sw->mDone, slot);
+		}
 
+	return 0;
+}
+
+/*
+ * Opening the world reads the header of a binary map, the same as
+ * TileMap_loadBinary, but none of its tiles; those are left to the worker
+ * which owns the file from here on, unless the world is synchronous. Each
+ * slot gets room for a whole chunk up front so nothing is allocated while
+ * streaming.
+ */
+short StreamWorld_open(StreamWorld *sw, char *path, short sync)
+{
+	char magic[4];
+	Uint16 version, tileSize;
+	Uint32 width, height, layers;
+	int i;
+
+	SDL_memset(sw, 0, sizeof(StreamWorld));
+
+	sw->mFile = SDL_RWFromFile(path, "rb");
+	if(sw->mFile == NULL) {
+		SDL_Log("%s(), SDL_RWFromFile failed. %s", __func__, SDL_GetError());
 		return -1;
 	}
 
-	lt->mWidth = loadedSurface->w;
-	lt->mHeight = loadedSurface->h;
+	if(SDL_RWread(sw->mFile, magic, sizeof(magic), 1) != 1
+			|| memcmp(magic, MAP_MAGIC, sizeof(magic)) != 0) {
+		SDL_Log("%s(), %s is not a map file.", __func__, path);
+		goto error;
+	}
+
+	version = SDL_ReadLE16(sw->mFile);
+	tileSize = SDL_ReadLE16(sw->mFile);
+	width = SDL_ReadLE32(sw->mFile);
+	height = SDL_ReadLE32(sw->mFile);
+	layers = SDL_ReadLE32(sw->mFile);
+
+	if(version != MAP_VERSION || (tileSize != 1 && tileSize != 2)
+			|| width == 0 || height == 0 || layers == 0
+			|| width > SDL_MAX_SINT32 / TILE_WIDTH
+			|| height > SDL_MAX_SINT32 / TILE_HEIGHT) {
+		SDL_Log("%s(), %s has a bad header.", __func__, path);
+		goto error;
+	}
+
+	sw->mTileSize = tileSize;
+	sw->mWidth = width;
+	sw->mHeight = height;
+	sw->mSync = sync;
+
+	for(i = 0; i < STREAM_SLOTS; ++i)
+		if(TileMap_init(&sw->mChunks[i].mMap, CHUNK_TILES, CHUNK_TILES))
+			goto error;
+
+	if(sync)
+		goto done;
 
-	SDL_FreeSurface(loadedSurface);
+	sw->mWake = SDL_CreateSemaphore(0);
+	if(sw->mWake == NULL) {
+		SDL_Log("%s(), SDL_CreateSemaphore failed. %s", __func__, SDL_GetError());
+		goto error;
+	}
 
-	lt->mTexture = newTexture;
+	sw->mWorker = SDL_CreateThread(StreamWorld_worker, "StreamWorld", sw);
+	if(sw->mWorker == NULL) {
+		SDL_Log("%s(), SDL_CreateThread failed. %s", __func__, SDL_GetError());
+		goto error;
+	}
+done:
+	SDL_Log("Streaming a %dx%d tile world from %s.", sw->mWidth, sw->mHeight, path);
 
 	return 0;
+error:
+	for(i = 0; i < STREAM_SLOTS; ++i)
+		TileMap_free(&sw->mChunks[i].mMap);
+	if(sw->mWake)
+		SDL_DestroySemaphore(sw->mWake);
+	SDL_RWclose(sw->mFile);
+	SDL_memset(sw, 0, sizeof(StreamWorld));
+
+	return -1;
 }
 
-void LTexture_render(
-			LTexture *lt, 
-			int x, int y,
-			SDL_Rect* clip)
+/*
+ * To close the world we tell the worker to quit and wake it, wait for it to
+ * finish whatever chunk it is on and then free everything.
+ */
+void StreamWorld_close(StreamWorld *sw)
 {
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+	int i;
 
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
+	if(sw->mFile == NULL)
+		return;
+
+	if(sw->mWorker) {
+		SDL_AtomicSet(&sw->mQuit, 1);
+		SDL_SemPost(sw->mWake);
+		SDL_WaitThread(sw->mWorker, NULL);
+		SDL_DestroySemaphore(sw->mWake);
 	}
 
-	SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
+	for(i = 0; i < STREAM_SLOTS; ++i)
+		TileMap_free(&sw->mChunks[i].mMap);
+	SDL_RWclose(sw->mFile);
+	SDL_memset(sw, 0, sizeof(StreamWorld));
 }
 
 /*
- * The tile constructor initializes position, dimensions, and type.
+ * Returns the slot holding the chunk at x, y whether it is ready or still
+ * loading, or NULL when it isn't in memory at all.
  */
-void Tile_init(Tile *t, int x, int y, int tileType)
+StreamChunk *StreamWorld_find(StreamWorld *sw, int x, int y)
 {
-	t->mBox.x = x;
-	t->mBox.y = y;
+	int i;
+	for(i = 0; i < STREAM_SLOTS; ++i)
+		if(sw->mChunks[i].mState != STREAM_FREE
+				&& sw->mChunks[i].mChunkX == x && sw->mChunks[i].mChunkY == y)
+			return &sw->mChunks[i];
+	return NULL;
+}
 
-	t->mBox.w = TILE_WIDTH;
-	t->mBox.h = TILE_HEIGHT;
+/*
+ * Works out the span of chunks the camera can see, grown by ring chunks on
+ * every side and kept inside the world.
+ */
+void StreamWorld_span(
+			StreamWorld *sw,
+			SDL_Rect *camera,
+			int ring,
+			SDL_Rect *span)
+{
+	int right, bottom;
+
+	span->x = SDL_max(camera->x / CHUNK_WIDTH - ring, 0);
+	span->y = SDL_max(camera->y / CHUNK_HEIGHT - ring, 0);
+	right = SDL_min((camera->x + camera->w - 1) / CHUNK_WIDTH + ring,
+			(sw->mWidth - 1) / CHUNK_TILES);
+	bottom = SDL_min((camera->y + camera->h - 1) / CHUNK_HEIGHT + ring,
+			(sw->mHeight - 1) / CHUNK_TILES);
+	span->w = right - span->x + 1;
+	span->h = bottom - span->y + 1;
+}
 
-	t->mType = tileType;
+/*
+ * The update is called once a frame after the camera has been set, and never
+ * waits on the worker. First it takes in every chunk the worker has finished
+ * since the last frame. Then ready chunks that have drifted more than a ring
+ * beyond the prefetch ring are freed; keeping that extra ring stops a dot
+ * sitting on a chunk boundary from loading and freeing the same chunks over
+ * and over. Finally every chunk in sight or in the prefetch ring that isn't
+ * in memory is given a free slot and requested, the ones in sight first.
+ * Slots that are still loading are left alone since the worker owns them. If
+ * we run out of free slots the rest are requested on a later frame.
+ *
+ * A synchronous world loads each chunk as soon as it has a slot instead, so
+ * every chunk it asks for is ready by the time the update returns.
+ */
+void StreamWorld_update(StreamWorld *sw, SDL_Rect *camera)
+{
+	StreamChunk *chunk;
+	SDL_Rect keep, want;
+	int ring, slot, requests = 0, x, y, i;
+
+	while(ChunkQueue_pop(&sw->mDone, &slot) == 0)
+		sw->mChunks[slot].mState = STREAM_READY;
+
+	StreamWorld_span(sw, camera, STREAM_RING + 1, &keep);
+
+	for(i = 0; i < STREAM_SLOTS; ++i) {
+		chunk = &sw->mChunks[i];
+		if(chunk->mState == STREAM_READY
+				&& (chunk->mChunkX < keep.x
+					|| chunk->mChunkX >= keep.x + keep.w
+					|| chunk->mChunkY < keep.y
+					|| chunk->mChunkY >= keep.y + keep.h))
+			chunk->mState = STREAM_FREE;
+	}
+
+	slot = 0;
+	for(ring = 0; ring <= STREAM_RING; ++ring) {
+		StreamWorld_span(sw, camera, ring, &want);
+		for(y = want.y; y < want.y + want.h; ++y)
+			for(x = want.x; x < want.x + want.w; ++x) {
+				if(StreamWorld_find(sw, x, y))
+					continue;
+
+				while(slot < STREAM_SLOTS
+						&& sw->mChunks[slot].mState != STREAM_FREE)
+					slot++;
+				if(slot == STREAM_SLOTS)
+					goto wake;
+
+				chunk = &sw->mChunks[slot];
+				chunk->mChunkX = x;
+				chunk->mChunkY = y;
+				chunk->mMap.mWidth = SDL_min(CHUNK_TILES,
+						sw->mWidth - x * CHUNK_TILES);
+				chunk->mMap.mHeight = SDL_min(CHUNK_TILES,
+						sw->mHeight - y * CHUNK_TILES);
+
+				if(sw->mSync) {
+					StreamWorld_loadChunk(sw, chunk);
+					chunk->mState = STREAM_READY;
+					continue;
+				}
+
+				if(ChunkQueue_push(&sw->mRequests, slot))
+					goto wake;
+
+				chunk->mState = STREAM_LOADING;
+				requests++;
+			}
+	}
+wake:
+	if(requests)
+		SDL_SemPost(sw->mWake);
 }
 
 /*
- * When we render we only want to show tiles that are in the camera's sight; So
- * we check if the tile collides with the camera before rendering it. Notice
- * also that we render the tile relative to the camera.
+ * A tile in a chunk that hasn't arrived yet counts as a wall, so the dot
+ * waits at the edge of the world that is loaded rather than walking into
+ * the unknown.
  */
-void Tile_render(Tile *t, SDL_Rect *camera)
+int StreamWorld_getType(StreamWorld *sw, int x, int y)
 {
-	if(checkCollision(camera, &t->mBox))
-		LTexture_render(
-				&gTileTexture,
-				t->mBox.x - camera->x,
-				t->mBox.y - camera->y,
-				&gTileClips[t->mType]);
+	StreamChunk *chunk = StreamWorld_find(sw, x / CHUNK_TILES, y / CHUNK_TILES);
+
+	if(chunk == NULL || chunk->mState != STREAM_READY)
+		return TILE_CENTER;
+
+	return TileMap_getType(&chunk->mMap, x % CHUNK_TILES, y % CHUNK_TILES);
 }
 
 /*
- * And here are the accessors to get the tile's type and collision box.
+ * This is touchesWall for the streaming world; it visits the same tiles,
+ * but finds them through the chunks.
  */
-int Tile_getType(Tile *t)
+short StreamWorld_touchesWall(StreamWorld *sw, SDL_Rect *box)
 {
-	return t->mType;
+	int left, right, top, bottom, x, y;
+
+	if(box->x + box->w <= 0 || box->y + box->h <= 0)
+		return 0;
+
+	left = SDL_max(box->x / TILE_WIDTH, 0);
+	top = SDL_max(box->y / TILE_HEIGHT, 0);
+	right = SDL_min((box->x + box->w - 1) / TILE_WIDTH, sw->mWidth - 1);
+	bottom = SDL_min((box->y + box->h - 1) / TILE_HEIGHT, sw->mHeight - 1);
+
+	for(y = top; y <= bottom; ++y)
+		for(x = left; x <= right; ++x)
+			if(Tile_isWall(StreamWorld_getType(sw, x, y)))
+				return 1;
+	return 0;
 }
 
-SDL_Rect *Tile_getBox(Tile *t)
+/*
+ * Each chunk in sight that is ready is rendered with TileMap_render, moving
+ * the camera so that it is relative to the corner of the chunk. Chunks still
+ * on their way are simply left blank.
+ */
+void StreamWorld_render(StreamWorld *sw, SDL_Rect *camera)
 {
-	return &t->mBox;
+	StreamChunk *chunk;
+	SDL_Rect span, local;
+	int x, y;
+
+	StreamWorld_span(sw, camera, 0, &span);
+
+	for(y = span.y; y < span.y + span.h; ++y)
+		for(x = span.x; x < span.x + span.w; ++x) {
+			chunk = StreamWorld_find(sw, x, y);
+			if(chunk == NULL || chunk->mState != STREAM_READY)
+				continue;
+
+			local.x = camera->x - x * CHUNK_WIDTH;
+			local.y = camera->y - y * CHUNK_HEIGHT;
+			local.w = camera->w;
+			local.h = camera->h;
+			TileMap_render(&chunk->mMap, &local);
+		}
 }
 
 void Dot_init(Dot *d)
@@ -278,28 +939,48 @@ void handle_keyboard_events(Dot *d, SDL_Event *e)
 
 /*
  * When we move the dot we check if it goes off the level or hits a wall tile.
- * If it does we correct it.
+ * If it does we correct it. The size of the level comes from the map.
  */
-void Dot_move(Dot *d, Tile *tiles[])
+void Dot_move(Dot *d, TileMap *map)
 {
 	d->mBox.x += d->mVelX;
 
-	if((d->mBox.x < 0) || (d->mBox.x + DOT_WIDTH > LEVEL_WIDTH)
-			|| touchesWall(&d->mBox, tiles))
+	if((d->mBox.x < 0) || (d->mBox.x + DOT_WIDTH > map->mWidth * TILE_WIDTH)
+			|| touchesWall(&d->mBox, map))
 		d->mBox.x -= d->mVelX;
 
 	d->mBox.y += d->mVelY;
 
-	if((d->mBox.y < 0) || (d->mBox.y + DOT_HEIGHT > LEVEL_HEIGHT)
-			|| touchesWall(&d->mBox, tiles))
+	if((d->mBox.y < 0) || (d->mBox.y + DOT_HEIGHT > map->mHeight * TILE_HEIGHT)
+			|| touchesWall(&d->mBox, map))
+		d->mBox.y -= d->mVelY;
+}
+
+/*
+ * Moving through the streaming world is just the same, checking against the
+ * size of the world and the chunks that are loaded.
+ */
+void Dot_moveStreamed(Dot *d, StreamWorld *sw)
+{
+	d->mBox.x += d->mVelX;
+
+	if((d->mBox.x < 0) || (d->mBox.x + DOT_WIDTH > sw->mWidth * TILE_WIDTH)
+			|| StreamWorld_touchesWall(sw, &d->mBox))
+		d->mBox.x -= d->mVelX;
+
+	d->mBox.y += d->mVelY;
+
+	if((d->mBox.y < 0) || (d->mBox.y + DOT_HEIGHT > sw->mHeight * TILE_HEIGHT)
+			|| StreamWorld_touchesWall(sw, &d->mBox))
 		d->mBox.y -= d->mVelY;
 }
 
 /*
  * Here is the rendering code largely lifted from the scrolling/camera
- * tutorial.
+ * tutorial. The camera is kept inside the level, whose size in tiles is
+ * passed in so the same code serves the tile map and the streaming world.
  */
-void Dot_setCamera(Dot *d, SDL_Rect *camera)
+void Dot_setCamera(Dot *d, SDL_Rect *camera, int width, int height)
 {
 	camera->x = (d->mBox.x + DOT_WIDTH / 2) - SCREEN_WIDTH / 2;
 	camera->y = (d->mBox.y + DOT_HEIGHT / 2) - SCREEN_HEIGHT / 2;
@@ -308,10 +989,10 @@ void Dot_setCamera(Dot *d, SDL_Rect *camera)
 		camera->x = 0;
 	if(camera->y < 0)
 		camera->y = 0;
-	if(camera->x > LEVEL_WIDTH - camera->w)
-		camera->x = LEVEL_WIDTH - camera->w;
-	if(camera->y > LEVEL_HEIGHT - camera->h)
-		camera->y = LEVEL_HEIGHT - camera->h;
+	if(camera->x > width * TILE_WIDTH - camera->w)
+		camera->x = width * TILE_WIDTH - camera->w;
+	if(camera->y > height * TILE_HEIGHT - camera->h)
+		camera->y = height * TILE_HEIGHT - camera->h;
 }
 
 void Dot_render(Dot *d, SDL_Rect *camera)
@@ -324,9 +1005,9 @@ void Dot_render(Dot *d, SDL_Rect *camera)
 }
 
 /*
- * In our loading function we not only load the textures but also the tile set.
+ * In our loading function we not only load the textures but also the tile map.
  */
-short loadMedia(Tile* tiles[])
+short loadMedia(TileMap *map)
 {
 	if(LTexture_loadFromFile(&gDotTexture, "dot.bmp"))
 		return -1;
@@ -334,31 +1015,26 @@ short loadMedia(Tile* tiles[])
 	if(LTexture_loadFromFile(&gTileTexture, "tiles.png"))
 		return -1;
 
-	if(setTiles(tiles))
+	if(QuadBatch_init(&gTileBatch, TILE_BATCH_QUADS))
+		return -1;
+
+	if(setTiles(map))
 		return -1;
 
 	return 0;
 }
 
-void close_all(Tile* tiles[])
+void close_all(TileMap *map, ChunkCache *cache, StreamWorld *world)
 {
-	int i;
-	for(i = 0; i < TOTAL_TILES; ++i)
-		if(tiles[i] == NULL) {
-			free(tiles[i]);
-			tiles[i] = NULL;
-		}
+	StreamWorld_close(world);
+	ChunkCache_free(cache);
+	TileMap_free(map);
 
 	LTexture_free(&gDotTexture);
 	LTexture_free(&gTileTexture);
+	QuadBatch_free(&gTileBatch);
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 short checkCollision(SDL_Rect *a, SDL_Rect *b)
@@ -391,9 +1067,9 @@ short checkCollision(SDL_Rect *a, SDL_Rect *b)
 }
 
 /*
- * Near the top of the setTiles function we declare x/y offsets that define
- * where we'll be place the tiles. As we load in more tiles we'll be shift the
- * x/y position left to right and top to bottom.
+ * Near the top of the TileMap_loadText function we declare x/y offsets that
+ * define where we'll be place the tiles. As we load in more tiles we'll be
+ * shift the x/y position left to right and top to bottom.
  *
  * We then open the lazy.map file which is just a text file with the follow
  * contents:
@@ -421,56 +1097,205 @@ short checkCollision(SDL_Rect *a, SDL_Rect *b)
  * NULL, you have to check !map.is_open().
  *
  */
-short setTiles(Tile* tiles[])
+short TileMap_loadText(TileMap *map, char *path)
 {
 	int x = 0, y = 0, i;
 	int tile = -1;
 	FILE *fp;
 
-	fp = fopen("lazy.map", "r");
+	fp = fopen(path, "r");
 
 	if(fp == NULL) {
 		SDL_Log("%s(), fopen failed.", __func__);
 		return -1;
 	}
 /*
- * If the file loaded successfully we have a for loop that reads in all the
- * numbers from the text file. We read a number into the tileType variable and
- * then check if the read failed. If the read failed, we abort.
+ * If the file loaded successfully we create the map and then have a for loop
+ * that reads in all the numbers from the text file. We read a number into the
+ * tileType variable and then check if the read failed. If the read failed, we
+ * abort.
  */
+	if(TileMap_init(map, LEVEL_WIDTH / TILE_WIDTH, LEVEL_HEIGHT / TILE_HEIGHT)) {
+		fclose(fp);
+		return -1;
+	}
+
 	for(i = 0; i < TOTAL_TILES; ++i)
 	{
 		int *tileType;
 		tileType = &tile;
 /* 
- * We then check if the tile type number is valid. If it is valid we create a
- * new tile of the given type, if not we print an error and stop loading tiles.
+ * We then check if the tile type number is valid. If it is valid we set the
+ * tile in the map to the given type, if not we print an error and stop loading
+ * tiles.
  */
 		if(fscanf(fp, "%d", tileType) < 0) {
 			SDL_Log("%s(), fscanf failed.", __func__);
+			fclose(fp);
 			return -1;
 		}
 
 		if((*tileType >= 0) && (*tileType < TOTAL_TILE_SPRITES) == 0) {
 			SDL_Log("%s(), invalid tile type.", __func__);
+			fclose(fp);
 			return -1;
 		}
-		tiles[i] = malloc(sizeof(Tile));
-		Tile_init(tiles[i], x, y, *tileType);
+		TileMap_setType(map, x, y, *tileType);
 /*
  * After loading a tile we move to the text tile position to the right. If we
  * reached the end of a line of tiles, we move down to the next row. 
  */
-		x += TILE_WIDTH;
+		++x;
 
-		if(x >= LEVEL_WIDTH) {
+		if(x >= map->mWidth) {
 			x = 0;
-			y += TILE_HEIGHT;
+			++y;
+		}
+	}
+	fclose(fp);
+
+	return 0;
+}
+
+/*
+ * Parsing text one number at a time is fine for this level, but it takes
+ * seconds for a map of millions of tiles. For those there is a binary map
+ * format that mapconv makes out of text maps. All numbers in it are little
+ * endian:
+ *
+ *	"LMAP"			4 byte magic number
+ *	version			16 bits, MAP_VERSION
+ *	bytes per tile		16 bits, 1 or 2
+ *	width, height		32 bits each, counted in tiles
+ *	layers			32 bits
+ *
+ * followed by each layer's tile types, row by row. This demo only has the
+ * one layer of tiles, so it reads the first layer and ignores the rest.
+ *
+ * Since the tile types are stored exactly as the map stores them, a map with
+ * one byte per tile is read straight into the grid with a single read. Two
+ * byte maps go through a temporary buffer. Either way we then check every
+ * tile is a type we have a sprite for.
+ */
+short TileMap_loadBinary(TileMap *map, char *path)
+{
+	SDL_RWops *file;
+	Uint16 *wide = NULL;
+	char magic[4];
+	Uint16 version, tileSize;
+	Uint32 width, height, layers;
+	size_t i, count;
+
+	file = SDL_RWFromFile(path, "rb");
+	if(file == NULL) {
+		SDL_Log("%s(), SDL_RWFromFile failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	if(SDL_RWread(file, magic, sizeof(magic), 1) != 1
+			|| memcmp(magic, MAP_MAGIC, sizeof(magic)) != 0) {
+		SDL_Log("%s(), %s is not a map file.", __func__, path);
+		goto error;
+	}
+
+	version = SDL_ReadLE16(file);
+	tileSize = SDL_ReadLE16(file);
+	width = SDL_ReadLE32(file);
+	height = SDL_ReadLE32(file);
+	layers = SDL_ReadLE32(file);
+
+	if(version != MAP_VERSION || (tileSize != 1 && tileSize != 2)
+			|| width == 0 || height == 0 || layers == 0
+			|| (Uint64)width * height > SDL_MAX_SINT32) {
+		SDL_Log("%s(), %s has a bad header.", __func__, path);
+		goto error;
+	}
+
+	if(TileMap_init(map, width, height))
+		goto error;
+
+	count = (size_t)width * height;
+
+	if(tileSize == 1) {
+		if(SDL_RWread(file, map->mTypes, count, 1) != 1) {
+			SDL_Log("%s(), %s is too short.", __func__, path);
+			goto error;
+		}
+	} else {
+		wide = malloc(count * sizeof(Uint16));
+		if(wide == NULL) {
+			SDL_Log("%s(), malloc failed.", __func__);
+			goto error;
+		}
+
+		if(SDL_RWread(file, wide, count * sizeof(Uint16), 1) != 1) {
+			SDL_Log("%s(), %s is too short.", __func__, path);
+			goto error;
+		}
+
+		for(i = 0; i < count; ++i) {
+			wide[i] = SDL_SwapLE16(wide[i]);
+			map->mTypes[i] = wide[i] < TOTAL_TILE_SPRITES
+				? wide[i] : TOTAL_TILE_SPRITES;
 		}
+
+		free(wide);
+		wide = NULL;
 	}
+
+	for(i = 0; i < count; ++i)
+		if(map->mTypes[i] >= TOTAL_TILE_SPRITES) {
+			SDL_Log("%s(), invalid tile type.", __func__);
+			goto error;
+		}
+
+	SDL_RWclose(file);
+
+	return 0;
+error:
+	free(wide);
+	TileMap_free(map);
+	SDL_RWclose(file);
+
+	return -1;
+}
+
+/*
+ * Tells whether the file at path was last changed no earlier than the file
+ * at than, or than is not there at all. A missing path is never newer.
+ */
+short isNewer(char *path, char *than)
+{
+	struct stat a, b;
+
+	if(stat(path, &a) != 0)
+		return 0;
+	if(stat(than, &b) != 0)
+		return 1;
+
+	return a.st_mtime >= b.st_mtime;
+}
+
+/*
+ * setTiles loads the level from lazy.bmap, falling back to parsing lazy.map
+ * when the binary map isn't there or is older than the text map. That way an
+ * edit to lazy.map shows up straight away, without first having to run
+ * mapconv again.
+ */
+short setTiles(TileMap *map)
+{
+	short binary;
+
+	binary = isNewer("lazy.bmap", "lazy.map");
+	if(binary == 0)
+		SDL_Log("%s(), lazy.bmap is missing or stale, using lazy.map.", __func__);
+
+	if((binary == 0 || TileMap_loadBinary(map, "lazy.bmap"))
+			&& TileMap_loadText(map, "lazy.map"))
+		return -1;
 /*
  * After all the tiles are loaded we set the clip rectangles for the tile
- * sprites. Finally we load the map file and return.
+ * sprites and return.
  */
 	gTileClips[TILE_RED].x = 0;
 	gTileClips[TILE_RED].y = 0;
@@ -532,8 +1357,6 @@ short setTiles(Tile* tiles[])
 	gTileClips[TILE_BOTTOMRIGHT].w = TILE_WIDTH;
 	gTileClips[TILE_BOTTOMRIGHT].h = TILE_HEIGHT;
 
-	fclose(fp);
-
 	return 0;
 }
 
@@ -541,50 +1364,94 @@ short setTiles(Tile* tiles[])
  * The touchesWall function checks a given collision box against tiles of type
  * TILE_CENTER, TILE_TOP, TILE_TOPRIGHT, TILE_RIGHT, TILE_BOTTOMRIGHT,
  * TILE_BOTTOM, TILE_BOTTOMLEFT, TILE_LEFT, and TILE_TOPLEFT which are all wall
- * tiles. If you check back when we defined these constants, you'll see that
- * these are numbered right next to each other so all we have to do is check if
- * the type is between TILE_CENTER and TILE_TOPLEFT.
+ * tiles.
+ *
+ * Rather than checking the box against every tile in the level, we work out
+ * which columns and rows of the grid the box overlaps by dividing its edges
+ * by the tile size, and only look at those tiles. A box no bigger than a tile
+ * overlaps at most four of them, however big the level is. The right and
+ * bottom edges are the last pixel inside the box, so a box that ends exactly
+ * on a tile boundary doesn't count the next tile, just as checkCollision
+ * wouldn't. Anything outside the map is skipped.
  *
  * If the given collision box collides with any tile that is a wall this
  * function returns true, 
  */
-short touchesWall(SDL_Rect *box, Tile* tiles[])
+short touchesWall(SDL_Rect *box, TileMap *map)
 {
-	int i;
-	for(i = 0; i < TOTAL_TILES; ++i)
-		if((Tile_getType(tiles[i]) >= TILE_CENTER)
-				&& (Tile_getType(tiles[i]) <= TILE_TOPLEFT))
-			if(checkCollision(box, Tile_getBox(tiles[i])))
+	int left, right, top, bottom, x, y;
+
+	if(box->x + box->w <= 0 || box->y + box->h <= 0)
+		return 0;
+
+	left = SDL_max(box->x / TILE_WIDTH, 0);
+	top = SDL_max(box->y / TILE_HEIGHT, 0);
+	right = SDL_min((box->x + box->w - 1) / TILE_WIDTH, map->mWidth - 1);
+	bottom = SDL_min((box->y + box->h - 1) / TILE_HEIGHT, map->mHeight - 1);
+
+	for(y = top; y <= bottom; ++y)
+		for(x = left; x <= right; ++x)
+			if(Tile_isWall(TileMap_getType(map, x, y)))
 				return 1;
 	return 0;
 }
 
 /*
- * In the main function right before we load the media we declare our array of
- * tile pointers. 
+ * In the main function right before we load the media we declare our tile
+ * map.
  *
  * Our main loop is pretty much the same with some mainor adjustments; When we
- * move the dot, we pass in the tile set, then set the camera above the dot
- * once the dot is moved. We then render the tile set and finally render the
+ * move the dot, we pass in the tile map, then set the camera above the dot
+ * once the dot is moved. We then render the tile map and finally render the
  * dot over the level.
+ *
+ * The tile map is rendered through the chunk cache, which is brought up to
+ * date before the screen is cleared. Press c to cycle the color of the floor
+ * tile under the dot; the chunk it is in is then redrawn.
+ *
+ * Given the path of a binary map, p39_tiling world.bmap, the demo streams
+ * that world instead of loading lazy.map. Once the camera is set each frame
+ * the streaming world is updated to page chunks in and out around it.
+ *
+ * A headless run stops after its ticks and hashes where the dot ended up.
+ * It streams synchronously, so the chunks around the dot are always loaded
+ * and two runs hash the same whichever map they stream.
  */
+#ifndef BENCHMARK
 int main(int argc, char* args[])
 {
-	int i;
 	Dot dot;
 	SDL_Event e;
 	SDL_Rect camera = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+	TileMap tileMap = { NULL, 0, 0 };
+	ChunkCache chunkCache = { 0 };
+	StreamWorld world = { 0 };
+	short streaming;
+	int x, y, type, tick = 0;
+	short cached;
+
+	argc = Headless_parseArgs(&gHeadless, argc, args);
+	if(argc < 0)
+		return 1;
+	streaming = argc > 1;
 
 	if(init())
 		goto equit;
 
-	Tile* tileSet[TOTAL_TILES];
+	if(loadMedia(&tileMap))
+		goto equit;
+
+	if(ChunkCache_init(&chunkCache, CHUNK_CACHE_BUDGET))
+		goto equit;
 
-	if(loadMedia(tileSet))
+	if(streaming && StreamWorld_open(&world, args[1], gHeadless.mTicks > 0))
 		goto equit;
 
 	Dot_init(&dot);
 
+	if(gHeadless.mTicks > 0)
+		Headless_start(&gHeadless);
+
 	while(1)
 	{
 		while(SDL_PollEvent(&e) != 0) {
@@ -595,25 +1462,193 @@ int main(int argc, char* args[])
 				if(e.key.keysym.sym == SDLK_q)
 					goto equit;
 
+			if(e.type == SDL_KEYDOWN && e.key.repeat == 0
+					&& e.key.keysym.sym == SDLK_c && !streaming) {
+				x = (dot.mBox.x + DOT_WIDTH / 2) / TILE_WIDTH;
+				y = (dot.mBox.y + DOT_HEIGHT / 2) / TILE_HEIGHT;
+				type = TileMap_getType(&tileMap, x, y);
+				if(type <= TILE_BLUE) {
+					TileMap_setType(&tileMap, x, y, (type + 1) % (TILE_BLUE + 1));
+					ChunkCache_invalidateTile(&chunkCache, x, y);
+				}
+			}
+
+			if(e.type == SDL_RENDER_TARGETS_RESET)
+				ChunkCache_invalidateAll(&chunkCache);
+
 			handle_keyboard_events(&dot, &e);
 		}
 
-		Dot_move(&dot, &tileSet[0]);
-		Dot_setCamera(&dot, &camera);
+		if(gHeadless.mTicks > 0) {
+			if(tick == gHeadless.mTicks)
+				break;
+			Headless_steer(tick++, HEADLESS_TURN, DOT_VEL,
+					&dot.mVelX, &dot.mVelY);
+		}
+
+		if(streaming) {
+			Dot_moveStreamed(&dot, &world);
+			Dot_setCamera(&dot, &camera, world.mWidth, world.mHeight);
+			StreamWorld_update(&world, &camera);
+			cached = 0;
+		} else {
+			Dot_move(&dot, &tileMap);
+			Dot_setCamera(&dot, &camera, tileMap.mWidth, tileMap.mHeight);
+			cached = gHeadless.mRender
+				&& ChunkCache_prepare(&chunkCache, &tileMap, &camera) == 0;
+		}
+
+		if(!gHeadless.mRender)
+			continue;
 
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		for(i = 0; i < TOTAL_TILES; ++i)
-			Tile_render(tileSet[i], &camera);
+		if(streaming)
+			StreamWorld_render(&world, &camera);
+		else if(cached)
+			ChunkCache_render(&chunkCache, &camera);
+		else
+			TileMap_render(&tileMap, &camera);
 
 		Dot_render(&dot, &camera);
 
 		SDL_RenderPresent(gRenderer);
 	}
+
+	Headless_report(&gHeadless,
+			Headless_hash(HEADLESS_HASH, &dot.mBox, sizeof(SDL_Rect)));
 equit:
-	close_all(&tileSet[0]);
+	close_all(&tileMap, &chunkCache, &world);
 
 	return 0;
 }
+#else
+/*
+ * Wall query benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which needs no window. It generates a BENCH_MAP_SIZE by
+ * BENCH_MAP_SIZE tile map with walls scattered about it and then checks dot
+ * sized boxes at random spots against it, BENCH_GRID_QUERIES an iteration
+ * with touchesWall, and one at a time with a linear scan over every tile the
+ * way touchesWall used to work. Both answers are compared for a sample of the
+ * boxes, and any disagreement fails the benchmark.
+ */
+#define BENCH_MAP_SIZE		4096
+#define BENCH_BOXES		(1 << 20)
+#define BENCH_GRID_QUERIES	100000
+#define BENCH_CHECKED_QUERIES	20
 
+typedef struct {
+	TileMap mMap;
+	SDL_Rect *mBoxes;
+	int mNext;
+	int mHits;
+} BenchTiles;
+
+short touchesWallLinear(SDL_Rect *box, TileMap *map)
+{
+	SDL_Rect tileBox;
+	int x, y;
+
+	for(y = 0; y < map->mHeight; ++y)
+		for(x = 0; x < map->mWidth; ++x)
+			if(Tile_isWall(TileMap_getType(map, x, y))) {
+				tileBox = TileMap_getBox(x, y);
+				if(checkCollision(box, &tileBox))
+					return 1;
+			}
+	return 0;
+}
+
+/*
+ * Fills boxes with count dot sized boxes somewhere in the map. Every run of
+ * the benchmark uses the same boxes.
+ */
+void bench_boxes(SDL_Rect *boxes, int count)
+{
+	int i;
+
+	srand(1);
+	for(i = 0; i < count; ++i) {
+		boxes[i].x = (int)((double)rand() / RAND_MAX
+				* (BENCH_MAP_SIZE * TILE_WIDTH - DOT_WIDTH));
+		boxes[i].y = (int)((double)rand() / RAND_MAX
+				* (BENCH_MAP_SIZE * TILE_HEIGHT - DOT_HEIGHT));
+		boxes[i].w = DOT_WIDTH;
+		boxes[i].h = DOT_HEIGHT;
+	}
+}
+
+/*
+ * Each iteration carries on through the boxes from where the last one
+ * stopped, so the queries don't keep hitting the same few cache lines.
+ */
+void bench_grid(void *data)
+{
+	BenchTiles *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_GRID_QUERIES; ++i) {
+		bt->mHits += touchesWall(&bt->mBoxes[bt->mNext], &bt->mMap);
+		bt->mNext = (bt->mNext + 1) & (BENCH_BOXES - 1);
+	}
+}
+
+void bench_linear(void *data)
+{
+	BenchTiles *bt = data;
+
+	bt->mHits += touchesWallLinear(&bt->mBoxes[bt->mNext], &bt->mMap);
+	bt->mNext = (bt->mNext + 1) & (BENCH_BOXES - 1);
+}
+
+int main(int argc, char* args[])
+{
+	Bench bench;
+	BenchTiles bt = { { NULL, 0, 0 }, NULL, 0, 0 };
+	int x, y, i, mismatches = 0, ret = 1;
+
+	if(Bench_init(&bench, "39_tiling", argc, args))
+		return 1;
+
+	if(TileMap_init(&bt.mMap, BENCH_MAP_SIZE, BENCH_MAP_SIZE))
+		goto equit;
+
+	bt.mBoxes = malloc(BENCH_BOXES * sizeof(SDL_Rect));
+	if(bt.mBoxes == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		goto equit;
+	}
+
+	srand(0);
+	for(y = 0; y < bt.mMap.mHeight; ++y)
+		for(x = 0; x < bt.mMap.mWidth; ++x)
+			TileMap_setType(&bt.mMap, x, y, rand() % 8 == 0
+					? TILE_CENTER : rand() % (TILE_BLUE + 1));
+
+	bench_boxes(bt.mBoxes, BENCH_BOXES);
+
+	for(i = 0; i < BENCH_CHECKED_QUERIES; ++i)
+		if(touchesWallLinear(&bt.mBoxes[i], &bt.mMap)
+				!= touchesWall(&bt.mBoxes[i], &bt.mMap))
+			++mismatches;
+	if(mismatches) {
+		SDL_Log("touchesWall disagrees with the linear scan %d times.",
+				mismatches);
+		goto equit;
+	}
+
+	Bench_run(&bench, "touchesWall grid", bench_grid, &bt, BENCH_GRID_QUERIES);
+	bt.mNext = 0;
+	Bench_run(&bench, "touchesWall linear", bench_linear, &bt, 1);
+
+	ret = 0;
+equit:
+	free(bt.mBoxes);
+	TileMap_free(&bt.mMap);
+
+	return Bench_finish(&bench) || ret;
+}
+#endif
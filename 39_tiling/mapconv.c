@@ -0,0 +1,211 @@
+/*
+ * Map Converter
+ *
+ * Converts text tile maps like lazy.map into the binary map format that
+ * TileMap_loadBinary in 39_tiling.c reads. Each text map given becomes one
+ * layer of the binary map, in order, so they all have to be the same size:
+ *
+ *	mapconv lazy.bmap lazy.map
+ *
+ * A text map is rows of tile numbers separated by spaces, one row per line.
+ * The width of the map is the number of tiles on the first row and the height
+ * is the number of rows. If every tile number fits in a byte the map is
+ * written with one byte per tile, otherwise with two.
+ */
+#include <SDL2/SDL.h>
+#include <stdio.h>
+
+#define MAP_MAGIC		"LMAP"
+#define MAP_VERSION		1
+#define MAX_LAYERS		16
+
+typedef struct {
+	Uint16 *mTypes;
+	int mWidth, mHeight;
+} TextMap;
+
+/*
+ * Appends a tile to the map's count tiles, growing it by half again whenever
+ * it fills up.
+ */
+short TextMap_push(TextMap *tm, int *count, int *capacity, int tileType)
+{
+	Uint16 *types;
+
+	if(*count == *capacity) {
+		*capacity = *capacity ? *capacity + *capacity / 2 : 4096;
+		types = realloc(tm->mTypes, *capacity * sizeof(Uint16));
+		if(types == NULL) {
+			SDL_Log("%s(), realloc failed.", __func__);
+			return -1;
+		}
+		tm->mTypes = types;
+	}
+
+	tm->mTypes[(*count)++] = tileType;
+
+	return 0;
+}
+
+/*
+ * Reads a text map. We read one character at a time, building up each number
+ * as we go; a newline ends a row, and every row has to be as long as the
+ * first one. While reading a row, the tiles read so far are counted in
+ * mWidth for the first row and in column for the rest.
+ */
+short TextMap_load(TextMap *tm, char *path)
+{
+	FILE *fp;
+	int c, value = -1, column = 0, count = 0, capacity = 0;
+
+	tm->mTypes = NULL;
+	tm->mWidth = 0;
+	tm->mHeight = 0;
+
+	fp = fopen(path, "r");
+	if(fp == NULL) {
+		SDL_Log("%s(), fopen failed for %s.", __func__, path);
+		return -1;
+	}
+
+	do {
+		c = fgetc(fp);
+
+		if(c >= '0' && c <= '9') {
+			value = (value < 0 ? 0 : value * 10) + c - '0';
+			if(value > 0xFFFF) {
+				SDL_Log("%s(), tile type too big in %s.", __func__, path);
+				goto error;
+			}
+			continue;
+		}
+
+		if(value >= 0) {
+			if(tm->mHeight == 0)
+				tm->mWidth++;
+			else if(++column > tm->mWidth) {
+				SDL_Log("%s(), row %d of %s is too long.",
+						__func__, tm->mHeight + 1, path);
+				goto error;
+			}
+			if(TextMap_push(tm, &count, &capacity, value))
+				goto error;
+			value = -1;
+		}
+
+		if(c == '\n' || c == EOF) {
+			if(tm->mHeight == 0 && tm->mWidth > 0)
+				tm->mHeight = 1;
+			else if(column > 0) {
+				if(column < tm->mWidth) {
+					SDL_Log("%s(), row %d of %s is too short.",
+							__func__, tm->mHeight + 1, path);
+					goto error;
+				}
+				tm->mHeight++;
+			}
+			column = 0;
+		} else if(c != ' ' && c != '\t' && c != '\r') {
+			SDL_Log("%s(), unexpected '%c' in %s.", __func__, c, path);
+			goto error;
+		}
+	} while(c != EOF);
+
+	fclose(fp);
+
+	if(tm->mWidth == 0) {
+		SDL_Log("%s(), %s is empty.", __func__, path);
+		return -1;
+	}
+
+	return 0;
+error:
+	fclose(fp);
+	free(tm->mTypes);
+	tm->mTypes = NULL;
+
+	return -1;
+}
+
+/*
+ * Writes the header and then every layer. The tiles are written with
+ * SDL_WriteLE16 when they need two bytes so the file is little endian
+ * whatever machine made it.
+ */
+short writeMap(char *path, TextMap layers[], int layerCount)
+{
+	SDL_RWops *file;
+	Uint16 tileSize = 1;
+	Uint8 narrow;
+	int i, l, count = layers[0].mWidth * layers[0].mHeight;
+
+	for(l = 0; l < layerCount; ++l)
+		for(i = 0; i < count; ++i)
+			if(layers[l].mTypes[i] > 0xFF)
+				tileSize = 2;
+
+	file = SDL_RWFromFile(path, "wb");
+	if(file == NULL) {
+		SDL_Log("%s(), SDL_RWFromFile failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_RWwrite(file, MAP_MAGIC, 4, 1);
+	SDL_WriteLE16(file, MAP_VERSION);
+	SDL_WriteLE16(file, tileSize);
+	SDL_WriteLE32(file, layers[0].mWidth);
+	SDL_WriteLE32(file, layers[0].mHeight);
+	SDL_WriteLE32(file, layerCount);
+
+	for(l = 0; l < layerCount; ++l)
+		for(i = 0; i < count; ++i) {
+			if(tileSize == 2)
+				SDL_WriteLE16(file, layers[l].mTypes[i]);
+			else {
+				narrow = layers[l].mTypes[i];
+				SDL_RWwrite(file, &narrow, 1, 1);
+			}
+		}
+
+	if(SDL_RWclose(file) < 0) {
+		SDL_Log("%s(), SDL_RWclose failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_Log("Wrote %dx%d map with %d layer(s), %d byte(s) per tile to %s.",
+			layers[0].mWidth, layers[0].mHeight, layerCount, tileSize, path);
+
+	return 0;
+}
+
+int main(int argc, char* args[])
+{
+	TextMap layers[MAX_LAYERS];
+	int i, layerCount = argc - 2, ret = 1;
+
+	if(layerCount < 1 || layerCount > MAX_LAYERS) {
+		SDL_Log("usage: %s output.bmap layer.map [layer.map ...]", args[0]);
+		return 1;
+	}
+
+	for(i = 0; i < layerCount; ++i) {
+		if(TextMap_load(&layers[i], args[i + 2]))
+			goto equit;
+
+		if(layers[i].mWidth != layers[0].mWidth
+				|| layers[i].mHeight != layers[0].mHeight) {
+			SDL_Log("%s(), %s is not the same size as %s.",
+					__func__, args[i + 2], args[2]);
+			free(layers[i].mTypes);
+			goto equit;
+		}
+	}
+
+	if(writeMap(args[1], layers, layerCount) == 0)
+		ret = 0;
+equit:
+	while(--i >= 0)
+		free(layers[i].mTypes);
+
+	return ret;
+}
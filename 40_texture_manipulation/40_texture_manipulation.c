@@ -7,6 +7,10 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
+
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
@@ -259,12 +263,23 @@ int LTexture_getPitch(LTexture *lt)
 }
 
 /*
- * In our media loading function after we load the texture we lock it so we can
- * alter its pixels.
+ * Replaces every pixel of the given color with another; this loop is where
+ * the color keying below spends its time, so it is kept on its own.
+ */
+void replacePixels(Uint32 *pixels, int pixelCount, Uint32 from, Uint32 to)
+{
+	int i;
+	for(i = 0; i < pixelCount; ++i)
+		if(pixels[i] == from)
+			pixels[i] = to;
+}
+
+/*
+ * To color key a texture we lock it so we can alter its pixels.
  *
  * After the texture is locked, we're going to go through the pixels and make
- * all the background pixels transparent. What we're doing is essentially
- * manually color keying the image.
+ * all the pixels of the key color transparent. What we're doing is
+ * essentially manually color keying the image.
  *
  * First we allocate a pixel format using SDL_GetWindowPixelFormat and
  * SDL_AllocFormat. We then need to grab the pixels. Our pixel accessor returns
@@ -272,12 +287,9 @@ int LTexture_getPitch(LTexture *lt)
  * unsigned integer.
  *
  */
-short loadMedia(void)
+short LTexture_colorKey(LTexture *lt, Uint8 r, Uint8 g, Uint8 b)
 {
-	if(LTexture_loadFromFile(&gFooTexture, "foo.png"))
-		return -1;
-
-	if(LTexture_lockTexture(&gFooTexture))
+	if(LTexture_lockTexture(lt))
 		return -1;
 
 	Uint32 format = SDL_GetWindowPixelFormat(gWindow);
@@ -288,9 +300,8 @@ short loadMedia(void)
  * pixel all we need to do is divide by 4 to get the pitch in pixels. Then we
  * multiply the pitch width by the height to get the total number of pixels.
  */
-	Uint32* pixels = (Uint32*)LTexture_getPixels(&gFooTexture);
-	int pixelCount = (LTexture_getPitch(&gFooTexture) / 4)
-					* LTexture_getHeight(&gFooTexture);
+	Uint32* pixels = (Uint32*)LTexture_getPixels(lt);
+	int pixelCount = (LTexture_getPitch(lt) / 4) * LTexture_getHeight(lt);
 /*
  * What we're going to do is find all the pixels that the color key color and
  * then replace them with transparent pixels. First we map color key color and
@@ -298,23 +309,35 @@ short loadMedia(void)
  * all the pixels and check if any of the pixels match the color key. If it
  * does, we give the value of a transparent pixel.
  */
-	Uint32 colorKey = SDL_MapRGB(mappingFormat, 0, 0xFF, 0xFF);
+	Uint32 colorKey = SDL_MapRGB(mappingFormat, r, g, b);
 	Uint32 transparent = SDL_MapRGBA(mappingFormat, 0xFF, 0xFF, 0xFF, 0x00);
-	int i;
-	for(i = 0; i < pixelCount; ++i)
-		if(pixels[i] == colorKey)
-			pixels[i] = transparent;
+	replacePixels(pixels, pixelCount, colorKey, transparent);
 /*
  * After we're done going through the pixels we unlock the texture to update it
  * with the new pixels. Lastly we can't forget to call SDL_FreeFormat to
  * deallocate the pixel format we created.
  */
-	LTexture_unlockTexture(&gFooTexture);
+	LTexture_unlockTexture(lt);
 	SDL_FreeFormat(mappingFormat);
 
 	return 0;
 }
 
+/*
+ * In our media loading function after we load the texture we color key its
+ * cyan background.
+ */
+short loadMedia(void)
+{
+	if(LTexture_loadFromFile(&gFooTexture, "foo.png"))
+		return -1;
+
+	if(LTexture_colorKey(&gFooTexture, 0, 0xFF, 0xFF))
+		return -1;
+
+	return 0;
+}
+
 void close_all(void)
 {
 	LTexture_free(&gFooTexture);
@@ -328,6 +351,7 @@ void close_all(void)
 	SDL_Quit();
 }
 
+#ifndef BENCHMARK
 int main(int argc, char* args[])
 {
 	if(init())
@@ -360,3 +384,87 @@ equit:
 
 	return 0;
 }
+#else
+/*
+ * Color key benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which runs headless through the benchmark harness. It
+ * times loading foo.png into a streaming texture, decode, conversion to the
+ * window's format and upload together, and then color keying the loaded
+ * texture, lock and unlock included. Last it times replacePixels alone over
+ * a BENCH_WIDTH by BENCH_HEIGHT frame where one pixel in four is the key;
+ * each iteration swaps the two colors back so every one does the same work.
+ */
+#define BENCH_WIDTH		1920
+#define BENCH_HEIGHT		1080
+
+typedef struct {
+	Uint32 *mPixels;
+	Uint32 mFrom, mTo;
+} BenchFrame;
+
+void bench_load(void *data)
+{
+	LTexture_loadFromFile(data, "foo.png");
+}
+
+void bench_colorKey(void *data)
+{
+	LTexture_colorKey(data, 0, 0xFF, 0xFF);
+}
+
+void bench_replace(void *data)
+{
+	BenchFrame *bf = data;
+	Uint32 swap;
+
+	replacePixels(bf->mPixels, BENCH_WIDTH * BENCH_HEIGHT, bf->mFrom, bf->mTo);
+	swap = bf->mFrom;
+	bf->mFrom = bf->mTo;
+	bf->mTo = swap;
+}
+
+int main(int argc, char* args[])
+{
+	Bench bench;
+	BenchFrame bf = { NULL, 0xFF00FFFF, 0xFFFFFF00 };
+	int i, ret = 1;
+
+	if(Bench_init(&bench, "40_texture_manipulation", argc, args))
+		return 1;
+
+	if(Bench_createRenderer(&gWindow, &gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT))
+		goto equit;
+
+	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+		goto equit;
+	}
+
+	if(LTexture_loadFromFile(&gFooTexture, "foo.png"))
+		goto equit;
+
+	bf.mPixels = malloc(BENCH_WIDTH * BENCH_HEIGHT * sizeof(Uint32));
+	if(bf.mPixels == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		goto equit;
+	}
+
+	for(i = 0; i < BENCH_WIDTH * BENCH_HEIGHT; ++i)
+		bf.mPixels[i] = i % 4 ? 0xFF000000 | (i & 0x7FFF) : bf.mFrom;
+
+	Bench_run(&bench, "load foo.png", bench_load, &gFooTexture, 1);
+	Bench_run(&bench, "color key foo.png", bench_colorKey, &gFooTexture,
+			LTexture_getWidth(&gFooTexture) * LTexture_getHeight(&gFooTexture));
+	Bench_run(&bench, "replacePixels 1080p", bench_replace, &bf,
+			BENCH_WIDTH * BENCH_HEIGHT);
+
+	ret = 0;
+equit:
+	free(bf.mPixels);
+	close_all();
+
+	return Bench_finish(&bench) || ret;
+}
+#endif
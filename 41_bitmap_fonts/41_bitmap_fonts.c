@@ -13,20 +13,29 @@
  * which pixel we got since we wanted to grab all the pixels. Here we need to
  * get pixels at exact x/y coordinates which is why we're adding a getPixel32
  * function. This function works specifically for 32bit pixels.
+ *
+ * Drawing text a glyph at a time is one render call per character, which
+ * adds up quickly for a screen full of text. At the end of the tutorial is a
+ * text cache that lays a string out into quads once and then draws all the
+ * text on screen with a single call.
  */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#include "ltut.h"
+
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
+
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
-
-typedef struct {
-	SDL_Texture* mTexture;
-	void* mPixels;
-	int mPitch;
-	int mWidth;
-	int mHeight;
-} LTexture;
+#define TEXT_CACHE_SETS		64
+#define TEXT_CACHE_WAYS		4
+#define TEXT_BATCH_QUADS	4096
+#define FONT_METRICS_MAGIC	"LFNT"
+#define FONT_METRICS_VERSION	2
+#define FONT_HASH_SEED		2166136261u
 
 /*
  * Here is our bitmap font which functions as a wrapper for a sprite sheet of
@@ -43,63 +52,45 @@ typedef struct {
 	int mNewLine, mSpace;
 } LBitmapFont;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
+/*
+ * A text run is a string laid out into glyph quads, relative to where the
+ * string starts, along with a copy of the string and its hash so it can be
+ * found again, and when it was last drawn.
+ *
+ * The text cache keeps the runs in a small hash table. A string's hash picks
+ * one of TEXT_CACHE_SETS sets, and the run can live in any of the set's
+ * TEXT_CACHE_WAYS slots; when they are all full the one drawn least recently
+ * makes way. Drawing a cached string is then a copy of its quads, moved to
+ * where the string is drawn, into the cache's batch, and all the text drawn
+ * in a frame goes to the renderer in one call when the batch is flushed.
+ */
+typedef struct {
+	Uint32 mHash;
+	char *mText;
+	SDL_Vertex *mVertices;
+	int mQuads;
+	Uint32 mLastUsed;
+} TextRun;
+
+typedef struct {
+	LBitmapFont *mFont;
+	TextRun mRuns[TEXT_CACHE_SETS][TEXT_CACHE_WAYS];
+	QuadBatch mBatch;
+	Uint32 mClock;
+} TextCache;
+
 LTexture gBitmapTexture;
 LBitmapFont gBitmapFont;
+TextCache gTextCache;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
-		SDL_Log("Warning: Linear texture filtering not enabled.");
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-
-void LTexture_free(LTexture *lt)
-{
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-		lt->mPixels = NULL;
-		lt->mPitch = 0;
-	}
+	return LTut_init(
+			"SDL Tutorial",
+			SCREEN_WIDTH,
+			SCREEN_HEIGHT,
+			0,
+			LTUT_VSYNC | LTUT_LINEAR);
 }
 
 /*
@@ -109,97 +100,68 @@ void LTexture_free(LTexture *lt)
  *
  * Secondly, we're specifying the texture pixel format as
  * SDL_PIXELFORMAT_RGBA8888 so we know we'll get 32bit RGBA pixels.
+ *
+ * The tutorial library's LTexture_loadFromFile makes a static texture, which
+ * can't be locked, and the font builder needs to read the pixels back, so
+ * this loader makes a streaming one and copies the image in a row at a time,
+ * as the texture's pitch need not match the surface's.
  */
-short LTexture_loadFromFile(LTexture *lt, char *path)
+short LTexture_loadLockable(LTexture *lt, char *path)
 {
-	LTexture_free(lt);
-
-	SDL_Texture* newTexture = NULL;
+	SDL_Surface *loadedSurface, *formattedSurface;
+	Uint32 *pixels, colorKey, transparent;
+	int x, y;
+	short ret = -1;
 
-	SDL_Surface* loadedSurface = IMG_Load(path);
+	loadedSurface = IMG_Load(path);
 	if(loadedSurface == NULL) {
 		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
 		return -1;
 	}
 
-	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(
-							loadedSurface,
-							SDL_PIXELFORMAT_RGBA8888,
-							SDL_SWSURFACE);
-	if(formattedSurface == NULL) {
-		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed.", __func__);
-		return -1;
-	}
-
-	newTexture = SDL_CreateTexture(
-					gRenderer,
+	formattedSurface = SDL_ConvertSurfaceFormat(
+					loadedSurface,
 					SDL_PIXELFORMAT_RGBA8888,
-					SDL_TEXTUREACCESS_STREAMING,
-					formattedSurface->w,
-					formattedSurface->h);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
+					0);
+	SDL_FreeSurface(loadedSurface);
+	if(formattedSurface == NULL) {
+		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed. %s", __func__, SDL_GetError());
 		return -1;
 	}
 
-	SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
-
-	SDL_LockTexture(
-				newTexture,
-				&formattedSurface->clip_rect,
-				&lt->mPixels,
-				&lt->mPitch);
-
-	memcpy(
-			lt->mPixels,
-			formattedSurface->pixels,
-			formattedSurface->pitch * formattedSurface->h);
+	if(LTexture_createBlank(
+				lt,
+				formattedSurface->w, formattedSurface->h,
+				SDL_TEXTUREACCESS_STREAMING))
+		goto done;
 
-	lt->mWidth = formattedSurface->w;
-	lt->mHeight = formattedSurface->h;
+	LTexture_setBlendMode(lt, SDL_BLENDMODE_BLEND);
 
-	Uint32* pixels = (Uint32*)lt->mPixels;
-	int pixelCount = (lt->mPitch / 4) * lt->mHeight;
+	if(LTexture_lockTexture(lt))
+		goto done;
 
-	Uint32 colorKey = SDL_MapRGB(formattedSurface->format, 0, 0xFF, 0xFF);
-	Uint32 transparent = SDL_MapRGBA(
+	colorKey = SDL_MapRGB(formattedSurface->format, 0, 0xFF, 0xFF);
+	transparent = SDL_MapRGBA(
 			formattedSurface->format, 0x00, 0xFF, 0xFF, 0x00);
 
-	int i;
-	for(i = 0; i < pixelCount; ++i)
-		if(pixels[i] == colorKey)
-			pixels[i] = transparent;
-
-	SDL_UnlockTexture(newTexture);
-	lt->mPixels = NULL;
+	for(y = 0; y < lt->mHeight; ++y) {
+		pixels = (Uint32*)((Uint8*)lt->mPixels + y * lt->mPitch);
+		memcpy(pixels,
+				(Uint8*)formattedSurface->pixels + y * formattedSurface->pitch,
+				lt->mWidth * 4);
 
-	SDL_FreeSurface(formattedSurface);
-		
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
+		for(x = 0; x < lt->mWidth; ++x)
+			if(pixels[x] == colorKey)
+				pixels[x] = transparent;
+	}
 
-void LTexture_render(
-			LTexture *lt,
-			int x, int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+	LTexture_unlockTexture(lt);
 
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
+	ret = 0;
+done:
+	SDL_FreeSurface(formattedSurface);
 
-	SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
+	return ret;
 }
 
 int LTexture_getWidth(LTexture *lt)
@@ -212,35 +174,6 @@ int LTexture_getHeight(LTexture *lt)
 	return lt->mHeight;
 }
 
-short LTexture_lockTexture(LTexture *lt)
-{
-	if(lt->mPixels != NULL) {
-		SDL_Log("Texture already locked.");
-		return -1;
-	}
-
-	if(SDL_LockTexture(lt->mTexture, NULL, &lt->mPixels, &lt->mPitch) != 0) {
-		SDL_Log("%s(), SDL_LockTexture failed. %s",
-				__func__, SDL_GetError());
-		return -1;
-	}
-	return 0;
-}
-
-short LTexture_unlockTexture(LTexture *lt)
-{
-	if(lt->mPixels == NULL) {
-		SDL_Log("Texture not locked.");
-		return -1;
-	}
-
-	SDL_UnlockTexture(lt->mTexture);
-	lt->mPixels = NULL;
-	lt->mPitch = 0;
-
-	return 0;
-}
-
 /*
  * Here is our function to get a pixel at a specific offset.
  *
@@ -457,6 +390,310 @@ short LBitmapFont_buildFont(LBitmapFont *lb, LTexture* bitmap)
 	return 0;
 }
 
+/*
+ * The scans above read every pixel of a cell up to four times, each time
+ * working out its offset from the pitch, which is slow for a big atlas or a
+ * lot of fonts. This build does the same job in one pass over the locked
+ * pixels, a band of cells at a time.
+ *
+ * While walking a band it fills in two occupancy maps: one flag per pixel
+ * column saying whether the column holds anything other than background, and
+ * one flag per pixel row of each cell saying the same for the row. The left
+ * and right edges of a glyph are then the first and last occupied columns of
+ * its cell, the top is the cell's first occupied row and the bottom of the A
+ * is its last. An empty cell keeps the whole cell as its sprite, just as
+ * before.
+ */
+short LBitmapFont_buildFontScan(LBitmapFont *lb, LTexture* bitmap)
+{
+	Uint8 *colUsed, *rowUsed;
+	Uint32 *pixels, *row;
+	Uint32 bgColor, used;
+	int cellW, cellH, stride;
+	int top, baseA;
+	int rows, cols, pCol, pRow;
+	int currentChar, first, last;
+
+	if(LTexture_lockTexture(bitmap))
+		return -1;
+
+	pixels = (Uint32*)bitmap->mPixels;
+	stride = bitmap->mPitch / 4;
+	bgColor = pixels[0];
+
+	cellW = LTexture_getWidth(bitmap) / 16;
+	cellH = LTexture_getHeight(bitmap) / 16;
+
+	top = cellH;
+	baseA = cellH;
+
+	colUsed = malloc(cellW * 16);
+	rowUsed = malloc(cellH * 16);
+	if(colUsed == NULL || rowUsed == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		free(colUsed);
+		free(rowUsed);
+		LTexture_unlockTexture(bitmap);
+		return -1;
+	}
+
+	for(rows = 0; rows < 16; ++rows)
+	{
+		SDL_memset(colUsed, 0, cellW * 16);
+
+		for(pRow = 0; pRow < cellH; ++pRow)
+		{
+			row = pixels + (cellH * rows + pRow) * stride;
+
+			for(cols = 0; cols < 16; ++cols, row += cellW)
+			{
+				used = 0;
+				for(pCol = 0; pCol < cellW; ++pCol)
+					if(row[pCol] != bgColor) {
+						colUsed[cellW * cols + pCol] = 1;
+						used = 1;
+					}
+				rowUsed[cellH * cols + pRow] = used;
+			}
+		}
+
+		for(cols = 0; cols < 16; ++cols)
+		{
+			currentChar = rows * 16 + cols;
+
+			lb->mChars[currentChar].x = cellW * cols;
+			lb->mChars[currentChar].y = cellH * rows;
+			lb->mChars[currentChar].w = cellW;
+			lb->mChars[currentChar].h = cellH;
+
+			for(first = 0; first < cellW; ++first)
+				if(colUsed[cellW * cols + first])
+					break;
+			if(first == cellW)
+				continue;
+
+			for(last = cellW - 1; !colUsed[cellW * cols + last]; --last)
+				;
+
+			lb->mChars[currentChar].x += first;
+			lb->mChars[currentChar].w = last - first + 1;
+
+			for(first = 0; !rowUsed[cellH * cols + first]; ++first)
+				;
+			if(first < top)
+				top = first;
+
+			if(currentChar == 'A') {
+				for(last = cellH - 1; !rowUsed[cellH * cols + last]; --last)
+					;
+				baseA = last;
+			}
+		}
+	}
+
+	free(colUsed);
+	free(rowUsed);
+
+	lb->mSpace = cellW / 2;
+	lb->mNewLine = baseA - top;
+
+	for(int i = 0; i < 256; ++i) {
+		lb->mChars[ i ].y += top;
+		lb->mChars[ i ].h -= top;
+	}
+
+	LTexture_unlockTexture(bitmap);
+	lb->mBitmap = bitmap;
+
+	return 0;
+}
+
+/*
+ * Once a font has been built its metrics can be saved next to the image, so
+ * the next run reads them back and never looks at a pixel. All the numbers
+ * are little endian:
+ *
+ *	"LFNT"			4 byte magic number
+ *	version			16 bits, FONT_METRICS_VERSION
+ *	width, height		32 bits each, the size of the font image
+ *	image hash		32 bits, from LBitmapFont_hashFile
+ *	space, new line		32 bits each
+ *
+ * followed by the x, y, w and h of all 256 glyph sprites, 32 bits each. The
+ * image size and hash tie the metrics to the image they were built from, so
+ * once the font image is edited its metrics no longer match and the font is
+ * built again.
+ */
+short LBitmapFont_saveMetrics(LBitmapFont *lb, char *path, Uint32 imageHash)
+{
+	SDL_RWops *file;
+	int i;
+
+	file = SDL_RWFromFile(path, "wb");
+	if(file == NULL) {
+		SDL_Log("%s(), SDL_RWFromFile failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_RWwrite(file, FONT_METRICS_MAGIC, 4, 1);
+	SDL_WriteLE16(file, FONT_METRICS_VERSION);
+	SDL_WriteLE32(file, LTexture_getWidth(lb->mBitmap));
+	SDL_WriteLE32(file, LTexture_getHeight(lb->mBitmap));
+	SDL_WriteLE32(file, imageHash);
+	SDL_WriteLE32(file, lb->mSpace);
+	SDL_WriteLE32(file, lb->mNewLine);
+
+	for(i = 0; i < 256; ++i) {
+		SDL_WriteLE32(file, lb->mChars[i].x);
+		SDL_WriteLE32(file, lb->mChars[i].y);
+		SDL_WriteLE32(file, lb->mChars[i].w);
+		SDL_WriteLE32(file, lb->mChars[i].h);
+	}
+
+	if(SDL_RWclose(file) < 0) {
+		SDL_Log("%s(), SDL_RWclose failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Hashes the bytes of a file with FNV-1a. Hashing the compressed image file
+ * rather than its pixels means the metrics can be checked without decoding
+ * or locking anything. Returns 0 should the file not be read.
+ */
+Uint32 LBitmapFont_hashFile(char *path)
+{
+	Uint8 *data;
+	size_t size, i;
+	Uint32 hash = FONT_HASH_SEED;
+
+	data = SDL_LoadFile(path, &size);
+	if(data == NULL) {
+		SDL_Log("%s(), SDL_LoadFile failed. %s", __func__, SDL_GetError());
+		return 0;
+	}
+
+	for(i = 0; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 16777619u;
+	}
+
+	SDL_free(data);
+
+	return hash;
+}
+
+/*
+ * The glyph sprites are read into a buffer with one read and swapped into
+ * place, then checked to lie inside the image before the font takes them.
+ * The font is left untouched if anything is wrong with the file, or it was
+ * built from an image with some other hash.
+ */
+short LBitmapFont_loadMetrics(
+			LBitmapFont *lb,
+			LTexture* bitmap,
+			char *path,
+			Uint32 imageHash)
+{
+	SDL_RWops *file;
+	Uint32 rects[256 * 4];
+	char magic[4];
+	Uint16 version;
+	Uint32 width, height, hash, space, newLine;
+	SDL_Rect *c;
+	int i;
+
+	file = SDL_RWFromFile(path, "rb");
+	if(file == NULL)
+		return -1;
+
+	if(SDL_RWread(file, magic, sizeof(magic), 1) != 1
+			|| memcmp(magic, FONT_METRICS_MAGIC, sizeof(magic)) != 0) {
+		SDL_Log("%s(), %s is not a font metrics file.", __func__, path);
+		goto error;
+	}
+
+	version = SDL_ReadLE16(file);
+	width = SDL_ReadLE32(file);
+	height = SDL_ReadLE32(file);
+	hash = SDL_ReadLE32(file);
+	space = SDL_ReadLE32(file);
+	newLine = SDL_ReadLE32(file);
+
+	if(version != FONT_METRICS_VERSION
+			|| width != (Uint32)LTexture_getWidth(bitmap)
+			|| height != (Uint32)LTexture_getHeight(bitmap)
+			|| hash != imageHash) {
+		SDL_Log("%s(), %s does not match the font image.", __func__, path);
+		goto error;
+	}
+
+	if(SDL_RWread(file, rects, sizeof(rects), 1) != 1) {
+		SDL_Log("%s(), %s is too short.", __func__, path);
+		goto error;
+	}
+
+	for(i = 0; i < 256 * 4; ++i)
+		rects[i] = SDL_SwapLE32(rects[i]);
+
+	for(i = 0; i < 256; ++i)
+		if((Uint64)rects[i * 4 + 0] + rects[i * 4 + 2] > width
+				|| (Uint64)rects[i * 4 + 1] + rects[i * 4 + 3] > height) {
+			SDL_Log("%s(), %s has a glyph outside the image.",
+					__func__, path);
+			goto error;
+		}
+
+	for(i = 0; i < 256; ++i) {
+		c = &lb->mChars[i];
+		c->x = rects[i * 4 + 0];
+		c->y = rects[i * 4 + 1];
+		c->w = rects[i * 4 + 2];
+		c->h = rects[i * 4 + 3];
+	}
+
+	lb->mSpace = space;
+	lb->mNewLine = newLine;
+	lb->mBitmap = bitmap;
+
+	SDL_RWclose(file);
+
+	return 0;
+error:
+	SDL_RWclose(file);
+
+	return -1;
+}
+
+/*
+ * Uses the metrics file when there is a good one for the image at path,
+ * which the bitmap was loaded from, and otherwise builds the font and writes
+ * the metrics file for next time.
+ */
+short LBitmapFont_loadFont(
+			LBitmapFont *lb,
+			LTexture* bitmap,
+			char *path,
+			char *metrics)
+{
+	Uint32 imageHash;
+
+	imageHash = LBitmapFont_hashFile(path);
+
+	if(LBitmapFont_loadMetrics(lb, bitmap, metrics, imageHash) == 0)
+		return 0;
+
+	if(LBitmapFont_buildFontScan(lb, bitmap))
+		return -1;
+
+	if(LBitmapFont_saveMetrics(lb, metrics, imageHash))
+		SDL_Log("%s(), could not save font metrics to %s.", __func__, metrics);
+
+	return 0;
+}
+
 /*
  * Now that we have all the glyph sprites defined, it's time to render them to
  * the screen. First we check that there is a bitmap to render with, then we
@@ -475,9 +712,13 @@ short LBitmapFont_renderText(LBitmapFont *lb, int x, int y, char *text)
  * render anything for. When we have a space, all we have to do is move over
  * the space width. When we have a new line we move down a new line and back to
  * the base x offset.
+ *
+ * Note that the loop stops at the string's terminating null rather than
+ * calling strlen each time around, which would walk the whole string again
+ * for every character.
  */
 	size_t i;
-	for(i = 0; i < strlen(text); ++i)
+	for(i = 0; text[i] != '\0'; ++i)
 	{
 		if(text[i] == ' ')
 			curX += lb->mSpace;
@@ -497,13 +738,12 @@ short LBitmapFont_renderText(LBitmapFont *lb, int x, int y, char *text)
  * the sprite for each of them one after the other. 
  */
 		{
-			int ascii = text[i];
+			int ascii = (Uint8)text[i];
 
 			LTexture_render(
 					lb->mBitmap,
 					curX, curY,
-					&lb->mChars[ascii],
-					0.0, NULL, 0);
+					&lb->mChars[ascii]);
 
 			curX += lb->mChars[ascii].w + 1;
 		}
@@ -512,29 +752,188 @@ short LBitmapFont_renderText(LBitmapFont *lb, int x, int y, char *text)
 	return 0;
 }
 
+/*
+ * The string hash is FNV-1a, which is quick and spreads short strings well.
+ */
+Uint32 TextCache_hash(char *text)
+{
+	Uint32 hash = 2166136261u;
+
+	while(*text)
+		hash = (hash ^ (Uint8)*text++) * 16777619u;
+
+	return hash;
+}
+
+short TextCache_init(TextCache *tc, LBitmapFont *font)
+{
+	SDL_memset(tc, 0, sizeof(TextCache));
+	tc->mFont = font;
+
+	return QuadBatch_init(&tc->mBatch, TEXT_BATCH_QUADS);
+}
+
+void TextRun_free(TextRun *run)
+{
+	SDL_free(run->mText);
+	free(run->mVertices);
+	SDL_memset(run, 0, sizeof(TextRun));
+}
+
+void TextCache_free(TextCache *tc)
+{
+	int set, way;
+
+	for(set = 0; set < TEXT_CACHE_SETS; ++set)
+		for(way = 0; way < TEXT_CACHE_WAYS; ++way)
+			TextRun_free(&tc->mRuns[set][way]);
+
+	QuadBatch_free(&tc->mBatch);
+}
+
+/*
+ * Laying out a run works just like LBitmapFont_renderText, only each glyph
+ * becomes a quad in the run rather than a render call, placed relative to
+ * where the string starts.
+ */
+short TextRun_build(TextRun *run, LBitmapFont *lb, char *text, Uint32 hash)
+{
+	SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+	int curX = 0, curY = 0, quads = 0;
+	size_t i;
+
+	for(i = 0; text[i] != '\0'; ++i)
+		if(text[i] != ' ' && text[i] != '\n')
+			quads++;
+
+	run->mVertices = malloc(SDL_max(quads, 1) * 4 * sizeof(SDL_Vertex));
+	run->mText = SDL_strdup(text);
+	if(run->mVertices == NULL || run->mText == NULL) {
+		SDL_Log("%s(), out of memory.", __func__);
+		TextRun_free(run);
+		return -1;
+	}
+
+	run->mHash = hash;
+	run->mQuads = 0;
+
+	for(i = 0; text[i] != '\0'; ++i) {
+		if(text[i] == ' ')
+			curX += lb->mSpace;
+		else if(text[i] == '\n') {
+			curY += lb->mNewLine;
+			curX = 0;
+		} else {
+			Quad_set(
+					&run->mVertices[run->mQuads * 4],
+					lb->mBitmap,
+					&lb->mChars[(Uint8)text[i]],
+					curX, curY,
+					white);
+			curX += lb->mChars[(Uint8)text[i]].w + 1;
+			run->mQuads++;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Finds the run for a string, laying it out if it isn't cached yet. The
+ * hash narrows the search down to one set, and the string itself is only
+ * compared when the hashes match.
+ */
+TextRun *TextCache_find(TextCache *tc, char *text)
+{
+	Uint32 hash = TextCache_hash(text);
+	TextRun *set = tc->mRuns[hash % TEXT_CACHE_SETS];
+	TextRun *run = &set[0];
+	int way;
+
+	for(way = 0; way < TEXT_CACHE_WAYS; ++way)
+		if(set[way].mText && set[way].mHash == hash
+				&& strcmp(set[way].mText, text) == 0) {
+			run = &set[way];
+			goto found;
+		}
+
+	for(way = 1; way < TEXT_CACHE_WAYS; ++way)
+		if(run->mText && (set[way].mText == NULL
+					|| set[way].mLastUsed < run->mLastUsed))
+			run = &set[way];
+
+	TextRun_free(run);
+	if(TextRun_build(run, tc->mFont, text, hash))
+		return NULL;
+found:
+	run->mLastUsed = ++tc->mClock;
+
+	return run;
+}
+
+/*
+ * Drawing text through the cache adds the string's quads to the batch at
+ * x, y. Nothing reaches the screen until TextCache_flush is called, which
+ * should be once after all the text for the frame has been drawn.
+ */
+short TextCache_draw(TextCache *tc, int x, int y, char *text)
+{
+	TextRun *run;
+
+	if(tc->mFont->mBitmap == NULL)
+		return -1;
+
+	run = TextCache_find(tc, text);
+	if(run == NULL)
+		return -1;
+
+	QuadBatch_addQuads(
+			&tc->mBatch,
+			tc->mFont->mBitmap,
+			run->mVertices,
+			run->mQuads,
+			x, y);
+
+	return 0;
+}
+
+void TextCache_flush(TextCache *tc)
+{
+	QuadBatch_flush(&tc->mBatch, tc->mFont->mBitmap);
+}
+
 short loadMedia(void)
 {
-	if(LTexture_loadFromFile(&gBitmapTexture, "lazyfont.png"))
+	if(LTexture_loadLockable(&gBitmapTexture, "lazyfont.png"))
 		return -1;
 
-	LBitmapFont_buildFont(&gBitmapFont, &gBitmapTexture);
+	if(LBitmapFont_loadFont(
+				&gBitmapFont,
+				&gBitmapTexture,
+				"lazyfont.png",
+				"lazyfont.metrics"))
+		return -1;
+
+	if(TextCache_init(&gTextCache, &gBitmapFont))
+		return -1;
 
 	return 0;
 }
 
 void close_all(void)
 {
+	TextCache_free(&gTextCache);
 	LTexture_free(&gBitmapTexture);
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
+/*
+ * The text is now drawn through the text cache, so the strings are laid out
+ * on the first frame and every frame after that is one render call for all
+ * of them.
+ */
+#ifndef BENCHMARK
 int main(int argc, char* args[])
 {
 	if(init())
@@ -554,15 +953,16 @@ int main(int argc, char* args[])
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
 
-		LBitmapFont_renderText(
-				&gBitmapFont, 50, 10,
+		TextCache_draw(
+				&gTextCache, 50, 10,
 				"Bitmap Font:\n");
-		LBitmapFont_renderText(
-				&gBitmapFont, 50, 50,
+		TextCache_draw(
+				&gTextCache, 50, 50,
 				"ABDCEFGHIJKLMNOPQRSTUVWXYZ\n");
-		LBitmapFont_renderText(
-				&gBitmapFont, 100, 100,
+		TextCache_draw(
+				&gTextCache, 100, 100,
 				"abcdefghijklmnopqrstuvwxyz\n0123456789");
+		TextCache_flush(&gTextCache);
 
 		SDL_RenderPresent(gRenderer);
 	}
@@ -571,4 +971,105 @@ equit:
 
 	return 0;
 }
+#else
+/*
+ * Bitmap font benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which runs headless through the benchmark harness. It
+ * times building the font's metrics the tutorial's way and with the one pass
+ * scan, and loading them from the metrics file instead, hashing the image
+ * to check them as the demo does. It then lays out BENCH_TEXT into a fresh
+ * text run, and draws BENCH_LINES lines through the text cache once they
+ * are all cached. The cache's batch is emptied after each iteration rather
+ * than flushed, so only the layout is timed.
+ */
+#define BENCH_LINES		32
+#define BENCH_TEXT	"The quick brown fox jumps over the lazy dog.\n" \
+			"PACK MY BOX WITH FIVE DOZEN LIQUOR JUGS!\n" \
+			"0123456789 ~!@#$%^&*()_+-={}[]|\\:;\"'<>,.?/\n"
+
+typedef struct {
+	LBitmapFont mFont;
+	TextRun mRun;
+	char mLines[BENCH_LINES][32];
+} BenchFont;
+
+void bench_buildFont(void *data)
+{
+	BenchFont *bf = data;
+
+	LBitmapFont_buildFont(&bf->mFont, &gBitmapTexture);
+}
+
+void bench_buildFontScan(void *data)
+{
+	BenchFont *bf = data;
+
+	LBitmapFont_buildFontScan(&bf->mFont, &gBitmapTexture);
+}
+
+void bench_loadMetrics(void *data)
+{
+	BenchFont *bf = data;
+
+	LBitmapFont_loadMetrics(&bf->mFont, &gBitmapTexture, "lazyfont.metrics",
+			LBitmapFont_hashFile("lazyfont.png"));
+}
+
+void bench_layout(void *data)
+{
+	BenchFont *bf = data;
+
+	TextRun_build(&bf->mRun, &gBitmapFont, BENCH_TEXT,
+			TextCache_hash(BENCH_TEXT));
+	TextRun_free(&bf->mRun);
+}
+
+void bench_drawCached(void *data)
+{
+	BenchFont *bf = data;
+	int i;
+
+	for(i = 0; i < BENCH_LINES; ++i)
+		TextCache_draw(&gTextCache, 0, i * gBitmapFont.mNewLine, bf->mLines[i]);
+	gTextCache.mBatch.mQuads = 0;
+}
+
+int main(int argc, char* args[])
+{
+	Bench bench;
+	BenchFont bf;
+	int i, chars = 0, ret = 1;
 
+	SDL_memset(&bf, 0, sizeof(BenchFont));
+
+	if(Bench_init(&bench, "41_bitmap_fonts", argc, args))
+		return 1;
+
+	if(LTut_init("SDL Benchmark", SCREEN_WIDTH, SCREEN_HEIGHT, 0, LTUT_HEADLESS))
+		goto equit;
+
+	if(loadMedia())
+		goto equit;
+
+	for(i = 0; i < BENCH_LINES; ++i) {
+		SDL_snprintf(bf.mLines[i], sizeof(bf.mLines[i]),
+				"Line %d of the cached text", i);
+		chars += SDL_strlen(bf.mLines[i]);
+	}
+
+	Bench_run(&bench, "build font", bench_buildFont, &bf, 256);
+	Bench_run(&bench, "build font scan", bench_buildFontScan, &bf, 256);
+	Bench_run(&bench, "load font metrics", bench_loadMetrics, &bf, 256);
+	Bench_run(&bench, "layout text run", bench_layout, &bf,
+			SDL_strlen(BENCH_TEXT));
+	Bench_run(&bench, "draw cached text", bench_drawCached, &bf, chars);
+
+	ret = 0;
+equit:
+	close_all();
+
+	return Bench_finish(&bench) || ret;
+}
+#endif
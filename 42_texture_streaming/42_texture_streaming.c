@@ -7,6 +7,10 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
+
 #define IMG_NUM		4
 #define FRAME_DELAY	4
 #define SCREEN_WIDTH	640
@@ -283,6 +287,7 @@ void close_all(void)
  * convert from one format to another but ultimately all we need is a means to
  * get the pixel data and copy it to the screen.
  */
+#ifndef BENCHMARK
 int main(int argc, char* args[])
 {
 	if(init())
@@ -321,3 +326,102 @@ equit:
 
 	return 0;
 }
+#else
+/*
+ * Texture streaming benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which runs headless through the benchmark harness. It
+ * times streaming a frame of the walking animation into its texture the way
+ * the demo does, lock, copy and unlock, then the same for a BENCH_WIDTH by
+ * BENCH_HEIGHT frame, and last the big frame again through
+ * SDL_UpdateTexture, which does the copy for us.
+ */
+#define BENCH_WIDTH		1920
+#define BENCH_HEIGHT		1080
+
+typedef struct {
+	LTexture mTexture;
+	void *mFrame;
+	int mPitch;
+} BenchStream;
+
+void bench_streamWalk(void *data)
+{
+	LTexture_lockTexture(&gStreamingTexture);
+	LTexture_copyPixels(
+			&gStreamingTexture,
+			DataStream_getBuffer(&gDataStream));
+	LTexture_unlockTexture(&gStreamingTexture);
+}
+
+void bench_streamFrame(void *data)
+{
+	BenchStream *bs = data;
+
+	LTexture_lockTexture(&bs->mTexture);
+	LTexture_copyPixels(&bs->mTexture, bs->mFrame);
+	LTexture_unlockTexture(&bs->mTexture);
+}
+
+void bench_updateFrame(void *data)
+{
+	BenchStream *bs = data;
+
+	SDL_UpdateTexture(bs->mTexture.mTexture, NULL, bs->mFrame, bs->mPitch);
+}
+
+/*
+ * The big frame is as long as the texture's pitch says a locked row is, which
+ * copyPixels relies on, so the texture is locked once up front to find out.
+ */
+int main(int argc, char* args[])
+{
+	Bench bench;
+	BenchStream bs = { { NULL, NULL, 0, 0, 0 }, NULL, 0 };
+	int ret = 1;
+
+	if(Bench_init(&bench, "42_texture_streaming", argc, args))
+		return 1;
+
+	if(Bench_createRenderer(&gWindow, &gRenderer, SCREEN_WIDTH, SCREEN_HEIGHT))
+		goto equit;
+
+	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+		goto equit;
+	}
+
+	if(loadMedia())
+		goto equit;
+
+	if(LTexture_createBlank(&bs.mTexture, BENCH_WIDTH, BENCH_HEIGHT)
+			|| LTexture_lockTexture(&bs.mTexture))
+		goto equit;
+	bs.mPitch = bs.mTexture.mPitch;
+	LTexture_unlockTexture(&bs.mTexture);
+
+	bs.mFrame = malloc(bs.mPitch * BENCH_HEIGHT);
+	if(bs.mFrame == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		goto equit;
+	}
+	SDL_memset(bs.mFrame, 0x80, bs.mPitch * BENCH_HEIGHT);
+
+	Bench_run(&bench, "stream walk frame", bench_streamWalk, NULL,
+			LTexture_getWidth(&gStreamingTexture)
+			* LTexture_getHeight(&gStreamingTexture));
+	Bench_run(&bench, "stream 1080p frame", bench_streamFrame, &bs,
+			BENCH_WIDTH * BENCH_HEIGHT);
+	Bench_run(&bench, "update 1080p frame", bench_updateFrame, &bs,
+			BENCH_WIDTH * BENCH_HEIGHT);
+
+	ret = 0;
+equit:
+	free(bs.mFrame);
+	LTexture_free(&bs.mTexture);
+	close_all();
+
+	return Bench_finish(&bench) || ret;
+}
+#endif
@@ -6,7 +6,7 @@
  * independent of frame rate.
  */
 #include <SDL2/SDL.h>
-#include <SDL2/SDL_image.h>
+#include "ltut.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
@@ -15,21 +15,14 @@
 #define DOT_VEL		300
 #define DOT_JOY_VEL	50
 #define JOYSTICK_DEAD_ZONE	10000
+#define GAME_TICK_RATE		120
+#define GAME_MAX_CATCH_UP	8
 
-typedef struct {
-	SDL_Texture* mTexture;
-	void* mPixels;
-	int mPitch;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
-typedef struct {
-	Uint32 mStartTicks;
-	Uint32 mPausedTicks;
-	short mPaused;
-	short mStarted;
-} LTimer;
+/*
+ * In a headless run the scripted dot turns a quarter turn every HEADLESS_TURN
+ * ticks.
+ */
+#define HEADLESS_TURN	120
 
 /*
  * The dot struct returns adapted for frame independent movement. Notice how the
@@ -46,37 +39,40 @@ typedef struct {
  * Also notice how the position and velocity are floats instead of integers. If
  * we used integers the motion would be always truncated to the nearest integer
  * which would cause greater inaccuracies.
+ *
+ * The dot also remembers where it was before the last tick, so it can be drawn
+ * part way between there and where it is now.
  */
 typedef struct {
 	float mPosX, mPosY;
+	float mPrevX, mPrevY;
 	float mVelX, mVelY;
 } Dot;
 
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 SDL_GameController* gGameController = NULL;
 LTexture gDotTexture;
 Dot dot;
+Headless gHeadless = { 0, 1, 0 };
 
 void Dot_init(Dot *d)
 {
 	d->mPosX = 0;
 	d->mPosY = 0;
+	d->mPrevX = 0;
+	d->mPrevY = 0;
 	d->mVelX = 0;
 	d->mVelY = 0;
 }
 
+/*
+ * vsync is not enabled for this tutorial.
+ */
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_GAMECONTROLLER) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+	if(LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_GAMECONTROLLER, LTUT_LINEAR |
+				(gHeadless.mTicks > 0 ? LTUT_HEADLESS : 0)))
 		return -1;
-	}
-
-	if(SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0) {
-		SDL_Log("%s(), Warning: Linear texture filtering not enabled. %s", 
-				__func__, SDL_GetError());
-	}
 
     for (int i = 0; i < SDL_NumJoysticks(); i++) {
         if (SDL_IsGameController(i)) {
@@ -88,180 +84,11 @@ short init(void)
         }
     }
 
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(gWindow, -1, SDL_RENDERER_ACCELERATED);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
 	Dot_init(&dot);
 
 	return 0;
 }
 
-void LTexture_free(LTexture *lt)
-{
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-		lt->mPixels = NULL;
-		lt->mPitch = 0;
-	}
-}
-
-/*
- * vsync is not enabled for this tutorial.
- */
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	LTexture_free(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(
-							loadedSurface,
-							SDL_PIXELFORMAT_RGBA8888,
-							SDL_SWSURFACE);
-	if(formattedSurface == NULL) {
-		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed.", __func__);
-		return -1;
-	}
-
-	newTexture = SDL_CreateTexture(
-					gRenderer,
-					SDL_PIXELFORMAT_RGBA8888,
-					SDL_TEXTUREACCESS_STREAMING,
-					formattedSurface->w,
-					formattedSurface->h);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
-
-	SDL_LockTexture(
-				newTexture,
-				&formattedSurface->clip_rect,
-				&lt->mPixels,
-				&lt->mPitch);
-
-	memcpy(
-			lt->mPixels,
-			formattedSurface->pixels,
-			formattedSurface->pitch * formattedSurface->h);
-
-	lt->mWidth = formattedSurface->w;
-	lt->mHeight = formattedSurface->h;
-
-	Uint32* pixels = (Uint32*)lt->mPixels;
-	int pixelCount = (lt->mPitch / 4) * lt->mHeight;
-
-	Uint32 colorKey = SDL_MapRGB(formattedSurface->format, 0, 0xFF, 0xFF);
-	Uint32 transparent = SDL_MapRGBA(
-			formattedSurface->format, 0x00, 0xFF, 0xFF, 0x00);
-
-	int i;
-	for(i = 0; i < pixelCount; ++i)
-		if(pixels[i] == colorKey)
-			pixels[i] = transparent;
-
-	SDL_UnlockTexture(newTexture);
-	lt->mPixels = NULL;
-
-	SDL_FreeSurface(formattedSurface);
-		
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-void LTexture_render(
-			LTexture *lt,
-			int x, int y,
-			SDL_Rect* clip,
-			double angle,
-			SDL_Point* center,
-			SDL_RendererFlip flip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
-				&renderQuad, angle, center, flip);
-}
-
-void LTimer_start(LTimer *t)
-{
-	t->mStarted = 1;
-	t->mPaused = 0;
-	t->mStartTicks = SDL_GetTicks();
-	t->mPausedTicks = 0;
-}
-
-Uint32 LTimer_getTicks(LTimer *t)
-{
-	Uint32 time = 0;
-
-	if(t->mStarted) {
-		if(t->mPaused)
-			time = t->mPausedTicks;
-		else
-			time = SDL_GetTicks() - t->mStartTicks;
-	}
-
-	return time;
-}
-
-/*
- * When we move around the dot we first get the time from the step time so we
- * know how much time has passed since the last time we moved. We turn it from
- * milliseconds into seconds and pass it to the move function. After we're done
- * moving we restart the step timer so we'll now how much time has passed for
- * when we need to move again. Finally we render as we normally do.
- *
- * For most of these tutorials, things are simplified to make things easier to
- * digest. For most if not all applications we use time based movement as
- * opposed to frame based movement. Even when we have a fixed frame rate, we
- * just use a constant time step. The thing is when using time based movement
- * you run into problems with floating point errors which require vector math
- * to fix, and vector math is beyond the scope of this tutorial which is why
- * frame based movement is used for most of the tutorials.
- */
 void handle_keyboard_events(Dot *d, SDL_Event *e)
 {
 	if(e->type == SDL_KEYDOWN && e->key.repeat == 0) {
@@ -337,13 +164,25 @@ void Dot_move(Dot *d, float timeStep)
 }
 
 /*
- * To prevent the compiler from barking at us, we convert the positions to
- * integers when rendering the dot.
+ * Called before each tick to remember where the dot was.
  */
-void Dot_render(Dot *d)
+void Dot_savePosition(Dot *d)
 {
-	LTexture_render(&gDotTexture, (int)d->mPosX, (int)d->mPosY,
-			NULL, 0.0, NULL, 0);
+	d->mPrevX = d->mPosX;
+	d->mPrevY = d->mPosY;
+}
+
+/*
+ * The dot is drawn alpha of the way from where it was before the last tick to
+ * where it is now. To prevent the compiler from barking at us, we convert the
+ * positions to integers when rendering the dot.
+ */
+void Dot_render(Dot *d, float alpha)
+{
+	float x = d->mPrevX + (d->mPosX - d->mPrevX) * alpha;
+	float y = d->mPrevY + (d->mPosY - d->mPrevY) * alpha;
+
+	LTexture_renderEx(&gDotTexture, (int)x, (int)y, NULL, 0.0, NULL, 0);
 }
 
 short loadMedia(void)
@@ -360,24 +199,45 @@ void close_all(void)
 	SDL_GameControllerClose(gGameController);
 	gGameController = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
+ * When we move around the dot we could get the time from a step timer so we
+ * know how much time has passed since the last time we moved, and pass that
+ * to the move function. But then the dot moves by a different amount every
+ * frame, and how it moves depends on the frame rate. Instead the game loop
+ * from the tutorial library moves it in fixed ticks of GAME_TICK_RATE a
+ * second and the dot is drawn between ticks.
+ *
+ * For most of these tutorials, things are simplified to make things easier to
+ * digest. For most if not all applications we use time based movement as
+ * opposed to frame based movement. Even when we have a fixed frame rate, we
+ * just use a constant time step. The thing is when using time based movement
+ * you run into problems with floating point errors which require vector math
+ * to fix, and vector math is beyond the scope of this tutorial which is why
+ * frame based movement is used for most of the tutorials.
+ *
  * For this demo we disabled vsync to show it can run regardless of the frame
- * rate. In order to know how much time has passed between renders, we need to
- * timer to keep track of the time step.
+ * rate. The game loop keeps track of how much time has passed between renders
+ * and how many ticks that makes, and we log whenever it had to drop some.
+ *
+ * Since every tick is the same length the simulation does exactly the same
+ * thing on every machine and at every frame rate. Run with --headless TICKS,
+ * the loop is advanced by one tick's worth of time every time around rather
+ * than by the time that really went by, so the dot, steered by a script,
+ * moves as fast as the machine can go, and the state hash printed at the end
+ * is the same on every run.
  */
 int main(int argc, char* args[])
 {
-	LTimer stepTimer;
-	float timeStep;
+	GameLoop loop;
+	Uint64 dropped = 0;
+	Uint32 hash;
+	int ticks, velX, velY;
+
+	if(Headless_parseArgs(&gHeadless, argc, args) < 0)
+		return 1;
 
 	if(init())
 		goto equit;
@@ -387,6 +247,11 @@ int main(int argc, char* args[])
 
 	SDL_Event e;
 
+	GameLoop_init(&loop, GAME_TICK_RATE, GAME_MAX_CATCH_UP);
+
+	if(gHeadless.mTicks > 0)
+		Headless_start(&gHeadless);
+
 	while(1)
 	{
 		while(SDL_PollEvent(&e) != 0) {
@@ -413,16 +278,39 @@ int main(int argc, char* args[])
 			}
 		}
 
-		timeStep = LTimer_getTicks(&stepTimer) / 1000.f;
-		Dot_move(&dot, timeStep);
-		LTimer_start(&stepTimer);
+		if(gHeadless.mTicks > 0) {
+			if(loop.mTicks == (Uint64)gHeadless.mTicks)
+				break;
+			Headless_steer(loop.mTicks, HEADLESS_TURN, DOT_VEL,
+					&velX, &velY);
+			dot.mVelX = velX;
+			dot.mVelY = velY;
+			ticks = GameLoop_advance(&loop, loop.mTickNs);
+		} else
+			ticks = GameLoop_beginFrame(&loop);
+
+		while(ticks-- > 0) {
+			Dot_savePosition(&dot);
+			Dot_move(&dot, loop.mTickSeconds);
+		}
+
+		if(loop.mDropped != dropped) {
+			SDL_Log("Fell behind, %" SDL_PRIu64 " ticks dropped so far.",
+					loop.mDropped);
+			dropped = loop.mDropped;
+		}
+
+		if(!gHeadless.mRender)
+			continue;
 
 		SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
 		SDL_RenderClear(gRenderer);
-		Dot_render(&dot);
+		Dot_render(&dot, GameLoop_getAlpha(&loop));
 		SDL_RenderPresent(gRenderer);
-		SDL_Delay(60);
 	}
+
+	hash = Headless_hash(HEADLESS_HASH, &dot, sizeof(Dot));
+	Headless_report(&gHeadless, hash);
 equit:
 	close_all();
 
@@ -8,20 +8,12 @@
  */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_thread.h>
-#include <SDL2/SDL_image.h>
 #include <stdio.h>
+#include "ltut.h"
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 
-typedef struct {
-	SDL_Texture* mTexture;
-	void* mPixels;
-	int mPitch;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 /*
  * Here is our worker thread function. We will spawn two threads that will each
  * execute their copy of this code.
@@ -32,150 +24,14 @@ typedef struct {
  * need to make sure it is only being accessed by one thread at a time.
  */
 int worker(void *data);
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 LTexture gSplashTexture;
 SDL_sem* gDataLock = NULL;
 int gData = -1;	
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-
-void LTexture_free(LTexture *lt)
-{
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-		lt->mPixels = NULL;
-		lt->mPitch = 0;
-	}
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	LTexture_free(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(
-					loadedSurface,
-					SDL_PIXELFORMAT_RGBA8888,
-					SDL_SWSURFACE);
-
-	if(formattedSurface == NULL) {
-		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed.", __func__);
-		return -1;
-	}
-
-	newTexture = SDL_CreateTexture(
-					gRenderer,
-					SDL_PIXELFORMAT_RGBA8888,
-					SDL_TEXTUREACCESS_STREAMING,
-					formattedSurface->w,
-					formattedSurface->h);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
-
-	SDL_LockTexture(
-			newTexture,
-			&formattedSurface->clip_rect,
-			&lt->mPixels,
-			&lt->mPitch);
-
-	memcpy(
-			lt->mPixels,
-			formattedSurface->pixels,
-			formattedSurface->pitch * formattedSurface->h);
-
-	lt->mWidth = formattedSurface->w;
-	lt->mHeight = formattedSurface->h;
-
-	Uint32* pixels = (Uint32*)lt->mPixels;
-	int pixelCount = (lt->mPitch / 4) * lt->mHeight;
-
-	Uint32 colorKey = SDL_MapRGB(formattedSurface->format, 0, 0xFF, 0xFF);
-	Uint32 transparent = SDL_MapRGBA(
-			formattedSurface->format, 0x00, 0xFF, 0xFF, 0x00);
-
-	int i;
-	for(i = 0; i < pixelCount; ++i)
-		if(pixels[i] == colorKey)
-			pixels[i] = transparent;
-
-	SDL_UnlockTexture(newTexture);
-	lt->mPixels = NULL;
-
-	SDL_FreeSurface(formattedSurface);
-		
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-void LTexture_render(
-			LTexture *lt,
-			int x, int y,
-			SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
+	return LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				SDL_INIT_TIMER, LTUT_VSYNC);
 }
 
 /*
@@ -209,13 +65,7 @@ void close_all(void)
 	SDL_DestroySemaphore(gDataLock);
 	gDataLock = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -15,21 +15,17 @@
  */
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_thread.h>
-#include <SDL2/SDL_image.h>
 #include <stdio.h>
+#include "ltut.h"
+
+#ifdef BENCHMARK
+#include "bench.h"
+#endif
 
 #define SCREEN_WIDTH	640
 #define SCREEN_HEIGHT	480
 #define SCREEN_FPS	60
 
-typedef struct {
-	SDL_Texture* mTexture;
-	void* mPixels;
-	int mPitch;
-	int mWidth;
-	int mHeight;
-} LTexture;
-
 int producer(void*);
 int consumer(void*);
 void produce(void);
@@ -39,8 +35,6 @@ void consume(void);
  * Here we're globally declaring the mutex and conditions that will be used by
  * the threads.
  */
-SDL_Window* gWindow = NULL;
-SDL_Renderer* gRenderer = NULL;
 LTexture gSplashTexture;
 SDL_mutex* gBufferLock = NULL;
 SDL_cond* gCanProduce = NULL;
@@ -50,141 +44,8 @@ int gData = -1;
 
 short init(void)
 {
-	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
-		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gWindow = SDL_CreateWindow(
-					"SDL Tutorial",
-					SDL_WINDOWPOS_UNDEFINED,
-					SDL_WINDOWPOS_UNDEFINED,
-					SCREEN_WIDTH,
-					SCREEN_HEIGHT,
-					SDL_WINDOW_SHOWN);
-	if(gWindow == NULL) {
-		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	gRenderer = SDL_CreateRenderer(
-					gWindow,
-					-1,
-					SDL_RENDERER_ACCELERATED
-					| SDL_RENDERER_PRESENTVSYNC);
-	if(gRenderer == NULL) {
-		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
-
-	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
-		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
-		return -1;
-	}
-
-	return 0;
-}
-void LTexture_free(LTexture *lt)
-{
-	if(lt->mTexture != NULL) {
-		SDL_DestroyTexture(lt->mTexture);
-		lt->mTexture = NULL;
-		lt->mWidth = 0;
-		lt->mHeight = 0;
-		lt->mPixels = NULL;
-		lt->mPitch = 0;
-	}
-}
-
-short LTexture_loadFromFile(LTexture *lt, char *path)
-{
-	LTexture_free(lt);
-
-	SDL_Texture* newTexture = NULL;
-
-	SDL_Surface* loadedSurface = IMG_Load(path);
-	if(loadedSurface == NULL) {
-		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
-
-		return -1;
-	}
-
-	SDL_Surface* formattedSurface = SDL_ConvertSurfaceFormat(
-					loadedSurface,
-					SDL_PIXELFORMAT_RGBA8888,
-					SDL_SWSURFACE);
-
-	if(formattedSurface == NULL) {
-		SDL_Log("%s(), SDL_ConvertSurfaceFormat failed.", __func__);
-		return -1;
-	}
-
-	newTexture = SDL_CreateTexture(
-					gRenderer,
-					SDL_PIXELFORMAT_RGBA8888,
-					SDL_TEXTUREACCESS_STREAMING,
-					formattedSurface->w,
-					formattedSurface->h);
-	if(newTexture == NULL) {
-		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
-		return -1;
-	}
-
-	SDL_SetTextureBlendMode(newTexture, SDL_BLENDMODE_BLEND);
-
-	SDL_LockTexture(
-			newTexture,
-			&formattedSurface->clip_rect,
-			&lt->mPixels,
-			&lt->mPitch);
-
-	memcpy(
-			lt->mPixels,
-			formattedSurface->pixels,
-			formattedSurface->pitch * formattedSurface->h);
-
-	lt->mWidth = formattedSurface->w;
-	lt->mHeight = formattedSurface->h;
-
-	Uint32* pixels = (Uint32*)lt->mPixels;
-	int pixelCount = (lt->mPitch / 4) * lt->mHeight;
-
-	Uint32 colorKey = SDL_MapRGB(formattedSurface->format, 0, 0xFF, 0xFF);
-	Uint32 transparent = SDL_MapRGBA(
-			formattedSurface->format, 0x00, 0xFF, 0xFF, 0x00);
-
-	int i;
-	for(i = 0; i < pixelCount; ++i)
-		if(pixels[i] == colorKey)
-			pixels[i] = transparent;
-
-	SDL_UnlockTexture(newTexture);
-	lt->mPixels = NULL;
-
-	SDL_FreeSurface(formattedSurface);
-		
-	SDL_FreeSurface(loadedSurface);
-
-	lt->mTexture = newTexture;
-
-	return 0;
-}
-
-void LTexture_render(
-			LTexture *lt,
-			int x, int y,
-			SDL_Rect* clip)
-{
-	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
-
-	if(clip != NULL) {
-		renderQuad.w = clip->w;
-		renderQuad.h = clip->h;
-	}
-
-	SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
+	return LTut_init("SDL Tutorial", SCREEN_WIDTH, SCREEN_HEIGHT,
+				0, LTUT_VSYNC);
 }
 
 /*
@@ -220,13 +81,7 @@ void close_all(void)
 	gCanProduce = NULL;
 	gCanConsume = NULL;
 
-	SDL_DestroyRenderer(gRenderer);
-	SDL_DestroyWindow(gWindow);
-	gWindow = NULL;
-	gRenderer = NULL;
-
-	IMG_Quit();
-	SDL_Quit();
+	LTut_close();
 }
 
 /*
@@ -330,6 +185,7 @@ void consume(void)
 	SDL_CondSignal(gCanProduce);
 }
 
+#ifndef BENCHMARK
 int main(int argc, char* args[])
 {
 	if(init())
@@ -364,3 +220,196 @@ equit:
 
 	return 0;
 }
+#else
+/*
+ * Threading primitive benchmark
+ *
+ * Building with -DBENCHMARK (make bench, or the suite in bench/) swaps the
+ * demo for this main, which needs no window and runs each loop through the
+ * benchmark harness. It covers the primitives of the last few tutorials.
+ *
+ * First the cost of each lock when nobody else wants it: BENCH_LOCKS spinlock
+ * lock and unlock pairs an iteration, the same number of atomic adds, and
+ * the same number of mutex lock and unlock pairs.
+ *
+ * Then what it costs to hand control to another thread and back, BENCH_TRIPS
+ * round trips an iteration: once with a pair of semaphores, each thread
+ * posting the one the other waits on, and once with a one slot buffer guarded
+ * by a mutex and two conditions, just like the producer and consumer above.
+ */
+#define BENCH_LOCKS		100000
+#define BENCH_TRIPS		1000
+#define BENCH_EMPTY		-1
+#define BENCH_QUIT		-2
+
+typedef struct {
+	SDL_SpinLock mSpin;
+	SDL_atomic_t mAtomic;
+	int mCounter;
+
+	SDL_sem *mPing, *mPong;
+	SDL_atomic_t mQuit;
+
+	SDL_mutex *mLock;
+	SDL_cond *mCanProduce, *mCanConsume;
+	int mData;
+} BenchThreads;
+
+void bench_spinlock(void *data)
+{
+	BenchThreads *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_LOCKS; ++i) {
+		SDL_AtomicLock(&bt->mSpin);
+		bt->mCounter++;
+		SDL_AtomicUnlock(&bt->mSpin);
+	}
+}
+
+void bench_atomic(void *data)
+{
+	BenchThreads *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_LOCKS; ++i)
+		SDL_AtomicAdd(&bt->mAtomic, 1);
+}
+
+void bench_mutex(void *data)
+{
+	BenchThreads *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_LOCKS; ++i) {
+		SDL_LockMutex(bt->mLock);
+		bt->mCounter++;
+		SDL_UnlockMutex(bt->mLock);
+	}
+}
+
+int bench_semPartner(void *data)
+{
+	BenchThreads *bt = data;
+
+	while(1) {
+		SDL_SemWait(bt->mPing);
+		if(SDL_AtomicGet(&bt->mQuit))
+			return 0;
+		SDL_SemPost(bt->mPong);
+	}
+}
+
+void bench_semaphores(void *data)
+{
+	BenchThreads *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_TRIPS; ++i) {
+		SDL_SemPost(bt->mPing);
+		SDL_SemWait(bt->mPong);
+	}
+}
+
+/*
+ * Unlike the tutorial's consume, the waits here loop, since a condition
+ * variable is allowed to wake a thread up even though nobody signaled it.
+ */
+int bench_consumer(void *data)
+{
+	BenchThreads *bt = data;
+
+	SDL_LockMutex(bt->mLock);
+	while(1) {
+		while(bt->mData == BENCH_EMPTY)
+			SDL_CondWait(bt->mCanConsume, bt->mLock);
+		if(bt->mData == BENCH_QUIT)
+			break;
+		bt->mData = BENCH_EMPTY;
+		SDL_CondSignal(bt->mCanProduce);
+	}
+	SDL_UnlockMutex(bt->mLock);
+
+	return 0;
+}
+
+void bench_produce(BenchThreads *bt, int value)
+{
+	SDL_LockMutex(bt->mLock);
+	while(bt->mData != BENCH_EMPTY)
+		SDL_CondWait(bt->mCanProduce, bt->mLock);
+	bt->mData = value;
+	SDL_CondSignal(bt->mCanConsume);
+	SDL_UnlockMutex(bt->mLock);
+}
+
+void bench_conditions(void *data)
+{
+	BenchThreads *bt = data;
+	int i;
+
+	for(i = 0; i < BENCH_TRIPS; ++i)
+		bench_produce(bt, i);
+}
+
+int main(int argc, char* args[])
+{
+	Bench bench;
+	BenchThreads bt;
+	SDL_Thread *partner;
+	int ret = 1;
+
+	SDL_memset(&bt, 0, sizeof(BenchThreads));
+	bt.mData = BENCH_EMPTY;
+
+	if(Bench_init(&bench, "49_mutexes_and_conditions", argc, args))
+		return 1;
+
+	bt.mPing = SDL_CreateSemaphore(0);
+	bt.mPong = SDL_CreateSemaphore(0);
+	bt.mLock = SDL_CreateMutex();
+	bt.mCanProduce = SDL_CreateCond();
+	bt.mCanConsume = SDL_CreateCond();
+	if(bt.mPing == NULL || bt.mPong == NULL || bt.mLock == NULL
+			|| bt.mCanProduce == NULL || bt.mCanConsume == NULL) {
+		SDL_Log("%s(), creating the primitives failed. %s",
+				__func__, SDL_GetError());
+		goto equit;
+	}
+
+	Bench_run(&bench, "spinlock", bench_spinlock, &bt, BENCH_LOCKS);
+	Bench_run(&bench, "atomic add", bench_atomic, &bt, BENCH_LOCKS);
+	Bench_run(&bench, "mutex", bench_mutex, &bt, BENCH_LOCKS);
+
+	partner = SDL_CreateThread(bench_semPartner, "Partner", &bt);
+	if(partner == NULL) {
+		SDL_Log("%s(), SDL_CreateThread failed. %s", __func__, SDL_GetError());
+		goto equit;
+	}
+	Bench_run(&bench, "semaphore round trip", bench_semaphores, &bt,
+			BENCH_TRIPS);
+	SDL_AtomicSet(&bt.mQuit, 1);
+	SDL_SemPost(bt.mPing);
+	SDL_WaitThread(partner, NULL);
+
+	partner = SDL_CreateThread(bench_consumer, "Consumer", &bt);
+	if(partner == NULL) {
+		SDL_Log("%s(), SDL_CreateThread failed. %s", __func__, SDL_GetError());
+		goto equit;
+	}
+	Bench_run(&bench, "condition round trip", bench_conditions, &bt,
+			BENCH_TRIPS);
+	bench_produce(&bt, BENCH_QUIT);
+	SDL_WaitThread(partner, NULL);
+
+	ret = 0;
+equit:
+	SDL_DestroySemaphore(bt.mPing);
+	SDL_DestroySemaphore(bt.mPong);
+	SDL_DestroyMutex(bt.mLock);
+	SDL_DestroyCond(bt.mCanProduce);
+	SDL_DestroyCond(bt.mCanConsume);
+
+	return Bench_finish(&bench) || ret;
+}
+#endif
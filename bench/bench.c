@@ -0,0 +1,330 @@
+/*
+ * Benchmark harness
+ *
+ * See bench.h for what the harness does; here is how.
+ */
+#include "bench.h"
+
+#include <stdio.h>
+
+/*
+ * Allocations are counted in two places. SDL lets us swap in our own memory
+ * functions, so everything SDL and its libraries allocate through SDL_malloc
+ * is counted wherever the benchmark runs. The tutorials themselves call
+ * malloc, which on Linux the bench makefile has the linker redirect through
+ * the __wrap_ functions below with --wrap; elsewhere those are left out and
+ * only SDL's allocations are counted.
+ */
+SDL_SpinLock gBenchAllocLock = 0;
+Uint64 gBenchAllocs = 0;
+Uint64 gBenchAllocBytes = 0;
+SDL_malloc_func gBenchMalloc;
+SDL_calloc_func gBenchCalloc;
+SDL_realloc_func gBenchRealloc;
+SDL_free_func gBenchFree;
+
+void Bench_countAlloc(size_t size)
+{
+	SDL_AtomicLock(&gBenchAllocLock);
+	gBenchAllocs++;
+	gBenchAllocBytes += size;
+	SDL_AtomicUnlock(&gBenchAllocLock);
+}
+
+void Bench_readAllocs(Uint64 *count, Uint64 *bytes)
+{
+	SDL_AtomicLock(&gBenchAllocLock);
+	*count = gBenchAllocs;
+	*bytes = gBenchAllocBytes;
+	SDL_AtomicUnlock(&gBenchAllocLock);
+}
+
+void *Bench_sdlMalloc(size_t size)
+{
+	Bench_countAlloc(size);
+	return gBenchMalloc(size);
+}
+
+void *Bench_sdlCalloc(size_t nmemb, size_t size)
+{
+	Bench_countAlloc(nmemb * size);
+	return gBenchCalloc(nmemb, size);
+}
+
+void *Bench_sdlRealloc(void *mem, size_t size)
+{
+	Bench_countAlloc(size);
+	return gBenchRealloc(mem, size);
+}
+
+#ifdef BENCH_WRAP_MALLOC
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *mem, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	Bench_countAlloc(size);
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size)
+{
+	Bench_countAlloc(nmemb * size);
+	return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *mem, size_t size)
+{
+	Bench_countAlloc(size);
+	return __real_realloc(mem, size);
+}
+#endif
+
+/*
+ * The baseline is the JSON an earlier run wrote. We wrote it, so rather than
+ * parse JSON in general we rely on its layout: the program's name is on a
+ * line of its own and each result is a line holding its name and median.
+ */
+short Bench_loadBaseline(Bench *b, char *path)
+{
+	char program[BENCH_NAME] = "", *text, *line, *end, *field;
+	BenchBaseline *bl;
+
+	text = SDL_LoadFile(path, NULL);
+	if(text == NULL) {
+		SDL_Log("%s(), SDL_LoadFile failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	b->mBaseline = malloc(BENCH_BASELINE * sizeof(BenchBaseline));
+	if(b->mBaseline == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		SDL_free(text);
+		return -1;
+	}
+
+	for(line = text; *line != '\0'; line = end) {
+		end = SDL_strchr(line, '\n');
+		if(end == NULL)
+			end = line + SDL_strlen(line);
+		else
+			*end++ = '\0';
+
+		if((field = SDL_strstr(line, "\"program\": \"")) != NULL) {
+			SDL_sscanf(field, "\"program\": \"%63[^\"]\"", program);
+			continue;
+		}
+
+		if(b->mBaselineCount == BENCH_BASELINE)
+			break;
+
+		bl = &b->mBaseline[b->mBaselineCount];
+		field = SDL_strstr(line, "\"name\": \"");
+		if(field == NULL || SDL_sscanf(field, "\"name\": \"%63[^\"]\"",
+					bl->mName) != 1)
+			continue;
+
+		field = SDL_strstr(line, "\"median_ns\": ");
+		if(field == NULL || SDL_sscanf(field, "\"median_ns\": %lf",
+					&bl->mMedianNs) != 1)
+			continue;
+
+		SDL_strlcpy(bl->mProgram, program, BENCH_NAME);
+		b->mBaselineCount++;
+	}
+
+	SDL_free(text);
+
+	return 0;
+}
+
+BenchBaseline *Bench_findBaseline(Bench *b, char *name)
+{
+	int i;
+
+	for(i = 0; i < b->mBaselineCount; ++i)
+		if(SDL_strcmp(b->mBaseline[i].mProgram, b->mProgram) == 0
+				&& SDL_strcmp(b->mBaseline[i].mName, name) == 0)
+			return &b->mBaseline[i];
+
+	return NULL;
+}
+
+/*
+ * Bench_init must come first in main, before SDL has allocated anything, as
+ * that is the only time SDL's memory functions may be replaced. It takes
+ * --iterations N, --warmup N, --baseline FILE and --tolerance PERCENT from
+ * the command line.
+ */
+short Bench_init(Bench *b, char *program, int argc, char *argv[])
+{
+	int i;
+
+	SDL_memset(b, 0, sizeof(Bench));
+	b->mProgram = program;
+	b->mIterations = BENCH_ITERATIONS;
+	b->mWarmup = BENCH_WARMUP;
+	b->mTolerance = BENCH_TOLERANCE;
+
+	SDL_GetOriginalMemoryFunctions(
+			&gBenchMalloc, &gBenchCalloc, &gBenchRealloc, &gBenchFree);
+	SDL_SetMemoryFunctions(
+			Bench_sdlMalloc, Bench_sdlCalloc, Bench_sdlRealloc, gBenchFree);
+
+	for(i = 1; i + 1 < argc; i += 2) {
+		if(SDL_strcmp(argv[i], "--iterations") == 0)
+			b->mIterations = SDL_atoi(argv[i + 1]);
+		else if(SDL_strcmp(argv[i], "--warmup") == 0)
+			b->mWarmup = SDL_atoi(argv[i + 1]);
+		else if(SDL_strcmp(argv[i], "--tolerance") == 0)
+			b->mTolerance = SDL_atof(argv[i + 1]);
+		else if(SDL_strcmp(argv[i], "--baseline") == 0) {
+			if(Bench_loadBaseline(b, argv[i + 1]))
+				return -1;
+		} else
+			break;
+	}
+
+	if(i < argc || b->mIterations < 1 || b->mWarmup < 0) {
+		SDL_Log("usage: %s [--iterations N] [--warmup N]"
+				" [--baseline FILE] [--tolerance PERCENT]", argv[0]);
+		return -1;
+	}
+
+	b->mSamples = malloc(b->mIterations * sizeof(Uint64));
+	if(b->mSamples == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		return -1;
+	}
+
+	printf("{\"program\": \"%s\", \"iterations\": %d, \"warmup\": %d,\n"
+			"\"results\": [\n",
+			b->mProgram, b->mIterations, b->mWarmup);
+
+	return 0;
+}
+
+int Bench_compare(const void *a, const void *b)
+{
+	Uint64 x = *(const Uint64*)a, y = *(const Uint64*)b;
+
+	return (x > y) - (x < y);
+}
+
+/*
+ * Runs fn on data for the warmup iterations and then times each of the
+ * iterations on its own. items is how much work one iteration does, whether
+ * particles, queries or glyphs, so the rate can be given per item.
+ */
+void Bench_run(Bench *b, char *name, BenchFunc fn, void *data, double items)
+{
+	BenchBaseline *bl;
+	Uint64 start, allocs, bytes, endAllocs, endBytes;
+	double toNs, median, p95, min, max;
+	short regressed = 0;
+	int i;
+
+	for(i = 0; i < b->mWarmup; ++i)
+		fn(data);
+
+	Bench_readAllocs(&allocs, &bytes);
+	for(i = 0; i < b->mIterations; ++i) {
+		start = SDL_GetPerformanceCounter();
+		fn(data);
+		b->mSamples[i] = SDL_GetPerformanceCounter() - start;
+	}
+	Bench_readAllocs(&endAllocs, &endBytes);
+
+	SDL_qsort(b->mSamples, b->mIterations, sizeof(Uint64), Bench_compare);
+
+	toNs = 1e9 / SDL_GetPerformanceFrequency();
+	median = b->mSamples[b->mIterations / 2] * toNs;
+	p95 = b->mSamples[(b->mIterations * 95 + 99) / 100 - 1] * toNs;
+	min = b->mSamples[0] * toNs;
+	max = b->mSamples[b->mIterations - 1] * toNs;
+
+	bl = Bench_findBaseline(b, name);
+	if(bl != NULL && median > bl->mMedianNs * (1.0 + b->mTolerance / 100.0)) {
+		regressed = 1;
+		b->mRegressions++;
+	}
+
+	printf("%s{\"name\": \"%s\", \"median_ns\": %.1f, \"p95_ns\": %.1f,"
+			" \"min_ns\": %.1f, \"max_ns\": %.1f, \"items\": %.0f,"
+			" \"items_per_s\": %.1f, \"allocs\": %.2f, \"alloc_bytes\": %.1f",
+			b->mResults++ ? ",\n" : "",
+			name, median, p95, min, max, items,
+			items * 1e9 / median,
+			(double)(endAllocs - allocs) / b->mIterations,
+			(double)(endBytes - bytes) / b->mIterations);
+	if(bl != NULL)
+		printf(", \"baseline_ns\": %.1f, \"regressed\": %s",
+				bl->mMedianNs, regressed ? "true" : "false");
+	printf("}");
+	fflush(stdout);
+
+	SDL_Log("%-32s median %11.3f us  p95 %11.3f us  %14.0f items/s"
+			"  %8.2f allocs%s",
+			name, median / 1000.0, p95 / 1000.0, items * 1e9 / median,
+			(double)(endAllocs - allocs) / b->mIterations,
+			regressed ? "  REGRESSED" : "");
+}
+
+/*
+ * Closes the JSON and returns how many results regressed against the
+ * baseline, which main can hand straight back as its exit status.
+ */
+int Bench_finish(Bench *b)
+{
+	printf("\n]}\n");
+
+	free(b->mSamples);
+	free(b->mBaseline);
+	b->mSamples = NULL;
+	b->mBaseline = NULL;
+
+	if(b->mRegressions)
+		SDL_Log("%d results regressed by more than %.0f%%.",
+				b->mRegressions, b->mTolerance);
+
+	return b->mRegressions;
+}
+
+/*
+ * Benchmarks that need a renderer get SDL's dummy video driver, a hidden
+ * window and the software renderer, so they run the same on a machine with
+ * no display or GPU and are never held back by vsync.
+ */
+short Bench_createRenderer(
+			SDL_Window **window,
+			SDL_Renderer **renderer,
+			int width, int height)
+{
+	SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+
+	if(SDL_Init(SDL_INIT_VIDEO) < 0) {
+		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	*window = SDL_CreateWindow(
+					"SDL Benchmark",
+					SDL_WINDOWPOS_UNDEFINED,
+					SDL_WINDOWPOS_UNDEFINED,
+					width,
+					height,
+					SDL_WINDOW_HIDDEN);
+	if(*window == NULL) {
+		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	*renderer = SDL_CreateRenderer(*window, -1, SDL_RENDERER_SOFTWARE);
+	if(*renderer == NULL) {
+		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
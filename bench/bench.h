@@ -0,0 +1,55 @@
+/*
+ * Benchmark harness
+ *
+ * Every tutorial with a benchmark builds it with -DBENCHMARK, which swaps the
+ * demo's main for one that registers its hot loops with this harness. Each
+ * loop is run for a few warmup iterations that are thrown away and then timed
+ * one iteration at a time, so we get the median and the 95th percentile
+ * rather than an average that a single hiccup can ruin. Allocations made
+ * while the timed iterations run are counted too.
+ *
+ * The results are written to stdout as JSON, one result to a line, while the
+ * same numbers go to the log in a form meant for people. Given a baseline
+ * from an earlier run the harness also fails any result whose median has
+ * grown by more than the tolerance, which makes it a regression gate.
+ */
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <SDL2/SDL.h>
+
+#define BENCH_ITERATIONS	100
+#define BENCH_WARMUP		10
+#define BENCH_TOLERANCE		10.0
+#define BENCH_NAME		64
+#define BENCH_BASELINE		256
+
+typedef void (*BenchFunc)(void *data);
+
+typedef struct {
+	char mProgram[BENCH_NAME];
+	char mName[BENCH_NAME];
+	double mMedianNs;
+} BenchBaseline;
+
+typedef struct {
+	char *mProgram;
+	int mIterations;
+	int mWarmup;
+	double mTolerance;
+	Uint64 *mSamples;
+	int mResults;
+	int mRegressions;
+	BenchBaseline *mBaseline;
+	int mBaselineCount;
+} Bench;
+
+short Bench_init(Bench *b, char *program, int argc, char *argv[]);
+void Bench_run(Bench *b, char *name, BenchFunc fn, void *data, double items);
+int Bench_finish(Bench *b);
+short Bench_createRenderer(
+			SDL_Window **window,
+			SDL_Renderer **renderer,
+			int width, int height);
+
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Tutorial library, the window and renderer
+ */
+#include "ltut.h"
+
+#include <SDL2/SDL_image.h>
+
+SDL_Window* gWindow = NULL;
+SDL_Renderer* gRenderer = NULL;
+
+/*
+ * Starts SDL's video along with any other subsystems the tutorial asks for,
+ * opens a window of the given size with a renderer, clears to white, and
+ * starts SDL_image for PNGs. Should anything fail, what was made is left for
+ * LTut_close to take down, as every tutorial calls it on the way out.
+ */
+short LTut_init(char *title, int width, int height, Uint32 subsystems, Uint32 flags)
+{
+	Uint32 windowFlags = SDL_WINDOW_SHOWN;
+	Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+
+	if(flags & LTUT_HEADLESS) {
+		SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+		windowFlags = SDL_WINDOW_HIDDEN;
+		rendererFlags = SDL_RENDERER_SOFTWARE;
+	} else if(flags & LTUT_VSYNC)
+		rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+
+	if(SDL_Init(SDL_INIT_VIDEO | subsystems) < 0) {
+		SDL_Log("%s(), SDL_Init failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	if(flags & LTUT_LINEAR && SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "1") == 0)
+		SDL_Log("%s(), Warning: Linear texture filtering not enabled.", __func__);
+
+	gWindow = SDL_CreateWindow(
+					title,
+					SDL_WINDOWPOS_UNDEFINED,
+					SDL_WINDOWPOS_UNDEFINED,
+					width,
+					height,
+					windowFlags);
+	if(gWindow == NULL) {
+		SDL_Log("%s(), SDL_CreateWindow failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	gRenderer = SDL_CreateRenderer(gWindow, -1, rendererFlags);
+	if(gRenderer == NULL) {
+		SDL_Log("%s(), SDL_CreateRenderer failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_SetRenderDrawColor(gRenderer, 0xFF, 0xFF, 0xFF, 0xFF);
+
+	if((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) == 0) {
+		SDL_Log("%s(), IMG_Init failed. %s", __func__, IMG_GetError());
+		return -1;
+	}
+
+	return 0;
+}
+
+void LTut_close(void)
+{
+	SDL_DestroyRenderer(gRenderer);
+	SDL_DestroyWindow(gWindow);
+	gWindow = NULL;
+	gRenderer = NULL;
+
+	IMG_Quit();
+	SDL_Quit();
+}
@@ -0,0 +1,58 @@
+/*
+ * Tutorial library, the fixed timestep game loop
+ */
+#include "ltut.h"
+
+void GameLoop_init(GameLoop *gl, Uint32 tickRate, int maxCatchUp)
+{
+	SDL_memset(gl, 0, sizeof(GameLoop));
+	gl->mTickNs = 1000000000 / tickRate;
+	gl->mTickSeconds = 1.f / tickRate;
+	gl->mMaxCatchUp = maxCatchUp;
+
+	LHiresTimer_start(&gl->mTimer);
+}
+
+/*
+ * Adds the time to the accumulator and returns how many ticks to run.
+ * Advancing by mTickNs every call runs exactly one tick a call, however
+ * much real time went by, which is how a headless run goes faster than the
+ * display.
+ */
+int GameLoop_advance(GameLoop *gl, Uint64 ns)
+{
+	Uint64 ticks;
+
+	gl->mAccumulator += ns;
+	ticks = gl->mAccumulator / gl->mTickNs;
+
+	if(ticks > (Uint64)gl->mMaxCatchUp) {
+		gl->mDropped += ticks - gl->mMaxCatchUp;
+		ticks = gl->mMaxCatchUp;
+		gl->mAccumulator %= gl->mTickNs;
+	} else
+		gl->mAccumulator -= ticks * gl->mTickNs;
+
+	gl->mTicks += ticks;
+
+	return ticks;
+}
+
+/*
+ * Call at the start of every frame, then run the number of ticks it returns.
+ */
+int GameLoop_beginFrame(GameLoop *gl)
+{
+	return GameLoop_advance(gl, LHiresTimer_lap(&gl->mTimer));
+}
+
+/*
+ * How far the time now is between the last tick and the next, from 0 to 1.
+ * Rendering the state that far between where it was before the last tick and
+ * where it is now keeps movement smooth when the frame rate and the tick rate
+ * don't line up.
+ */
+float GameLoop_getAlpha(GameLoop *gl)
+{
+	return (float)gl->mAccumulator / gl->mTickNs;
+}
@@ -0,0 +1,420 @@
+/*
+ * Tutorial library, the glyph atlas
+ */
+#include "ltut_ttf.h"
+
+/*
+ * Renders the glyph for a code point in white and fills in its size and
+ * metrics, or returns NULL when the font has no such glyph.
+ *
+ * The glyph's surface is laid out as if it were a one letter string, which
+ * starts left of the pen when the glyph hangs back over the previous one;
+ * mOffsetX is how far.
+ */
+SDL_Surface *GlyphAtlas_render(GlyphAtlas *ga, Uint32 ch, Glyph *g)
+{
+	SDL_Color white = { 0xFF, 0xFF, 0xFF, 0xFF };
+	SDL_Surface *surface, *converted;
+	int minX, maxX, minY, maxY, advance;
+
+	if(!TTF_GlyphIsProvided32(ga->mFont, ch)
+			|| TTF_GlyphMetrics32(ga->mFont, ch, &minX,
+				&maxX, &minY, &maxY, &advance) < 0)
+		return NULL;
+
+	surface = TTF_RenderGlyph32_Blended(ga->mFont, ch, white);
+	if(surface == NULL)
+		return NULL;
+
+	if(surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		converted = SDL_ConvertSurfaceFormat(
+				surface, SDL_PIXELFORMAT_ARGB8888, 0);
+		SDL_FreeSurface(surface);
+		if(converted == NULL)
+			return NULL;
+		surface = converted;
+	}
+
+	SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+
+	g->mClip.w = surface->w;
+	g->mClip.h = surface->h;
+	g->mOffsetX = minX < 0 ? minX : 0;
+	g->mAdvance = advance;
+	g->mLoaded = 1;
+
+	return surface;
+}
+
+/*
+ * Puts a glyph on the current shelf, or starts a new shelf underneath it
+ * when the glyph doesn't fit in what is left of the width.
+ */
+void GlyphAtlas_place(GlyphAtlas *ga, int width, SDL_Rect *clip)
+{
+	if(ga->mPackX + clip->w > width) {
+		ga->mPackX = 0;
+		ga->mPackY += ga->mShelfH + 1;
+		ga->mShelfH = 0;
+	}
+
+	clip->x = ga->mPackX;
+	clip->y = ga->mPackY;
+	ga->mPackX += clip->w + 1;
+	if(clip->h > ga->mShelfH)
+		ga->mShelfH = clip->h;
+}
+
+/*
+ * Makes the atlas texture from the copy of its pixels in mPixels, in place
+ * of whatever texture it had before.
+ */
+short GlyphAtlas_upload(GlyphAtlas *ga)
+{
+	SDL_Texture *texture;
+
+	texture = SDL_CreateTexture(
+				gRenderer,
+				SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_STATIC,
+				ga->mPixels->w, ga->mPixels->h);
+	if(texture == NULL) {
+		SDL_Log("%s(), SDL_CreateTexture failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_UpdateTexture(texture, NULL, ga->mPixels->pixels, ga->mPixels->pitch);
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+	LTexture_free(&ga->mAtlas);
+	ga->mAtlas.mTexture = texture;
+	ga->mAtlas.mWidth = ga->mPixels->w;
+	ga->mAtlas.mHeight = ga->mPixels->h;
+
+	return 0;
+}
+
+/*
+ * Makes the atlas at least height pixels tall, doubling it if that is more,
+ * so a run of new glyphs doesn't grow it one shelf at a time. The glyphs
+ * already in the batch are flushed first, since their texture coordinates
+ * are fractions of the old height.
+ */
+short GlyphAtlas_grow(GlyphAtlas *ga, int height)
+{
+	SDL_Surface *old = ga->mPixels, *pixels;
+
+	pixels = SDL_CreateRGBSurfaceWithFormat(
+				0, old->w, SDL_max(height, old->h * 2),
+				32, SDL_PIXELFORMAT_ARGB8888);
+	if(pixels == NULL) {
+		SDL_Log("%s(), SDL_CreateRGBSurfaceWithFormat failed. %s",
+				__func__, SDL_GetError());
+		return -1;
+	}
+
+	SDL_SetSurfaceBlendMode(old, SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(old, NULL, pixels, NULL);
+
+	QuadBatch_flush(&ga->mBatch, &ga->mAtlas);
+
+	ga->mPixels = pixels;
+	if(GlyphAtlas_upload(ga)) {
+		ga->mPixels = old;
+		SDL_FreeSurface(pixels);
+		return -1;
+	}
+
+	SDL_FreeSurface(old);
+
+	return 0;
+}
+
+/*
+ * Building the atlas renders every glyph from GLYPH_FIRST to GLYPH_LAST in
+ * white, packs them onto shelves GLYPH_ATLAS_WIDTH pixels wide, and then
+ * copies them all into one texture just tall enough to hold the shelves.
+ * All the glyphs of a font are the font's height, so a shelf is simply as
+ * tall as its tallest glyph and the next one starts underneath it. Glyphs
+ * are kept a pixel apart so filtering never bleeds one into the next.
+ *
+ * The atlas keeps a copy of its pixels so that it can grow later on, when
+ * text needs glyphs past GLYPH_LAST.
+ */
+short GlyphAtlas_init(GlyphAtlas *ga, TTF_Font *font)
+{
+	SDL_Surface *surfaces[GLYPH_COUNT] = { NULL };
+	SDL_Rect dst;
+	int i, j, width = GLYPH_ATLAS_WIDTH;
+	short ret = -1;
+
+	SDL_memset(ga, 0, sizeof(GlyphAtlas));
+	ga->mFont = font;
+	ga->mHeight = TTF_FontHeight(font);
+	ga->mLineSkip = TTF_FontLineSkip(font);
+
+	for(i = 0; i < GLYPH_COUNT; ++i) {
+		surfaces[i] = GlyphAtlas_render(ga, GLYPH_FIRST + i, &ga->mGlyphs[i]);
+		if(surfaces[i] != NULL && surfaces[i]->w + 1 > width)
+			width = surfaces[i]->w + 1;
+	}
+
+	for(i = 0; i < GLYPH_COUNT; ++i)
+		if(surfaces[i] != NULL)
+			GlyphAtlas_place(ga, width, &ga->mGlyphs[i].mClip);
+
+	ga->mPixels = SDL_CreateRGBSurfaceWithFormat(
+				0, width, ga->mPackY + ga->mShelfH,
+				32, SDL_PIXELFORMAT_ARGB8888);
+	if(ga->mPixels == NULL) {
+		SDL_Log("%s(), SDL_CreateRGBSurfaceWithFormat failed. %s",
+				__func__, SDL_GetError());
+		goto done;
+	}
+
+	for(i = 0; i < GLYPH_COUNT; ++i)
+		if(surfaces[i] != NULL) {
+			dst = ga->mGlyphs[i].mClip;
+			SDL_BlitSurface(surfaces[i], NULL, ga->mPixels, &dst);
+		}
+
+	if(GlyphAtlas_upload(ga))
+		goto done;
+
+	for(i = 0; i < GLYPH_COUNT; ++i)
+		for(j = 0; j < GLYPH_COUNT; ++j)
+			ga->mKerning[i][j] = GLYPH_KERNING_UNKNOWN;
+
+	ret = QuadBatch_init(&ga->mBatch, GLYPH_BATCH_QUADS);
+done:
+	for(i = 0; i < GLYPH_COUNT; ++i)
+		SDL_FreeSurface(surfaces[i]);
+
+	return ret;
+}
+
+void GlyphAtlas_free(GlyphAtlas *ga)
+{
+	QuadBatch_free(&ga->mBatch);
+	LTexture_free(&ga->mAtlas);
+	SDL_FreeSurface(ga->mPixels);
+	ga->mPixels = NULL;
+	ga->mFont = NULL;
+}
+
+/*
+ * Adds the glyph for a code point past GLYPH_LAST, on the shelves after
+ * the rest, growing the atlas should they run out. The new glyph goes
+ * straight into the texture on its own, so nothing else is uploaded again.
+ * When the font has no glyph for it, or it can't be fitted in, the glyph
+ * is left not loaded.
+ */
+void GlyphAtlas_add(GlyphAtlas *ga, Glyph *g, Uint32 ch)
+{
+	SDL_Surface *surface;
+	SDL_Rect dst;
+
+	surface = GlyphAtlas_render(ga, ch, g);
+	if(surface == NULL)
+		return;
+
+	g->mLoaded = 0;
+
+	if(surface->w > ga->mPixels->w)
+		goto done;
+
+	GlyphAtlas_place(ga, ga->mPixels->w, &g->mClip);
+	if(g->mClip.y + g->mClip.h > ga->mPixels->h
+			&& GlyphAtlas_grow(ga, g->mClip.y + g->mClip.h))
+		goto done;
+
+	dst = g->mClip;
+	SDL_BlitSurface(surface, NULL, ga->mPixels, &dst);
+	SDL_UpdateTexture(
+			ga->mAtlas.mTexture,
+			&g->mClip,
+			surface->pixels,
+			surface->pitch);
+
+	g->mLoaded = 1;
+done:
+	SDL_FreeSurface(surface);
+}
+
+/*
+ * Returns the glyph for a code point. Glyphs past GLYPH_LAST are looked up
+ * in mExtra, a small hash table probed from the code point onwards, and
+ * added the first time they are asked for. A code point with no glyph, or
+ * one that finds the table full, is drawn as a question mark instead and ch
+ * is changed to match, so kerning is worked out for what is drawn.
+ */
+Glyph *GlyphAtlas_glyph(GlyphAtlas *ga, int *ch)
+{
+	GlyphExtra *e;
+	int i;
+
+	if(*ch <= GLYPH_LAST)
+		return &ga->mGlyphs[*ch - GLYPH_FIRST];
+
+	i = *ch % GLYPH_EXTRA_SLOTS;
+	while(ga->mExtra[i].mCode != 0 && ga->mExtra[i].mCode != (Uint32)*ch)
+		i = (i + 1) % GLYPH_EXTRA_SLOTS;
+	e = &ga->mExtra[i];
+
+	if(e->mCode == 0) {
+		if(ga->mExtraCount == GLYPH_EXTRA_SLOTS - 1)
+			goto missing;
+
+		e->mCode = *ch;
+		ga->mExtraCount++;
+		GlyphAtlas_add(ga, &e->mGlyph, *ch);
+	}
+
+	if(e->mGlyph.mLoaded)
+		return &e->mGlyph;
+missing:
+	*ch = '?';
+	return &ga->mGlyphs['?' - GLYPH_FIRST];
+}
+
+/*
+ * Reads the next character of a UTF-8 string, one to four bytes long, and
+ * moves past it. Bytes that aren't valid UTF-8, and control characters,
+ * come back as a question mark.
+ */
+int GlyphAtlas_next(char **text)
+{
+	static const int least[4] = { 0, 0x80, 0x800, 0x10000 };
+	Uint8 *s = (Uint8*)*text;
+	int ch, n, i;
+
+	if(s[0] < 0x80) {
+		ch = s[0];
+		n = 0;
+	} else if((s[0] & 0xE0) == 0xC0) {
+		ch = s[0] & 0x1F;
+		n = 1;
+	} else if((s[0] & 0xF0) == 0xE0) {
+		ch = s[0] & 0x0F;
+		n = 2;
+	} else if((s[0] & 0xF8) == 0xF0) {
+		ch = s[0] & 0x07;
+		n = 3;
+	} else
+		goto invalid;
+
+	for(i = 1; i <= n; ++i) {
+		if((s[i] & 0xC0) != 0x80)
+			goto invalid;
+		ch = ch << 6 | (s[i] & 0x3F);
+	}
+
+	*text += n + 1;
+
+	if(ch < least[n] || ch > 0x10FFFF || (ch >= 0xD800 && ch <= 0xDFFF)
+			|| ch < GLYPH_FIRST)
+		ch = '?';
+
+	return ch;
+invalid:
+	*text += 1;
+	while((**text & 0xC0) == 0x80)
+		*text += 1;
+
+	return '?';
+}
+
+/*
+ * Kerning between two glyphs up to GLYPH_LAST is remembered in mKerning;
+ * anything past that is asked of the font every time.
+ */
+int GlyphAtlas_kerning(GlyphAtlas *ga, int prev, int ch)
+{
+	Sint16 *k;
+
+	if(prev == 0)
+		return 0;
+
+	if(prev > GLYPH_LAST || ch > GLYPH_LAST)
+		return TTF_GetFontKerningSizeGlyphs32(ga->mFont, prev, ch);
+
+	k = &ga->mKerning[prev - GLYPH_FIRST][ch - GLYPH_FIRST];
+	if(*k == GLYPH_KERNING_UNKNOWN)
+		*k = TTF_GetFontKerningSizeGlyphs32(ga->mFont, prev, ch);
+
+	return *k;
+}
+
+/*
+ * Measuring walks the string exactly as drawing does, without drawing, so
+ * text can be placed before it is drawn.
+ */
+void GlyphAtlas_measure(GlyphAtlas *ga, char *text, int *w, int *h)
+{
+	Glyph *g;
+	int penX = 0, lines = 1, prev = 0, ch;
+
+	*w = 0;
+
+	while(*text != '\0') {
+		if(*text == '\n') {
+			++text;
+			penX = 0;
+			prev = 0;
+			++lines;
+			continue;
+		}
+
+		ch = GlyphAtlas_next(&text);
+		g = GlyphAtlas_glyph(ga, &ch);
+		penX += GlyphAtlas_kerning(ga, prev, ch) + g->mAdvance;
+		prev = ch;
+
+		if(penX > *w)
+			*w = penX;
+	}
+
+	*h = (lines - 1) * ga->mLineSkip + ga->mHeight;
+}
+
+/*
+ * Drawing lays the string out glyph by glyph into the atlas's batch. Nothing
+ * is rasterised and no texture is made, however often the text changes; it
+ * all reaches the screen when the atlas is flushed. The only exception is
+ * the first time a glyph past GLYPH_LAST is drawn, when it is added.
+ */
+void GlyphAtlas_draw(GlyphAtlas *ga, int x, int y, char *text, SDL_Color color)
+{
+	Glyph *g;
+	int penX = x, penY = y, prev = 0, ch;
+
+	while(*text != '\0') {
+		if(*text == '\n') {
+			++text;
+			penX = x;
+			penY += ga->mLineSkip;
+			prev = 0;
+			continue;
+		}
+
+		ch = GlyphAtlas_next(&text);
+		g = GlyphAtlas_glyph(ga, &ch);
+		penX += GlyphAtlas_kerning(ga, prev, ch);
+
+		if(g->mLoaded && ch != ' ')
+			QuadBatch_addQuad(
+					&ga->mBatch,
+					&ga->mAtlas,
+					&g->mClip,
+					penX + g->mOffsetX, penY,
+					color);
+
+		penX += g->mAdvance;
+		prev = ch;
+	}
+}
+
+void GlyphAtlas_flush(GlyphAtlas *ga)
+{
+	QuadBatch_flush(&ga->mBatch, &ga->mAtlas);
+}
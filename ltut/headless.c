@@ -0,0 +1,81 @@
+/*
+ * Tutorial library, headless runs
+ */
+#include "ltut.h"
+
+/*
+ * Takes --headless TICKS and --no-render out of the command line, leaving the
+ * rest of it as the demo expects it, and returns the new argc, or -1 should
+ * the options make no sense.
+ */
+int Headless_parseArgs(Headless *h, int argc, char *argv[])
+{
+	int i, n = 1;
+
+	for(i = 1; i < argc; ++i) {
+		if(SDL_strcmp(argv[i], "--headless") == 0) {
+			if(i + 1 == argc || (h->mTicks = SDL_atoi(argv[++i])) <= 0) {
+				SDL_Log("%s(), --headless needs a number of ticks.", __func__);
+				return -1;
+			}
+		} else if(SDL_strcmp(argv[i], "--no-render") == 0)
+			h->mRender = 0;
+		else
+			argv[n++] = argv[i];
+	}
+	argv[n] = NULL;
+
+	if(!h->mRender && h->mTicks == 0) {
+		SDL_Log("%s(), --no-render needs --headless.", __func__);
+		return -1;
+	}
+
+	return n;
+}
+
+/*
+ * The scripted input drives the dot right, down, left and up in turn,
+ * turning every turn ticks.
+ */
+void Headless_steer(int tick, int turn, int vel, int *velX, int *velY)
+{
+	static const int turns[4][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
+	int t = (tick / turn) % 4;
+
+	*velX = turns[t][0] * vel;
+	*velY = turns[t][1] * vel;
+}
+
+/*
+ * FNV-1a, folded over whatever state the demo wants to vouch for, starting
+ * from HEADLESS_HASH.
+ */
+Uint32 Headless_hash(Uint32 hash, const void *data, size_t size)
+{
+	const Uint8 *p = data;
+
+	while(size--) {
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+void Headless_start(Headless *h)
+{
+	h->mStart = SDL_GetPerformanceCounter();
+}
+
+void Headless_report(Headless *h, Uint32 hash)
+{
+	double seconds = (double)(SDL_GetPerformanceCounter() - h->mStart)
+					/ SDL_GetPerformanceFrequency();
+
+	SDL_Log("Headless: %d ticks%s in %.3f s, %.0f ticks per second, state %08x.",
+			h->mTicks,
+			h->mRender ? "" : " without rendering",
+			seconds,
+			h->mTicks / seconds,
+			hash);
+}
@@ -0,0 +1,107 @@
+/*
+ * Tutorial library, the high resolution timer
+ */
+#include "ltut.h"
+
+/*
+ * The high resolution timer has the same start, stop, pause and unpause as
+ * the timer from the advanced timers tutorial, only it counts with
+ * SDL_GetPerformanceCounter instead of SDL_GetTicks. SDL_GetTicks only counts
+ * whole milliseconds, and at 144 frames a second a frame is less than 7 of
+ * them, so a frame time read from it can be out by one part in seven. The
+ * performance counter usually counts in nanoseconds or close to it.
+ *
+ * The counter runs at SDL_GetPerformanceFrequency counts a second, so the
+ * time is counts / frequency seconds. Multiplying the counts by a billion
+ * first would overflow after a few seconds, so the whole seconds and the
+ * remainder are converted separately.
+ */
+Uint64 LHiresTimer_countsToNanoseconds(Uint64 counts)
+{
+	Uint64 frequency = SDL_GetPerformanceFrequency();
+
+	return counts / frequency * 1000000000
+		+ counts % frequency * 1000000000 / frequency;
+}
+
+void LHiresTimer_init(LHiresTimer *ht)
+{
+	ht->mStartCount = 0;
+	ht->mPausedCount = 0;
+	ht->mPaused = 0;
+	ht->mStarted = 0;
+}
+
+void LHiresTimer_start(LHiresTimer *ht)
+{
+	ht->mStarted = 1;
+	ht->mPaused = 0;
+	ht->mStartCount = SDL_GetPerformanceCounter();
+	ht->mPausedCount = 0;
+}
+
+void LHiresTimer_stop(LHiresTimer *ht)
+{
+	ht->mStarted = 0;
+	ht->mPaused = 0;
+	ht->mStartCount = 0;
+	ht->mPausedCount = 0;
+}
+
+void LHiresTimer_pause(LHiresTimer *ht)
+{
+	if(ht->mStarted && !ht->mPaused) {
+		ht->mPaused = 1;
+		ht->mPausedCount = SDL_GetPerformanceCounter() - ht->mStartCount;
+		ht->mStartCount = 0;
+	}
+}
+
+void LHiresTimer_unpause(LHiresTimer *ht)
+{
+	if(ht->mStarted && ht->mPaused) {
+		ht->mPaused = 0;
+		ht->mStartCount = SDL_GetPerformanceCounter() - ht->mPausedCount;
+		ht->mPausedCount = 0;
+	}
+}
+
+Uint64 LHiresTimer_getNanoseconds(LHiresTimer *ht)
+{
+	if(ht->mStarted) {
+		if(ht->mPaused)
+			return LHiresTimer_countsToNanoseconds(ht->mPausedCount);
+		else
+			return LHiresTimer_countsToNanoseconds(
+				SDL_GetPerformanceCounter() - ht->mStartCount);
+	}
+	return 0;
+}
+
+/*
+ * For when a timer is only needed to time one frame after another, lap
+ * returns the time since the timer started and starts it again, reading the
+ * counter once so no time falls between the two.
+ */
+Uint64 LHiresTimer_lap(LHiresTimer *ht)
+{
+	Uint64 now = SDL_GetPerformanceCounter();
+	Uint64 counts = ht->mStarted && !ht->mPaused ? now - ht->mStartCount : 0;
+
+	ht->mStarted = 1;
+	ht->mPaused = 0;
+	ht->mStartCount = now;
+	ht->mPausedCount = 0;
+
+	return LHiresTimer_countsToNanoseconds(counts);
+}
+
+short LHiresTimer_isStarted(LHiresTimer *ht)
+{
+	return ht->mStarted;
+}
+
+short LHiresTimer_isPaused(LHiresTimer *ht)
+{
+	return ht->mPaused && ht->mStarted;
+}
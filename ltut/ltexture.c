@@ -0,0 +1,209 @@
+/*
+ * Tutorial library, the texture wrapper
+ */
+#include "ltut.h"
+
+#include <SDL2/SDL_image.h>
+
+void LTexture_free(LTexture *lt)
+{
+	if(lt->mTexture != NULL) {
+		SDL_DestroyTexture(lt->mTexture);
+		lt->mTexture = NULL;
+		lt->mWidth = 0;
+		lt->mHeight = 0;
+		lt->mPixels = NULL;
+		lt->mPitch = 0;
+	}
+}
+
+/*
+ * Loads an image with cyan as its colour key, as the tutorials' images are
+ * drawn with a cyan background.
+ */
+short LTexture_loadFromFile(LTexture *lt, char *path)
+{
+	SDL_Color cyan = { 0x00, 0xFF, 0xFF, 0xFF };
+
+	return LTexture_loadFromFileKeyed(lt, path, &cyan);
+}
+
+/*
+ * Loads an image making the key colour transparent, or keeping every pixel
+ * when the key is NULL.
+ */
+short LTexture_loadFromFileKeyed(LTexture *lt, char *path, SDL_Color *key)
+{
+	SDL_Surface* loadedSurface;
+	short ret;
+
+	LTexture_free(lt);
+
+	loadedSurface = IMG_Load(path);
+	if(loadedSurface == NULL) {
+		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
+		return -1;
+	}
+
+	ret = LTexture_loadFromSurface(lt, loadedSurface, key);
+
+	SDL_FreeSurface(loadedSurface);
+
+	return ret;
+}
+
+/*
+ * Makes the texture from an image already decoded, which is left to the
+ * caller to free.
+ *
+ * Some of the tutorials made a streaming texture, copied the image into it,
+ * and then went over every pixel looking for the key. Here the key is set on
+ * the surface instead and SDL_CreateTextureFromSurface does the rest: it
+ * picks a format the renderer takes as it is, turns the key into alpha while
+ * converting to it, and uploads the pixels once to a static texture, which
+ * needs no copy of its pixels kept around to be locked later.
+ */
+short LTexture_loadFromSurface(LTexture *lt, SDL_Surface *surface, SDL_Color *key)
+{
+	SDL_Texture* newTexture;
+
+	LTexture_free(lt);
+
+	if(key != NULL)
+		SDL_SetColorKey(
+				surface,
+				SDL_TRUE,
+				SDL_MapRGB(surface->format, key->r, key->g, key->b));
+
+	newTexture = SDL_CreateTextureFromSurface(gRenderer, surface);
+	if(newTexture == NULL) {
+		SDL_Log("%s(), SDL_CreateTextureFromSurface failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	lt->mTexture = newTexture;
+	lt->mWidth = surface->w;
+	lt->mHeight = surface->h;
+
+	return 0;
+}
+
+short LTexture_createBlank(
+			LTexture *lt,
+			int width, int height,
+			SDL_TextureAccess access)
+{
+	LTexture_free(lt);
+
+	lt->mTexture = SDL_CreateTexture(
+						gRenderer,
+						SDL_PIXELFORMAT_RGBA8888,
+						access,
+						width,
+						height);
+	if(lt->mTexture == NULL) {
+		SDL_Log("%s(), SDL_CreateTexture failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	lt->mWidth = width;
+	lt->mHeight = height;
+
+	return 0;
+}
+
+short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip)
+{
+	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+
+	if(clip != NULL) {
+		renderQuad.w = clip->w;
+		renderQuad.h = clip->h;
+	}
+
+	return SDL_RenderCopy(gRenderer, lt->mTexture, clip, &renderQuad);
+}
+
+/*
+ * Rotating or flipping costs more than a plain copy in some renderers, so
+ * when there is neither the plain copy is used.
+ */
+short LTexture_renderEx(
+			LTexture *lt,
+			int x, int y,
+			SDL_Rect* clip,
+			double angle,
+			SDL_Point* center,
+			SDL_RendererFlip flip)
+{
+	SDL_Rect renderQuad = { x, y, lt->mWidth, lt->mHeight };
+
+	if(angle == 0.0 && flip == SDL_FLIP_NONE)
+		return LTexture_render(lt, x, y, clip);
+
+	if(clip != NULL) {
+		renderQuad.w = clip->w;
+		renderQuad.h = clip->h;
+	}
+
+	return SDL_RenderCopyEx(gRenderer, lt->mTexture, clip,
+				&renderQuad, angle, center, flip);
+}
+
+void LTexture_setColor(LTexture *lt, Uint8 red, Uint8 green, Uint8 blue)
+{
+	SDL_SetTextureColorMod(lt->mTexture, red, green, blue);
+}
+
+void LTexture_setBlendMode(LTexture *lt, SDL_BlendMode blending)
+{
+	SDL_SetTextureBlendMode(lt->mTexture, blending);
+}
+
+void LTexture_setAlpha(LTexture *lt, Uint8 alpha)
+{
+	SDL_SetTextureAlphaMod(lt->mTexture, alpha);
+}
+
+short LTexture_setAsRenderTarget(LTexture *lt)
+{
+	if(SDL_SetRenderTarget(gRenderer, lt->mTexture) < 0) {
+		SDL_Log("%s(), SDL_SetRenderTarget failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Only textures made with SDL_TEXTUREACCESS_STREAMING can be locked. While
+ * locked, mPixels and mPitch give the texture's pixels.
+ */
+short LTexture_lockTexture(LTexture *lt)
+{
+	if(lt->mPixels != NULL) {
+		SDL_Log("%s(), Texture already locked.", __func__);
+		return -1;
+	}
+
+	if(SDL_LockTexture(lt->mTexture, NULL, &lt->mPixels, &lt->mPitch) != 0) {
+		SDL_Log("%s(), SDL_LockTexture failed. %s", __func__, SDL_GetError());
+		return -1;
+	}
+
+	return 0;
+}
+
+short LTexture_unlockTexture(LTexture *lt)
+{
+	if(lt->mPixels == NULL) {
+		SDL_Log("%s(), Texture not locked.", __func__);
+		return -1;
+	}
+
+	SDL_UnlockTexture(lt->mTexture);
+	lt->mPixels = NULL;
+	lt->mPitch = 0;
+
+	return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Tutorial library
+ *
+ * Nearly every tutorial opens a window, gives it a renderer, starts
+ * SDL_image, and then loads and renders its pictures through an LTexture,
+ * each with its own copy of the same code. The tutorials that are about
+ * something else, timers, threads or moving a dot around, take that code from
+ * here instead, so it is written, and made fast, only once.
+ *
+ * The window and renderer are the library's, gWindow and gRenderer, just as
+ * the tutorials have always called them. LTut_init makes them and LTut_close
+ * takes them down along with SDL.
+ *
+ * The quad batch, the high resolution timer, the fixed timestep game loop and
+ * the headless run helpers began in single tutorials but are of use to
+ * several, so they live here now as well.
+ */
+#ifndef LTUT_H
+#define LTUT_H
+
+#include <SDL2/SDL.h>
+
+/*
+ * Flags for LTut_init. LTUT_VSYNC presents in step with the display,
+ * LTUT_LINEAR asks for linear filtering when textures are scaled, and
+ * LTUT_HEADLESS runs on SDL's dummy video driver with a hidden window and the
+ * software renderer, so the program needs neither display nor GPU.
+ */
+#define LTUT_VSYNC	0x01
+#define LTUT_LINEAR	0x02
+#define LTUT_HEADLESS	0x04
+
+/*
+ * Headless runs
+ *
+ * Run with --headless TICKS a demo needs no display and waits for nothing.
+ * It opens with LTUT_HEADLESS and draws without vsync, so it runs as fast as
+ * it can on a machine with no GPU at all. Input comes from a script instead
+ * of the keyboard, so two runs do exactly the same work; the state hash the
+ * demo prints at the end, folded from HEADLESS_HASH, shows that they did.
+ * Add --no-render to time the simulation alone.
+ */
+#define HEADLESS_HASH	2166136261u
+
+typedef struct {
+	int mTicks;
+	short mRender;
+	Uint64 mStart;
+} Headless;
+
+typedef struct {
+	SDL_Texture* mTexture;
+	void* mPixels;
+	int mPitch;
+	int mWidth;
+	int mHeight;
+} LTexture;
+
+/*
+ * The texture cache shares one texture between everything that loads the
+ * same image with the same colour key, rather than decoding and uploading it
+ * again for each. Each texture counts its users and goes when the last of
+ * them lets it go. A shared texture is shared in full, so anything that sets
+ * its colour, alpha or blend mode sets it for every user.
+ *
+ * Along the way the cache keeps the time spent decoding images and uploading
+ * them, and an estimate of how much texture memory they take.
+ */
+typedef struct LTextureEntry {
+	LTexture mTexture;
+	char *mPath;
+	SDL_Color mKey;
+	short mKeyed;
+	int mRefs;
+	size_t mBytes;
+	struct LTextureEntry *mNext;
+} LTextureEntry;
+
+typedef struct {
+	LTextureEntry *mEntries;
+	int mCount;
+	int mLoads;
+	int mHits;
+	size_t mBytes;
+	size_t mPeakBytes;
+	Uint64 mDecodeNs;
+	Uint64 mUploadNs;
+} LTextureCache;
+
+/*
+ * A quad batch collects textured quads from a single atlas into one vertex
+ * and index buffer so they can all be drawn with one call to
+ * SDL_RenderGeometry. Every quad is four vertices and two triangles; since
+ * the triangles always index their quad's vertices the same way, the index
+ * buffer is filled once when the batch is created and never touched again.
+ * mDrawCalls counts the flushes that drew anything, for the tutorials that
+ * report how many draw calls a frame took.
+ */
+typedef struct {
+	SDL_Vertex *mVertices;
+	int *mIndices;
+	int mQuads;
+	int mCapacity;
+	int mDrawCalls;
+} QuadBatch;
+
+/*
+ * The high resolution timer counts with SDL_GetPerformanceCounter rather
+ * than in whole milliseconds, and hands out nanoseconds.
+ */
+typedef struct {
+	Uint64 mStartCount;
+	Uint64 mPausedCount;
+	short mPaused;
+	short mStarted;
+} LHiresTimer;
+
+/*
+ * The game loop runs a simulation in fixed ticks of tickRate a second,
+ * whatever the frame rate. Each frame the time since the last frame, lapped
+ * off mTimer, goes into an accumulator, and the simulation runs a tick for
+ * every whole tick's worth of time in it. What's left over, less than a tick,
+ * stays in the accumulator for next frame.
+ *
+ * A frame that took very long, say because the window was being dragged,
+ * would leave so many ticks to run that the next frame takes even longer, and
+ * so on. So no more than mMaxCatchUp ticks are run in one frame and any time
+ * past that is dropped; the simulation slows down instead. mDropped counts
+ * the ticks dropped so far.
+ */
+typedef struct {
+	LHiresTimer mTimer;
+	Uint64 mTickNs;
+	Uint64 mAccumulator;
+	Uint64 mTicks;
+	Uint64 mDropped;
+	float mTickSeconds;
+	int mMaxCatchUp;
+} GameLoop;
+
+extern SDL_Window* gWindow;
+extern SDL_Renderer* gRenderer;
+
+short LTut_init(char *title, int width, int height, Uint32 subsystems, Uint32 flags);
+void LTut_close(void);
+
+int Headless_parseArgs(Headless *h, int argc, char *argv[]);
+void Headless_steer(int tick, int turn, int vel, int *velX, int *velY);
+Uint32 Headless_hash(Uint32 hash, const void *data, size_t size);
+void Headless_start(Headless *h);
+void Headless_report(Headless *h, Uint32 hash);
+
+void LTexture_free(LTexture *lt);
+short LTexture_loadFromFile(LTexture *lt, char *path);
+short LTexture_loadFromFileKeyed(LTexture *lt, char *path, SDL_Color *key);
+short LTexture_loadFromSurface(LTexture *lt, SDL_Surface *surface, SDL_Color *key);
+short LTexture_createBlank(
+			LTexture *lt,
+			int width, int height,
+			SDL_TextureAccess access);
+short LTexture_render(LTexture *lt, int x, int y, SDL_Rect* clip);
+short LTexture_renderEx(
+			LTexture *lt,
+			int x, int y,
+			SDL_Rect* clip,
+			double angle,
+			SDL_Point* center,
+			SDL_RendererFlip flip);
+void LTexture_setColor(LTexture *lt, Uint8 red, Uint8 green, Uint8 blue);
+void LTexture_setBlendMode(LTexture *lt, SDL_BlendMode blending);
+void LTexture_setAlpha(LTexture *lt, Uint8 alpha);
+short LTexture_setAsRenderTarget(LTexture *lt);
+short LTexture_lockTexture(LTexture *lt);
+short LTexture_unlockTexture(LTexture *lt);
+
+void LTextureCache_init(LTextureCache *tc);
+LTexture *LTextureCache_load(LTextureCache *tc, char *path);
+LTexture *LTextureCache_loadKeyed(LTextureCache *tc, char *path, SDL_Color *key);
+void LTextureCache_release(LTextureCache *tc, LTexture *lt);
+void LTextureCache_free(LTextureCache *tc);
+void LTextureCache_report(LTextureCache *tc);
+
+short QuadBatch_init(QuadBatch *qb, int capacity);
+void QuadBatch_free(QuadBatch *qb);
+void QuadBatch_flush(QuadBatch *qb, LTexture *atlas);
+void Quad_set(
+			SDL_Vertex *v,
+			LTexture *atlas,
+			SDL_Rect *clip,
+			float x, float y,
+			SDL_Color color);
+void QuadBatch_addQuad(
+			QuadBatch *qb,
+			LTexture *atlas,
+			SDL_Rect *clip,
+			float x, float y,
+			SDL_Color color);
+void QuadBatch_addQuads(
+			QuadBatch *qb,
+			LTexture *atlas,
+			SDL_Vertex *quads,
+			int count,
+			float x, float y);
+
+Uint64 LHiresTimer_countsToNanoseconds(Uint64 counts);
+void LHiresTimer_init(LHiresTimer *ht);
+void LHiresTimer_start(LHiresTimer *ht);
+void LHiresTimer_stop(LHiresTimer *ht);
+void LHiresTimer_pause(LHiresTimer *ht);
+void LHiresTimer_unpause(LHiresTimer *ht);
+Uint64 LHiresTimer_getNanoseconds(LHiresTimer *ht);
+Uint64 LHiresTimer_lap(LHiresTimer *ht);
+short LHiresTimer_isStarted(LHiresTimer *ht);
+short LHiresTimer_isPaused(LHiresTimer *ht);
+
+void GameLoop_init(GameLoop *gl, Uint32 tickRate, int maxCatchUp);
+int GameLoop_advance(GameLoop *gl, Uint64 ns);
+int GameLoop_beginFrame(GameLoop *gl);
+float GameLoop_getAlpha(GameLoop *gl);
+
+#endif
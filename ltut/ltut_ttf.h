@@ -0,0 +1,72 @@
+/*
+ * Tutorial library, text
+ *
+ * The glyph atlas draws text with SDL_ttf, which most of the tutorials have
+ * no use for. So it is built into a library of its own, libltut_ttf.a, with
+ * this header, and only the tutorials that draw text need SDL_ttf to build.
+ * They link it ahead of libltut.a, which it is built on.
+ */
+#ifndef LTUT_TTF_H
+#define LTUT_TTF_H
+
+#include <SDL2/SDL_ttf.h>
+
+#include "ltut.h"
+
+#define GLYPH_FIRST		32
+#define GLYPH_LAST		255
+#define GLYPH_COUNT		(GLYPH_LAST - GLYPH_FIRST + 1)
+#define GLYPH_ATLAS_WIDTH	512
+#define GLYPH_BATCH_QUADS	1024
+#define GLYPH_KERNING_UNKNOWN	-32768
+#define GLYPH_EXTRA_SLOTS	256
+
+/*
+ * The glyph atlas holds every glyph of a font in one texture. Each glyph has
+ * its place in the atlas, how far left of the pen it starts, and how far the
+ * pen moves after it. Kerning between two glyphs is asked of the font the
+ * first time the pair is drawn and remembered after that.
+ *
+ * The glyphs up to GLYPH_LAST are made up front. Any other glyph is added to
+ * the atlas the first time it is drawn and kept in mExtra, which holds up to
+ * GLYPH_EXTRA_SLOTS - 1 of them; mPixels keeps a copy of the atlas so it can
+ * grow taller when they need the room, and mPackX, mPackY and mShelfH are
+ * where the next glyph goes.
+ */
+typedef struct {
+	SDL_Rect mClip;
+	int mOffsetX;
+	int mAdvance;
+	short mLoaded;
+} Glyph;
+
+typedef struct {
+	Uint32 mCode;
+	Glyph mGlyph;
+} GlyphExtra;
+
+typedef struct {
+	TTF_Font *mFont;
+	LTexture mAtlas;
+	SDL_Surface *mPixels;
+	Glyph mGlyphs[GLYPH_COUNT];
+	GlyphExtra mExtra[GLYPH_EXTRA_SLOTS];
+	int mExtraCount;
+	int mPackX;
+	int mPackY;
+	int mShelfH;
+	Sint16 mKerning[GLYPH_COUNT][GLYPH_COUNT];
+	int mHeight;
+	int mLineSkip;
+	QuadBatch mBatch;
+} GlyphAtlas;
+
+short GlyphAtlas_init(GlyphAtlas *ga, TTF_Font *font);
+void GlyphAtlas_free(GlyphAtlas *ga);
+int GlyphAtlas_next(char **text);
+int GlyphAtlas_kerning(GlyphAtlas *ga, int prev, int ch);
+void GlyphAtlas_measure(GlyphAtlas *ga, char *text, int *w, int *h);
+void GlyphAtlas_draw(GlyphAtlas *ga, int x, int y, char *text, SDL_Color color);
+void GlyphAtlas_flush(GlyphAtlas *ga);
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Tutorial library, the quad batch
+ */
+#include "ltut.h"
+
+#include <stdlib.h>
+
+/*
+ * The batch allocates room for capacity quads up front and writes the index
+ * buffer once: quad q is drawn as the triangles (0, 1, 2) and (2, 3, 0) of
+ * its four vertices.
+ */
+short QuadBatch_init(QuadBatch *qb, int capacity)
+{
+	int q;
+
+	qb->mVertices = malloc(capacity * 4 * sizeof(SDL_Vertex));
+	qb->mIndices = malloc(capacity * 6 * sizeof(int));
+	if(qb->mVertices == NULL || qb->mIndices == NULL) {
+		SDL_Log("%s(), malloc failed.", __func__);
+		free(qb->mVertices);
+		free(qb->mIndices);
+		qb->mVertices = NULL;
+		qb->mIndices = NULL;
+		return -1;
+	}
+
+	for(q = 0; q < capacity; ++q) {
+		qb->mIndices[q * 6 + 0] = q * 4 + 0;
+		qb->mIndices[q * 6 + 1] = q * 4 + 1;
+		qb->mIndices[q * 6 + 2] = q * 4 + 2;
+		qb->mIndices[q * 6 + 3] = q * 4 + 2;
+		qb->mIndices[q * 6 + 4] = q * 4 + 3;
+		qb->mIndices[q * 6 + 5] = q * 4 + 0;
+	}
+
+	qb->mQuads = 0;
+	qb->mCapacity = capacity;
+	qb->mDrawCalls = 0;
+
+	return 0;
+}
+
+void QuadBatch_free(QuadBatch *qb)
+{
+	free(qb->mVertices);
+	free(qb->mIndices);
+	qb->mVertices = NULL;
+	qb->mIndices = NULL;
+	qb->mQuads = 0;
+	qb->mCapacity = 0;
+}
+
+/*
+ * Sends every quad in the batch to the renderer with a single call and
+ * empties the batch. Everything in one batch shares the atlas texture and
+ * its blend mode, so quads that need a different blend mode need a batch of
+ * their own.
+ */
+void QuadBatch_flush(QuadBatch *qb, LTexture *atlas)
+{
+	if(qb->mQuads == 0)
+		return;
+
+	SDL_RenderGeometry(
+			gRenderer,
+			atlas->mTexture,
+			qb->mVertices,
+			qb->mQuads * 4,
+			qb->mIndices,
+			qb->mQuads * 6);
+
+	qb->mQuads = 0;
+	qb->mDrawCalls++;
+}
+
+/*
+ * Fills in the four vertices of a quad showing the clip of the atlas at the
+ * given position, tinted by the colour. The texture coordinates are the
+ * clip's corners scaled into the 0 to 1 range.
+ */
+void Quad_set(
+			SDL_Vertex *v,
+			LTexture *atlas,
+			SDL_Rect *clip,
+			float x, float y,
+			SDL_Color color)
+{
+	float u0, v0, u1, v1;
+
+	u0 = (float)clip->x / atlas->mWidth;
+	v0 = (float)clip->y / atlas->mHeight;
+	u1 = (float)(clip->x + clip->w) / atlas->mWidth;
+	v1 = (float)(clip->y + clip->h) / atlas->mHeight;
+
+	v[0].position.x = x;
+	v[0].position.y = y;
+	v[0].tex_coord.x = u0;
+	v[0].tex_coord.y = v0;
+
+	v[1].position.x = x + clip->w;
+	v[1].position.y = y;
+	v[1].tex_coord.x = u1;
+	v[1].tex_coord.y = v0;
+
+	v[2].position.x = x + clip->w;
+	v[2].position.y = y + clip->h;
+	v[2].tex_coord.x = u1;
+	v[2].tex_coord.y = v1;
+
+	v[3].position.x = x;
+	v[3].position.y = y + clip->h;
+	v[3].tex_coord.x = u0;
+	v[3].tex_coord.y = v1;
+
+	v[0].color = v[1].color = v[2].color = v[3].color = color;
+}
+
+/*
+ * Adds a quad showing the clip of the atlas at x, y, tinted by the colour.
+ * The batch is flushed first should it be full, so adding never fails.
+ */
+void QuadBatch_addQuad(
+			QuadBatch *qb,
+			LTexture *atlas,
+			SDL_Rect *clip,
+			float x, float y,
+			SDL_Color color)
+{
+	if(qb->mQuads == qb->mCapacity)
+		QuadBatch_flush(qb, atlas);
+
+	Quad_set(&qb->mVertices[qb->mQuads++ * 4], atlas, clip, x, y, color);
+}
+
+/*
+ * Copies quads that were laid out ahead of time into the batch, moved over
+ * by x, y. Should the batch fill up it is flushed and the copy carries on,
+ * so adding never fails.
+ */
+void QuadBatch_addQuads(
+			QuadBatch *qb,
+			LTexture *atlas,
+			SDL_Vertex *quads,
+			int count,
+			float x, float y)
+{
+	SDL_Vertex *v;
+	int n, i;
+
+	while(count > 0) {
+		if(qb->mQuads == qb->mCapacity)
+			QuadBatch_flush(qb, atlas);
+
+		n = SDL_min(count, qb->mCapacity - qb->mQuads);
+		v = &qb->mVertices[qb->mQuads * 4];
+
+		for(i = 0; i < n * 4; ++i) {
+			v[i] = quads[i];
+			v[i].position.x += x;
+			v[i].position.y += y;
+		}
+
+		qb->mQuads += n;
+		quads += n * 4;
+		count -= n;
+	}
+}
@@ -0,0 +1,193 @@
+/*
+ * Tutorial library, the texture cache
+ */
+#include "ltut.h"
+
+#include <stdlib.h>
+#include <SDL2/SDL_image.h>
+
+void LTextureCache_init(LTextureCache *tc)
+{
+	SDL_memset(tc, 0, sizeof(LTextureCache));
+}
+
+Uint64 LTextureCache_elapsedNs(Uint64 start)
+{
+	return (Uint64)((SDL_GetPerformanceCounter() - start) * 1e9
+			/ SDL_GetPerformanceFrequency());
+}
+
+/*
+ * Estimates the memory a texture takes on the GPU from its size and the
+ * format the renderer gave it. Drivers may pad or compress, so this is only
+ * an estimate, but it tracks what the scene asks of the GPU.
+ */
+size_t LTextureCache_textureBytes(LTexture *lt)
+{
+	Uint32 format;
+
+	if(SDL_QueryTexture(lt->mTexture, &format, NULL, NULL, NULL) < 0)
+		return 0;
+
+	return (size_t)lt->mWidth * lt->mHeight * SDL_BYTESPERPIXEL(format);
+}
+
+LTextureEntry *LTextureCache_find(LTextureCache *tc, char *path, SDL_Color *key)
+{
+	LTextureEntry *e;
+
+	for(e = tc->mEntries; e != NULL; e = e->mNext) {
+		if(e->mKeyed != (key != NULL) || SDL_strcmp(e->mPath, path) != 0)
+			continue;
+		if(key == NULL || (e->mKey.r == key->r && e->mKey.g == key->g
+					&& e->mKey.b == key->b))
+			return e;
+	}
+
+	return NULL;
+}
+
+/*
+ * Loads an image with cyan as its colour key, as LTexture_loadFromFile does.
+ */
+LTexture *LTextureCache_load(LTextureCache *tc, char *path)
+{
+	SDL_Color cyan = { 0x00, 0xFF, 0xFF, 0xFF };
+
+	return LTextureCache_loadKeyed(tc, path, &cyan);
+}
+
+/*
+ * Hands out the texture for the image at path with the key colour made
+ * transparent, or with no key when it is NULL. Only the first request for an
+ * image and key decodes and uploads it; every later one gets the same texture
+ * back and adds a user to it. Returns NULL should the image fail to load.
+ */
+LTexture *LTextureCache_loadKeyed(LTextureCache *tc, char *path, SDL_Color *key)
+{
+	LTextureEntry *e;
+	SDL_Surface *loadedSurface;
+	Uint64 start;
+
+	e = LTextureCache_find(tc, path, key);
+	if(e != NULL) {
+		e->mRefs++;
+		tc->mHits++;
+		return &e->mTexture;
+	}
+
+	e = calloc(1, sizeof(LTextureEntry));
+	if(e == NULL) {
+		SDL_Log("%s(), calloc failed.", __func__);
+		return NULL;
+	}
+
+	e->mPath = SDL_strdup(path);
+	if(e->mPath == NULL) {
+		SDL_Log("%s(), SDL_strdup failed.", __func__);
+		free(e);
+		return NULL;
+	}
+
+	start = SDL_GetPerformanceCounter();
+	loadedSurface = IMG_Load(path);
+	tc->mDecodeNs += LTextureCache_elapsedNs(start);
+	if(loadedSurface == NULL) {
+		SDL_Log("%s(), IMG_Load failed. %s", __func__, IMG_GetError());
+		goto efree;
+	}
+
+	start = SDL_GetPerformanceCounter();
+	if(LTexture_loadFromSurface(&e->mTexture, loadedSurface, key)) {
+		SDL_FreeSurface(loadedSurface);
+		goto efree;
+	}
+	tc->mUploadNs += LTextureCache_elapsedNs(start);
+
+	SDL_FreeSurface(loadedSurface);
+
+	if(key != NULL) {
+		e->mKey = *key;
+		e->mKeyed = 1;
+	}
+	e->mRefs = 1;
+	e->mBytes = LTextureCache_textureBytes(&e->mTexture);
+
+	e->mNext = tc->mEntries;
+	tc->mEntries = e;
+	tc->mCount++;
+	tc->mLoads++;
+	tc->mBytes += e->mBytes;
+	if(tc->mBytes > tc->mPeakBytes)
+		tc->mPeakBytes = tc->mBytes;
+
+	return &e->mTexture;
+efree:
+	SDL_free(e->mPath);
+	free(e);
+	return NULL;
+}
+
+void LTextureCache_destroyEntry(LTextureCache *tc, LTextureEntry *e)
+{
+	tc->mCount--;
+	tc->mBytes -= e->mBytes;
+
+	LTexture_free(&e->mTexture);
+	SDL_free(e->mPath);
+	free(e);
+}
+
+/*
+ * Lets go of a texture handed out by the cache; the texture is destroyed
+ * once its last user has let it go. Letting go of NULL does nothing.
+ */
+void LTextureCache_release(LTextureCache *tc, LTexture *lt)
+{
+	LTextureEntry **link, *e;
+
+	if(lt == NULL)
+		return;
+
+	for(link = &tc->mEntries; *link != NULL; link = &(*link)->mNext) {
+		e = *link;
+		if(&e->mTexture != lt)
+			continue;
+
+		if(--e->mRefs == 0) {
+			*link = e->mNext;
+			LTextureCache_destroyEntry(tc, e);
+		}
+		return;
+	}
+
+	SDL_Log("%s(), texture not from this cache.", __func__);
+}
+
+/*
+ * Destroys every texture still in the cache, whoever is using it, so it must
+ * only be called once they are all done, usually on the way out.
+ */
+void LTextureCache_free(LTextureCache *tc)
+{
+	LTextureEntry *e;
+
+	while(tc->mEntries != NULL) {
+		e = tc->mEntries;
+		tc->mEntries = e->mNext;
+		LTextureCache_destroyEntry(tc, e);
+	}
+}
+
+void LTextureCache_report(LTextureCache *tc)
+{
+	SDL_Log("Textures: %d loaded, %d shared, %d resident in %.1f KiB"
+			" (peak %.1f KiB), %.3f ms decoding, %.3f ms uploading",
+			tc->mLoads,
+			tc->mHits,
+			tc->mCount,
+			tc->mBytes / 1024.0,
+			tc->mPeakBytes / 1024.0,
+			tc->mDecodeNs / 1e6,
+			tc->mUploadNs / 1e6);
+}